@@ -3,8 +3,14 @@
 
 import QtQuick 6.5
 import GravitySimulator
+import GravitySimulator.Engine 1.0
 
 Window {
+    id: root
+
+    // Set from the command line by main.cpp; empty shows the built-in disk.
+    property string scenario: ""
+
     width: mainScreen.width
     height: mainScreen.height
 
@@ -13,7 +19,32 @@ Window {
 
     Screen01 {
         id: mainScreen
+
+        Rectangle {
+            anchors.fill: parent
+            color: Qt.rgba(151 / 255, 172 / 255, 184 / 255, 1)
+
+            SimulationView {
+                id: simulation
+                anchors.fill: parent
+                scenario: root.scenario
+            }
+
+            Text {
+                anchors.left: parent.left
+                anchors.top: parent.top
+                anchors.margins: 8
+                color: "white"
+                font.family: Constants.font.family
+                text: simulation.error !== "" ? simulation.error
+                      : qsTr("obiekty: %1  znaczniki: %2  t = %3 s%4").arg(simulation.bodyCount).arg(simulation.tracerCount)
+                            .arg(simulation.simulationTime.toFixed(2)).arg(simulation.running ? "" : qsTr("  (pauza)"))
+            }
+
+            TapHandler {
+                onTapped: simulation.running = !simulation.running
+            }
+        }
     }
 
 }
-
@@ -3,10 +3,12 @@
 
 #include <QGuiApplication>
 #include <QQmlApplicationEngine>
+#include <QQmlEngine>
 
 #include "app_environment.h"
 #include "import_qml_components_plugins.h"
 #include "import_qml_plugins.h"
+#include "simulationview.h"
 
 int main(int argc, char *argv[])
 {
@@ -14,7 +16,12 @@ int main(int argc, char *argv[])
 
     QGuiApplication app(argc, argv);
 
+    qmlRegisterType<SimulationView>("GravitySimulator.Engine", 1, 0, "SimulationView");
+
     QQmlApplicationEngine engine;
+    // The first argument, if any, is the scenario file the view loads.
+    const QStringList arguments = app.arguments();
+    engine.setInitialProperties({{"scenario", arguments.size() > 1 ? arguments.at(1) : QString()}});
     const QUrl url(u"qrc:/qt/qml/Main/main.qml"_qs);
     QObject::connect(
                 &engine, &QQmlApplicationEngine::objectCreated, &app,
@@ -0,0 +1,346 @@
+#include "simulationview.h"
+#include <QElapsedTimer>
+#include <QJsonObject>
+#include <QQuickWindow>
+#include <QSGGeometryNode>
+#include <QSGImageNode>
+#include <QSGRendererInterface>
+#include <QSGVertexColorMaterial>
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include "scenario.h"
+#include "simulationcontroller.h"
+
+// Below this a body would vanish between pixels; tracers are drawn at exactly this size.
+static const float minPixelSize = 1.0f;
+
+// The application's colours: bodies as simulationarea.cpp draws them, tracers a shade darker.
+static const QColor bodyColour(220, 220, 220);
+static const QColor tracerColour(120, 130, 140);
+
+SimulationView::SimulationView(QQuickItem* parent)
+    : QQuickItem(parent), running(true), simulationSpeed(1.0), stopRequested(false), bodyCount(0), tracerCount(0),
+      simulationTime(0.0), back(), latest(), front(), fresh(false)
+{
+    setFlag(ItemHasContents, true);
+}
+
+SimulationView::~SimulationView()
+{
+    stop();
+}
+
+void SimulationView::componentComplete()
+{
+    QQuickItem::componentComplete();
+    load();
+}
+
+// Without a scenario file the view shows a disk of 100 000 bodies, which only the particle-mesh solver steps
+// at interactive rates.
+void SimulationView::load()
+{
+    stop();
+    Scenario settings;
+    QString message;
+    bool loaded = scenario.isEmpty()
+        ? settings.fromJson(QJsonObject{{"name", "dysk"}, {"solver", "pm"}, {"time_step", 0.01},
+                                        {"generate", QJsonObject{{"type", "disk"}, {"count", 100000}, {"mass", 0.01},
+                                                                 {"inner_radius", 40.0}, {"outer_radius", 240.0},
+                                                                 {"radius", 0.3}}}},
+                            &message)
+        : settings.load(scenario, &message);
+    QString newError = loaded ? QString() : message;
+    if (newError != error)
+    {
+        error = newError;
+        emit errorChanged();
+    }
+    if (!loaded)
+    {
+        controller.reset();
+        return;
+    }
+
+    controller.reset(new SimulationController(nullptr, QPoint(500, 500), QPoint(100, 100), 6.67408, false, 1.0, 0.0, true,
+                                              nullptr));
+    controller->setIntegrator(Integrator::Leapfrog);
+    settings.apply(controller.get());
+    capture(back);
+    {
+        std::lock_guard<std::mutex> lock(snapshotLock);
+        std::swap(back, latest);
+        fresh = true;
+    }
+    update();
+    if (running)
+        start();
+}
+
+void SimulationView::start()
+{
+    if (!controller || engine.joinable())
+        return;
+    stopRequested = false;
+    engine = std::thread(&SimulationView::runEngine, this);
+}
+
+void SimulationView::stop()
+{
+    stopRequested = true;
+    if (engine.joinable())
+        engine.join();
+}
+
+// Steps like SimulationController::brr(): simulated time follows the wall clock times the speed. When a step
+// takes longer than that, the debt is dropped instead of piling up, so the view slows down but stays live.
+void SimulationView::runEngine()
+{
+    QElapsedTimer clock;
+    clock.start();
+    double owed = 0.0;
+    while (!stopRequested)
+    {
+        owed += clock.nsecsElapsed() / 1e9 * simulationSpeed;
+        clock.restart();
+        double timeStep = controller->getTimeStep();
+        if (owed < timeStep)
+        {
+            std::this_thread::sleep_for(std::chrono::milliseconds(1));
+            continue;
+        }
+
+        controller->nextFrame(timeStep);
+        owed = std::min(owed - timeStep, timeStep);
+
+        capture(back);
+        {
+            std::lock_guard<std::mutex> lock(snapshotLock);
+            std::swap(back, latest);
+            fresh = true;
+        }
+        QMetaObject::invokeMethod(this, [this] {
+            emit frameReady();
+            update();
+        }, Qt::QueuedConnection);
+    }
+}
+
+void SimulationView::capture(SimulationSnapshot& snapshot)
+{
+    QList<SimulationObject*>& objects = controller->getSimulationObjects();
+    snapshot.x.clear();
+    snapshot.y.clear();
+    snapshot.radius.clear();
+    for (SimulationObject* o : objects)
+    {
+        if (o->getIsDestroyed())
+            continue;
+        std::pair<double, double> position = o->getPosition();
+        snapshot.x.push_back(static_cast<float>(position.first));
+        snapshot.y.push_back(static_cast<float>(position.second));
+        snapshot.radius.push_back(static_cast<float>(o->getRadius()));
+    }
+
+    TestParticles& tracers = controller->getTestParticles();
+    snapshot.tracerX.assign(tracers.getX().begin(), tracers.getX().end());
+    snapshot.tracerY.assign(tracers.getY().begin(), tracers.getY().end());
+    snapshot.bounds = controller->getBounds();
+    snapshot.time = controller->getSimulationTime();
+    bodyCount = static_cast<int>(snapshot.x.size());
+    tracerCount = static_cast<int>(snapshot.tracerX.size());
+    simulationTime = snapshot.time;
+}
+
+// Runs on the render thread while the GUI thread is blocked, the one moment the item may be read from here.
+QSGNode* SimulationView::updatePaintNode(QSGNode* oldNode, UpdatePaintNodeData*)
+{
+    {
+        std::lock_guard<std::mutex> lock(snapshotLock);
+        if (fresh)
+        {
+            std::swap(latest, front);
+            fresh = false;
+        }
+    }
+
+    if (window()->rendererInterface()->graphicsApi() == QSGRendererInterface::Software)
+        return updateImageNode(oldNode);
+    return updateGeometryNode(oldNode);
+}
+
+// World-to-item transform that fits the simulation bounds into the item, centred, keeping the aspect ratio.
+struct ViewTransform {
+    float scale;
+    float offsetX;
+    float offsetY;
+};
+
+static ViewTransform fitBounds(const SimulationBounds& bounds, double width, double height)
+{
+    double worldWidth = bounds.right - bounds.left;
+    double worldHeight = bounds.bottom - bounds.top;
+    double scale = std::min(width / worldWidth, height / worldHeight);
+    return {static_cast<float>(scale), static_cast<float>(0.5 * (width - scale * worldWidth) - scale * bounds.left),
+            static_cast<float>(0.5 * (height - scale * worldHeight) - scale * bounds.top)};
+}
+
+QSGNode* SimulationView::updateGeometryNode(QSGNode* oldNode)
+{
+    QSGGeometryNode* node = static_cast<QSGGeometryNode*>(oldNode);
+    if (!node)
+    {
+        node = new QSGGeometryNode();
+        QSGGeometry* geometry = new QSGGeometry(QSGGeometry::defaultAttributes_ColoredPoint2D(), 0, 0,
+                                                QSGGeometry::UnsignedIntType);
+        geometry->setDrawingMode(QSGGeometry::DrawTriangles);
+        geometry->setVertexDataPattern(QSGGeometry::StreamPattern);
+        geometry->setIndexDataPattern(QSGGeometry::StaticPattern);
+        node->setGeometry(geometry);
+        node->setFlag(QSGNode::OwnsGeometry);
+        node->setMaterial(new QSGVertexColorMaterial());
+        node->setFlag(QSGNode::OwnsMaterial);
+    }
+
+    // Indices only change with the number of quads; the vertices are rewritten every frame.
+    QSGGeometry* geometry = node->geometry();
+    int bodies = static_cast<int>(front.x.size());
+    int quads = bodies + static_cast<int>(front.tracerX.size());
+    if (geometry->vertexCount() != 4 * quads)
+    {
+        geometry->allocate(4 * quads, 6 * quads);
+        quint32* indices = geometry->indexDataAsUInt();
+        for (int q = 0; q < quads; ++q)
+        {
+            quint32 v = 4 * q;
+            quint32 quad[6] = {v, v + 1, v + 2, v + 2, v + 1, v + 3};
+            std::copy(quad, quad + 6, indices + 6 * q);
+        }
+        node->markDirty(QSGNode::DirtyIndices);
+    }
+
+    ViewTransform view = fitBounds(front.bounds, width(), height());
+    QSGGeometry::ColoredPoint2D* vertex = geometry->vertexDataAsColoredPoint2D();
+    auto emitQuad = [&](float x, float y, float halfSize, const QColor& colour) {
+        float cx = view.offsetX + view.scale * x;
+        float cy = view.offsetY + view.scale * y;
+        uchar r = colour.red(), g = colour.green(), b = colour.blue();
+        vertex[0].set(cx - halfSize, cy - halfSize, r, g, b, 255);
+        vertex[1].set(cx + halfSize, cy - halfSize, r, g, b, 255);
+        vertex[2].set(cx - halfSize, cy + halfSize, r, g, b, 255);
+        vertex[3].set(cx + halfSize, cy + halfSize, r, g, b, 255);
+        vertex += 4;
+    };
+    for (size_t i = 0; i < front.tracerX.size(); ++i)
+        emitQuad(front.tracerX[i], front.tracerY[i], 0.5f * minPixelSize, tracerColour);
+    for (int i = 0; i < bodies; ++i)
+        emitQuad(front.x[i], front.y[i], std::max(0.5f * minPixelSize, view.scale * front.radius[i]), bodyColour);
+    node->markDirty(QSGNode::DirtyGeometry);
+    return node;
+}
+
+// The software fallback: every body becomes a filled square of pixels in an image the size of the item.
+QSGNode* SimulationView::updateImageNode(QSGNode* oldNode)
+{
+    QSGImageNode* node = static_cast<QSGImageNode*>(oldNode);
+    if (!node)
+    {
+        node = window()->createImageNode();
+        node->setOwnsTexture(true);
+    }
+
+    int w = std::max(1, static_cast<int>(width()));
+    int h = std::max(1, static_cast<int>(height()));
+    if (raster.width() != w || raster.height() != h)
+        raster = QImage(w, h, QImage::Format_ARGB32_Premultiplied);
+    raster.fill(Qt::transparent);
+
+    ViewTransform view = fitBounds(front.bounds, width(), height());
+    auto plot = [&](float x, float y, float halfSize, QRgb colour) {
+        float cx = view.offsetX + view.scale * x;
+        float cy = view.offsetY + view.scale * y;
+        int left = std::max(0, static_cast<int>(std::floor(cx - halfSize)));
+        int right = std::min(w - 1, static_cast<int>(std::ceil(cx + halfSize)) - 1);
+        int top = std::max(0, static_cast<int>(std::floor(cy - halfSize)));
+        int bottom = std::min(h - 1, static_cast<int>(std::ceil(cy + halfSize)) - 1);
+        for (int py = top; py <= bottom; ++py)
+        {
+            QRgb* line = reinterpret_cast<QRgb*>(raster.scanLine(py));
+            std::fill(line + left, line + right + 1, colour);
+        }
+    };
+    for (size_t i = 0; i < front.tracerX.size(); ++i)
+        plot(front.tracerX[i], front.tracerY[i], 0.5f * minPixelSize, tracerColour.rgb());
+    for (size_t i = 0; i < front.x.size(); ++i)
+        plot(front.x[i], front.y[i], std::max(0.5f * minPixelSize, view.scale * front.radius[i]), bodyColour.rgb());
+
+    node->setTexture(window()->createTextureFromImage(raster));
+    node->setRect(0, 0, w, h);
+    return node;
+}
+
+QString SimulationView::getScenario()
+{
+    return scenario;
+}
+
+void SimulationView::setScenario(const QString& val)
+{
+    if (scenario == val)
+        return;
+    scenario = val;
+    emit scenarioChanged();
+    if (isComponentComplete())
+        load();
+}
+
+bool SimulationView::getRunning()
+{
+    return running;
+}
+
+void SimulationView::setRunning(bool val)
+{
+    if (running == val)
+        return;
+    running = val;
+    if (running)
+        start();
+    else
+        stop();
+    emit runningChanged();
+}
+
+double SimulationView::getSimulationSpeed()
+{
+    return simulationSpeed;
+}
+
+void SimulationView::setSimulationSpeed(double val)
+{
+    if (simulationSpeed == val)
+        return;
+    simulationSpeed = val;
+    emit simulationSpeedChanged();
+}
+
+int SimulationView::getBodyCount()
+{
+    return bodyCount;
+}
+
+int SimulationView::getTracerCount()
+{
+    return tracerCount;
+}
+
+double SimulationView::getSimulationTime()
+{
+    return simulationTime;
+}
+
+QString SimulationView::getError()
+{
+    return error;
+}
@@ -0,0 +1,95 @@
+#ifndef SIMULATION_VIEW_H
+#define SIMULATION_VIEW_H
+
+#include <QImage>
+#include <QQuickItem>
+#include <atomic>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+#include "boundary.h"
+
+class SimulationController;
+
+// What the renderer needs of one engine state, in single precision.
+struct SimulationSnapshot {
+    std::vector<float> x;
+    std::vector<float> y;
+    std::vector<float> radius;
+    std::vector<float> tracerX;
+    std::vector<float> tracerY;
+    SimulationBounds bounds;
+    double time;
+};
+
+// Draws the bodies and tracers of a simulation running on its own thread. The engine thread publishes
+// snapshots into a triple buffer, so neither it nor the render thread ever waits for the other; each frame
+// turns the latest snapshot into one geometry node of quads (one per body, vertex-coloured) whose vertex
+// buffer is rewritten in place. The software adaptation cannot draw custom geometry, so there the same
+// snapshot is rasterised into an image node instead.
+class SimulationView : public QQuickItem {
+    Q_OBJECT
+    Q_PROPERTY(QString scenario READ getScenario WRITE setScenario NOTIFY scenarioChanged)
+    Q_PROPERTY(bool running READ getRunning WRITE setRunning NOTIFY runningChanged)
+    Q_PROPERTY(double simulationSpeed READ getSimulationSpeed WRITE setSimulationSpeed NOTIFY simulationSpeedChanged)
+    Q_PROPERTY(int bodyCount READ getBodyCount NOTIFY frameReady)
+    Q_PROPERTY(int tracerCount READ getTracerCount NOTIFY frameReady)
+    Q_PROPERTY(double simulationTime READ getSimulationTime NOTIFY frameReady)
+    Q_PROPERTY(QString error READ getError NOTIFY errorChanged)
+
+public:
+    explicit SimulationView(QQuickItem* parent = nullptr);
+    ~SimulationView() override;
+
+    QString getScenario();
+    void setScenario(const QString& val);
+    bool getRunning();
+    void setRunning(bool val);
+    double getSimulationSpeed();
+    void setSimulationSpeed(double val);
+    int getBodyCount();
+    int getTracerCount();
+    double getSimulationTime();
+    QString getError();
+
+signals:
+    void scenarioChanged();
+    void runningChanged();
+    void simulationSpeedChanged();
+    void frameReady();
+    void errorChanged();
+
+protected:
+    void componentComplete() override;
+    QSGNode* updatePaintNode(QSGNode* oldNode, UpdatePaintNodeData* data) override;
+
+private:
+    QString scenario;
+    bool running;
+    std::atomic<double> simulationSpeed;
+    QString error;
+    std::unique_ptr<SimulationController> controller;
+    std::thread engine;
+    std::atomic<bool> stopRequested;
+    std::atomic<int> bodyCount;
+    std::atomic<int> tracerCount;
+    std::atomic<double> simulationTime;
+    // back is the engine thread's, front the render thread's; latest changes hands under snapshotLock.
+    std::mutex snapshotLock;
+    SimulationSnapshot back;
+    SimulationSnapshot latest;
+    SimulationSnapshot front;
+    bool fresh;
+    QImage raster;
+
+    void load();
+    void start();
+    void stop();
+    void runEngine();
+    void capture(SimulationSnapshot& snapshot);
+    QSGNode* updateGeometryNode(QSGNode* oldNode);
+    QSGNode* updateImageNode(QSGNode* oldNode);
+};
+
+#endif // SIMULATION_VIEW_H
@@ -0,0 +1,13 @@
+QT       += core gui widgets
+
+CONFIG += c++17 console
+CONFIG -= app_bundle
+
+# Accuracy-versus-speed harness: gravsim-accuracy scenarios/ [--batch] [--json results.json]
+
+TARGET = gravsim-accuracy
+
+SOURCES += \
+    main.cpp
+
+include(../GravitySimulatorQt/gravitysimulator.pri)
@@ -0,0 +1,317 @@
+#include <QCommandLineParser>
+#include <QCoreApplication>
+#include <QDebug>
+#include <QDir>
+#include <QElapsedTimer>
+#include <QFile>
+#include <QFileInfo>
+#include <QHash>
+#include <QJsonArray>
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <QTextStream>
+#include <algorithm>
+#include <cmath>
+#include "scenario.h"
+#include "simulationcontroller.h"
+
+// One force/integrator combination compared against the direct-sum Euler reference (simulateGravity in double).
+// The opening angle applies to the tree solver, the short-range flag to the particle mesh; both approximate
+// solvers run under leapfrog at the scenario's step.
+struct SolverConfiguration {
+    QString name;
+    Integrator integrator;
+    double timeStepScale;
+    Precision precision;
+    ForceSolver solver;
+    double openingAngle;
+    bool meshShortRange;
+};
+
+struct Percentiles {
+    double p50;
+    double p99;
+    double max;
+};
+
+struct ConfigurationResult {
+    QString scenario;
+    QString configuration;
+    double milliseconds;
+    Percentiles acceleration;
+    Percentiles position;
+    int lost;
+    bool pareto;
+    QStringList violations;
+};
+
+// Labels carry the absolute step, so they double as tolerance keys for the scenario's own time_step.
+static QList<SolverConfiguration> configurations(double timeStep)
+{
+    QList<SolverConfiguration> result;
+    const QList<double> scales = {1.0, 2.0, 5.0};
+    for (double scale : scales)
+    {
+        result.append({QString("euler dt=%1").arg(timeStep * scale), Integrator::Euler, scale, Precision::Double,
+                       ForceSolver::Direct, 0.5, false});
+    }
+    for (double scale : scales)
+    {
+        result.append({QString("leapfrog dt=%1").arg(timeStep * scale), Integrator::Leapfrog, scale, Precision::Double,
+                       ForceSolver::Direct, 0.5, false});
+    }
+    result.append({"euler float", Integrator::Euler, 1.0, Precision::Float, ForceSolver::Direct, 0.5, false});
+    result.append({"euler mixed", Integrator::Euler, 1.0, Precision::Mixed, ForceSolver::Direct, 0.5, false});
+    result.append({"leapfrog float", Integrator::Leapfrog, 1.0, Precision::Float, ForceSolver::Direct, 0.5, false});
+    result.append({"leapfrog mixed", Integrator::Leapfrog, 1.0, Precision::Mixed, ForceSolver::Direct, 0.5, false});
+    for (double angle : {0.3, 0.5})
+    {
+        result.append({QString("tree theta=%1").arg(angle), Integrator::Leapfrog, 1.0, Precision::Double,
+                       ForceSolver::Tree, angle, false});
+    }
+    result.append({"pm", Integrator::Leapfrog, 1.0, Precision::Double, ForceSolver::ParticleMesh, 0.5, false});
+    result.append({"p3m", Integrator::Leapfrog, 1.0, Precision::Double, ForceSolver::ParticleMesh, 0.5, true});
+    return result;
+}
+
+// The mesh size and boundary stay the scenario's.
+static void configure(SimulationController* controller, const SolverConfiguration& configuration)
+{
+    controller->setIntegrator(configuration.integrator);
+    controller->setPrecision(configuration.precision);
+    controller->getTreeSolver().setOpeningAngle(configuration.openingAngle);
+    controller->getParticleMesh().setShortRange(configuration.meshShortRange);
+    controller->setForceSolver(configuration.solver);
+}
+
+static Percentiles percentiles(std::vector<double> values)
+{
+    if (values.empty())
+        return {0.0, 0.0, 0.0};
+
+    std::sort(values.begin(), values.end());
+    return {values[values.size() / 2], values[std::min(values.size() - 1, values.size() * 99 / 100)], values.back()};
+}
+
+static QHash<QString, std::pair<double, double>> accelerations(SimulationController* controller)
+{
+    controller->computeForces();
+    QHash<QString, std::pair<double, double>> result;
+    for (SimulationObject* o : controller->getSimulationObjects())
+        result.insert(o->getName(), o->getAcceleration());
+    return result;
+}
+
+static QHash<QString, std::pair<double, double>> trajectory(SimulationController* controller, Scenario& scenario,
+                                                             double timeStep, double* milliseconds)
+{
+    int steps = static_cast<int>(std::lround(scenario.getDuration() / timeStep));
+    QElapsedTimer timer;
+    timer.start();
+    for (int i = 0; i < steps; ++i)
+        controller->nextFrame(timeStep);
+    *milliseconds = timer.nsecsElapsed() / 1e6;
+
+    QHash<QString, std::pair<double, double>> result;
+    for (SimulationObject* o : controller->getSimulationObjects())
+        result.insert(o->getName(), o->getPosition());
+    return result;
+}
+
+static QStringList checkTolerances(const ConfigurationResult& result, const QJsonObject& tolerances)
+{
+    QJsonObject limits = tolerances.contains(result.configuration) ? tolerances[result.configuration].toObject()
+                                                                   : tolerances["default"].toObject();
+    QStringList violations;
+    auto check = [&](const QString& key, double value) {
+        if (limits.contains(key) && value > limits[key].toDouble())
+            violations << QString("%1=%2 > %3").arg(key).arg(value, 0, 'g', 4).arg(limits[key].toDouble());
+    };
+    check("acceleration_p50", result.acceleration.p50);
+    check("acceleration_p99", result.acceleration.p99);
+    check("position_p50", result.position.p50);
+    check("position_p99", result.position.p99);
+    check("lost", result.lost);
+    return violations;
+}
+
+static QList<ConfigurationResult> runScenario(Scenario& scenario, SimulationController* controller)
+{
+    // The reference is direct summation in double whatever solver the scenario itself selects.
+    scenario.apply(controller);
+    controller->setIntegrator(Integrator::Euler);
+    controller->setPrecision(Precision::Double);
+    controller->setForceSolver(ForceSolver::Direct);
+    QHash<QString, std::pair<double, double>> referenceAcceleration = accelerations(controller);
+    scenario.apply(controller);
+    controller->setIntegrator(Integrator::Euler);
+    controller->setPrecision(Precision::Double);
+    controller->setForceSolver(ForceSolver::Direct);
+    double referenceTime;
+    QHash<QString, std::pair<double, double>> referencePosition = trajectory(controller, scenario, scenario.getTimeStep(), &referenceTime);
+
+    QList<ConfigurationResult> results;
+    for (const SolverConfiguration& configuration : configurations(scenario.getTimeStep()))
+    {
+        ConfigurationResult result{scenario.getName(), configuration.name, 0.0, {}, {}, 0, false, {}};
+
+        scenario.apply(controller);
+        configure(controller, configuration);
+        std::vector<double> errors;
+        QHash<QString, std::pair<double, double>> acceleration = accelerations(controller);
+        for (auto it = referenceAcceleration.begin(); it != referenceAcceleration.end(); ++it)
+        {
+            std::pair<double, double> a = acceleration.value(it.key());
+            double magnitude = std::hypot(it.value().first, it.value().second);
+            double error = std::hypot(a.first - it.value().first, a.second - it.value().second);
+            errors.push_back(magnitude > 0.0 ? error / magnitude : error);
+        }
+        result.acceleration = percentiles(errors);
+
+        scenario.apply(controller);
+        configure(controller, configuration);
+        QHash<QString, std::pair<double, double>> position =
+            trajectory(controller, scenario, scenario.getTimeStep() * configuration.timeStepScale, &result.milliseconds);
+        errors.clear();
+        for (auto it = referencePosition.begin(); it != referencePosition.end(); ++it)
+        {
+            if (!position.contains(it.key()))
+            {
+                ++result.lost;
+                continue;
+            }
+            std::pair<double, double> p = position.value(it.key());
+            errors.push_back(std::hypot(p.first - it.value().first, p.second - it.value().second));
+        }
+        for (auto it = position.begin(); it != position.end(); ++it)
+            if (!referencePosition.contains(it.key()))
+                ++result.lost;
+        result.position = percentiles(errors);
+        result.violations = checkTolerances(result, scenario.getSettings()["tolerances"].toObject());
+        results.append(result);
+    }
+
+    // Pareto front over (wall-clock time, p99 trajectory error).
+    for (ConfigurationResult& result : results)
+    {
+        result.pareto = true;
+        for (const ConfigurationResult& other : results)
+        {
+            bool noWorse = other.milliseconds <= result.milliseconds && other.position.p99 <= result.position.p99;
+            bool better = other.milliseconds < result.milliseconds || other.position.p99 < result.position.p99;
+            if (noWorse && better)
+            {
+                result.pareto = false;
+                break;
+            }
+        }
+    }
+    return results;
+}
+
+static QJsonObject toJson(const ConfigurationResult& result)
+{
+    QJsonObject object;
+    object["scenario"] = result.scenario;
+    object["configuration"] = result.configuration;
+    object["milliseconds"] = result.milliseconds;
+    object["acceleration_p50"] = result.acceleration.p50;
+    object["acceleration_p99"] = result.acceleration.p99;
+    object["acceleration_max"] = result.acceleration.max;
+    object["position_p50"] = result.position.p50;
+    object["position_p99"] = result.position.p99;
+    object["position_max"] = result.position.max;
+    object["lost"] = result.lost;
+    object["pareto"] = result.pareto;
+    object["violations"] = QJsonArray::fromStringList(result.violations);
+    return object;
+}
+
+int main(int argc, char *argv[])
+{
+    QCoreApplication a(argc, argv);
+    QCommandLineParser parser;
+    parser.setApplicationDescription("Porównuje konfiguracje sił i całkowania z referencją simulateGravity (suma bezpośrednia, "
+                                     "Euler, krok scenariusza): błędy przyspieszeń i trajektorii oraz czas działania.");
+    parser.addHelpOption();
+    parser.addPositionalArgument("scenarios", "Pliki scenariuszy JSON lub katalogi z nimi.");
+    QCommandLineOption batchOption("batch", "Tryb wsadowy: wypisz tylko przekroczenia tolerancji, kod wyjścia 1 jeśli wystąpiły.");
+    QCommandLineOption jsonOption("json", "Zapisz wyniki do pliku JSON.", "file");
+    parser.addOption(batchOption);
+    parser.addOption(jsonOption);
+    parser.process(a);
+
+    QStringList paths;
+    for (const QString& argument : parser.positionalArguments())
+    {
+        if (QFileInfo(argument).isDir())
+        {
+            QDir dir(argument);
+            for (const QString& file : dir.entryList({"*.json"}, QDir::Files, QDir::Name))
+                paths << dir.filePath(file);
+        }
+        else
+        {
+            paths << argument;
+        }
+    }
+    if (paths.isEmpty())
+        parser.showHelp(2);
+
+    bool batch = parser.isSet(batchOption);
+    SimulationController controller(nullptr, QPoint(500, 500), QPoint(100, 100), 6.67408, false, 1.0, 0.0, true, nullptr);
+    QTextStream out(stdout);
+    QJsonArray json;
+    int failures = 0;
+
+    for (const QString& path : paths)
+    {
+        Scenario scenario;
+        QString error;
+        if (!scenario.load(path, &error))
+        {
+            qCritical() << error;
+            return 2;
+        }
+
+        QList<ConfigurationResult> results = runScenario(scenario, &controller);
+        if (!batch)
+        {
+            out << "\n" << scenario.getName() << " (" << scenario.getBodies().size() << " obiektów, "
+                << scenario.getDuration() << " s)\n";
+            out << QString("%1 %2 %3 %4 %5 %6 %7 %8\n").arg("konfiguracja", -18).arg("czas [ms]", 10).arg("acc p50", 10)
+                       .arg("acc p99", 10).arg("poz p50", 10).arg("poz p99", 10).arg("zgub.", 6).arg("pareto", 7);
+        }
+
+        for (const ConfigurationResult& result : results)
+        {
+            json.append(toJson(result));
+            failures += result.violations.isEmpty() ? 0 : 1;
+            if (batch && result.violations.isEmpty())
+                continue;
+
+            out << QString("%1 %2 %3 %4 %5 %6 %7 %8").arg(batch ? result.scenario + "/" + result.configuration : result.configuration, -18)
+                       .arg(result.milliseconds, 10, 'f', 2).arg(result.acceleration.p50, 10, 'g', 3)
+                       .arg(result.acceleration.p99, 10, 'g', 3).arg(result.position.p50, 10, 'g', 3)
+                       .arg(result.position.p99, 10, 'g', 3).arg(result.lost, 6).arg(result.pareto ? "*" : "", 7);
+            if (!result.violations.isEmpty())
+                out << "  POZA TOLERANCJĄ: " << result.violations.join(", ");
+            out << "\n";
+        }
+        out.flush();
+    }
+
+    if (parser.isSet(jsonOption))
+    {
+        QFile file(parser.value(jsonOption));
+        if (!file.open(QIODevice::WriteOnly | QIODevice::Truncate))
+        {
+            qCritical() << "Nie można zapisać" << parser.value(jsonOption);
+            return 2;
+        }
+        file.write(QJsonDocument(json).toJson());
+    }
+
+    out << "\n" << failures << " konfiguracji poza tolerancją\n";
+    return batch && failures > 0 ? 1 : 0;
+}
@@ -0,0 +1,13 @@
+QT       += core gui widgets
+
+CONFIG += c++17 console
+CONFIG -= app_bundle
+
+# Benchmarks for the physics and rendering hot paths: gravsim-bench --help
+
+TARGET = gravsim-bench
+
+SOURCES += \
+    main.cpp
+
+include(../GravitySimulatorQt/gravitysimulator.pri)
@@ -0,0 +1,503 @@
+#include <QApplication>
+#include <QCommandLineParser>
+#include <QDebug>
+#include <QElapsedTimer>
+#include <QFile>
+#include <QHash>
+#include <QImage>
+#include <QJsonArray>
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <QTextStream>
+#include <algorithm>
+#include <cmath>
+#include <functional>
+#include <random>
+#include "mainwindow.h"
+
+#ifdef __linux__
+#include <linux/perf_event.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
+struct BenchmarkOptions {
+    QList<int> sizes;
+    QStringList scenarios;
+    double minTime;
+    double pairLimit;
+    quint64 seed;
+};
+
+struct BenchmarkResult {
+    QString name;
+    QString scenario;
+    int n;
+    bool skipped;
+    qint64 iterations;
+    double seconds;
+    double nsPerOp;
+    double bodyStepsPerSecond;
+    // Last-level cache misses per operation, negative when hardware counters are not available.
+    double cacheMissesPerOp;
+    // Job time of the busiest thread over the mean of the JobSystem's threads, negative when no jobs ran.
+    double workerImbalance;
+};
+
+// Hardware cache-miss counter of the calling thread (Linux perf events). Without perf support every
+// measurement reports -1.
+class CacheMissCounter {
+public:
+    CacheMissCounter() : fd(-1)
+    {
+#ifdef __linux__
+        perf_event_attr attr = perf_event_attr();
+        attr.size = sizeof(attr);
+        attr.type = PERF_TYPE_HARDWARE;
+        attr.config = PERF_COUNT_HW_CACHE_MISSES;
+        attr.disabled = 1;
+        attr.exclude_kernel = 1;
+        attr.exclude_hv = 1;
+        fd = static_cast<int>(syscall(SYS_perf_event_open, &attr, 0, -1, -1, 0));
+#endif
+    }
+
+    ~CacheMissCounter()
+    {
+#ifdef __linux__
+        if (fd >= 0)
+            close(fd);
+#endif
+    }
+
+    bool isAvailable()
+    {
+        return fd >= 0;
+    }
+
+    void start()
+    {
+#ifdef __linux__
+        if (fd >= 0)
+            ioctl(fd, PERF_EVENT_IOC_ENABLE, 0);
+#endif
+    }
+
+    void stop()
+    {
+#ifdef __linux__
+        if (fd >= 0)
+            ioctl(fd, PERF_EVENT_IOC_DISABLE, 0);
+#endif
+    }
+
+    qint64 read()
+    {
+        qint64 value = -1;
+#ifdef __linux__
+        if (fd < 0 || ::read(fd, &value, sizeof(value)) != sizeof(value))
+            value = -1;
+#endif
+        return value;
+    }
+
+private:
+    int fd;
+};
+
+static const double frameTime = 0.01;
+static const double pi = 3.14159265358979323846;
+
+// Fills the controller with n bodies spread uniformly over the 500x500 simulation area. escapeFraction of them
+// are placed outside the area (beyond the margin), so applyBoundaries removes them.
+static void populate(SimulationController* controller, int n, quint64 seed, double radius, double escapeFraction)
+{
+    controller->resetSimulation();
+    std::mt19937_64 rng(seed ^ static_cast<quint64>(n));
+    std::uniform_real_distribution<double> inside(0.0, 500.0);
+    std::uniform_real_distribution<double> outside(700.0, 1200.0);
+    std::uniform_real_distribution<double> velocity(-5.0, 5.0);
+    std::uniform_real_distribution<double> mass(1.0, 20.0);
+
+    int escaping = static_cast<int>(n * escapeFraction);
+    for (int i = 0; i < n; ++i)
+    {
+        double x = i < escaping ? outside(rng) : inside(rng);
+        double y = inside(rng);
+        controller->addSimulationObject(QString("b%1").arg(i), {x, y}, {velocity(rng), velocity(rng)}, radius, mass(rng));
+    }
+}
+
+static BenchmarkResult runBenchmark(const QString& scenario, int n, double opsPerIteration, double minTime,
+                                    const std::function<void()>& prepare, const std::function<void()>& body)
+{
+    BenchmarkResult result{QString("%1/%2").arg(scenario).arg(n), scenario, n, false, 0, 0.0, 0.0, 0.0, -1.0, -1.0};
+    CacheMissCounter misses;
+    JobSystem::instance().resetStats();
+    QElapsedTimer timer;
+    qint64 elapsed = 0;
+    while (result.iterations == 0 || elapsed < minTime * 1e9)
+    {
+        prepare();
+        misses.start();
+        timer.start();
+        body();
+        elapsed += timer.nsecsElapsed();
+        misses.stop();
+        ++result.iterations;
+    }
+
+    result.seconds = elapsed / 1e9;
+    result.nsPerOp = elapsed / (opsPerIteration * result.iterations);
+    result.bodyStepsPerSecond = n * result.iterations / result.seconds;
+    qint64 missCount = misses.read();
+    if (missCount >= 0)
+        result.cacheMissesPerOp = missCount / (opsPerIteration * result.iterations);
+
+    std::vector<WorkerStats> workers = JobSystem::instance().getStats();
+    double busiest = 0.0;
+    double total = 0.0;
+    for (const WorkerStats& worker : workers)
+    {
+        busiest = std::max(busiest, static_cast<double>(worker.busyNanoseconds));
+        total += worker.busyNanoseconds;
+    }
+    if (total > 0.0)
+        result.workerImbalance = busiest * workers.size() / total;
+    return result;
+}
+
+static BenchmarkResult runScenario(const QString& scenario, int n, const BenchmarkOptions& options,
+                                   MainAppWindow& window, SimulationArea& area, QImage& image)
+{
+    SimulationController* controller = window.getController();
+    QList<SimulationObject*>& objects = controller->getSimulationObjects();
+    double pairs = 0.5 * n * (n - 1.0);
+    auto nothing = [] {};
+
+    // Pairwise work grows as N^2.
+    bool quadratic = scenario == "gravity" || scenario.startsWith("forces-") ||
+                     (scenario.startsWith("collisions") && scenario != "collisions-listed") || scenario == "step" ||
+                     scenario.startsWith("locality-");
+    if (quadratic && pairs > options.pairLimit)
+        return BenchmarkResult{QString("%1/%2").arg(scenario).arg(n), scenario, n, true, 0, 0.0, 0.0, 0.0, -1.0, -1.0};
+
+    if (scenario == "gravity")
+    {
+        populate(controller, n, options.seed, 0.05, 0.0);
+        Softening softening{SofteningKernel::None, 0.0};
+        return runBenchmark(scenario, n, pairs, options.minTime, nothing, [&] {
+            for (int i = 0; i < objects.size(); ++i)
+                for (int j = i + 1; j < objects.size(); ++j)
+                    objects[i]->applyGravity(*objects[j], 6.67408, softening);
+        });
+    }
+
+    // Force evaluation through computeForces() in each precision mode, including the gather/scatter.
+    if (scenario.startsWith("forces-"))
+    {
+        populate(controller, n, options.seed, 0.05, 0.0);
+        Precision precision = scenario == "forces-float" ? Precision::Float
+                            : scenario == "forces-mixed" ? Precision::Mixed : Precision::Double;
+        controller->setPrecision(precision);
+        BenchmarkResult result = runBenchmark(scenario, n, pairs, options.minTime, nothing, [&] { controller->computeForces(); });
+        controller->setPrecision(Precision::Double);
+        return result;
+    }
+
+    // Particle-mesh (P3M) forces: grid work plus a short-range sum over neighbours, so ns/op is per body.
+    if (scenario.startsWith("pm-"))
+    {
+        populate(controller, n, options.seed, 0.05, 0.0);
+        ParticleMeshSolver& mesh = controller->getParticleMesh();
+        mesh.setBoundary(scenario == "pm-periodic" ? MeshBoundary::Periodic : MeshBoundary::Isolated);
+        controller->setForceSolver(ForceSolver::ParticleMesh);
+        BenchmarkResult result = runBenchmark(scenario, n, n, options.minTime, nothing, [&] { controller->computeForces(); });
+        controller->setForceSolver(ForceSolver::Direct);
+        return result;
+    }
+
+    // Barnes-Hut forces with the bodies drifting between evaluations, so the tree's reinsertion and refit are
+    // measured along with the traversal; ns/op is per body.
+    if (scenario == "tree")
+    {
+        populate(controller, n, options.seed, 0.05, 0.0);
+        controller->setForceSolver(ForceSolver::Tree);
+        BenchmarkResult result = runBenchmark(scenario, n, n, options.minTime, nothing, [&] {
+            for (SimulationObject* o : objects)
+                o->drift(frameTime);
+            controller->computeForces();
+        });
+        controller->setForceSolver(ForceSolver::Direct);
+        return result;
+    }
+
+    // Whole steps of ten planets around a star carrying n massless tracers on circular orbits; ns/op is per tracer.
+    if (scenario == "tracers")
+    {
+        controller->resetSimulation();
+        std::mt19937_64 rng(options.seed ^ static_cast<quint64>(n));
+        std::uniform_real_distribution<double> unit(0.0, 1.0);
+        double starMass = 10000.0;
+        controller->addSimulationObject("star", {250.0, 250.0}, {0.0, 0.0}, 10.0, starMass);
+        for (int p = 0; p < 10; ++p)
+        {
+            double r = 40.0 + 20.0 * p;
+            double v = std::sqrt(6.67408 * starMass / r);
+            controller->addSimulationObject(QString("p%1").arg(p), {250.0 + r, 250.0}, {0.0, v}, 2.0, 10.0);
+        }
+        for (int i = 0; i < n; ++i)
+        {
+            double r = 30.0 + 200.0 * unit(rng);
+            double angle = 2.0 * pi * unit(rng);
+            double v = std::sqrt(6.67408 * starMass / r);
+            controller->addTestParticle({250.0 + r * std::cos(angle), 250.0 + r * std::sin(angle)},
+                                        {-v * std::sin(angle), v * std::cos(angle)});
+        }
+        return runBenchmark(scenario, n, n, options.minTime, nothing, [&] { controller->nextFrame(frameTime); });
+    }
+
+    if (scenario == "collisions")
+    {
+        populate(controller, n, options.seed, 0.05, 0.0);
+        volatile int hits = 0;
+        return runBenchmark(scenario, n, pairs, options.minTime, nothing, [&] {
+            int count = 0;
+            for (int i = 0; i < objects.size(); ++i)
+                for (int j = i + 1; j < objects.size(); ++j)
+                    count += objects[i]->detectCollision(*objects[j]);
+            hits = count;
+        });
+    }
+
+    if (scenario == "collisions-swept")
+    {
+        populate(controller, n, options.seed, 0.05, 0.0);
+        volatile int hits = 0;
+        return runBenchmark(scenario, n, pairs, options.minTime, nothing, [&] {
+            int count = 0;
+            for (int i = 0; i < objects.size(); ++i)
+                for (int j = i + 1; j < objects.size(); ++j)
+                    count += objects[i]->timeOfImpact(*objects[j], frameTime) >= 0.0;
+            hits = count;
+        });
+    }
+
+    // A drift plus the swept collision pass through the cached neighbour list, which is rebuilt only when the
+    // bodies have moved through half the skin; ns/op is per body.
+    if (scenario == "collisions-listed")
+    {
+        populate(controller, n, options.seed, 0.05, 0.0);
+        return runBenchmark(scenario, n, n, options.minTime, nothing, [&] {
+            for (SimulationObject* o : objects)
+                o->drift(frameTime);
+            controller->collideSweptAll(frameTime);
+        });
+    }
+
+    if (scenario == "integration")
+    {
+        populate(controller, n, options.seed, 0.05, 0.0);
+        return runBenchmark(scenario, n, n, options.minTime, nothing, [&] {
+            for (SimulationObject* o : objects)
+                o->simulateStep(frameTime);
+        });
+    }
+
+    if (scenario == "escape")
+    {
+        return runBenchmark(scenario, n, n, options.minTime, [&] { populate(controller, n, options.seed, 0.05, 0.5); }, [&] {
+            controller->applyBoundaries();
+        });
+    }
+
+    // Pairwise force and collision sweeps over storage that churn has left in random order (list order unrelated
+    // to memory and to space), before and after reorderBodies() has put it back in Morton order.
+    if (scenario == "locality-shuffled" || scenario == "locality-morton")
+    {
+        populate(controller, n, options.seed, 0.05, 0.0);
+        std::shuffle(objects.begin(), objects.end(), std::mt19937_64(options.seed));
+        if (scenario == "locality-morton")
+            controller->reorderBodies();
+        return runBenchmark(scenario, n, pairs, options.minTime, nothing, [&] {
+            controller->computeForces();
+            controller->collideAll();
+        });
+    }
+
+    if (scenario == "reorder")
+    {
+        populate(controller, n, options.seed, 0.05, 0.0);
+        std::mt19937_64 rng(options.seed);
+        return runBenchmark(scenario, n, n, options.minTime, [&] { std::shuffle(objects.begin(), objects.end(), rng); }, [&] {
+            controller->reorderBodies();
+        });
+    }
+
+    if (scenario == "step")
+    {
+        populate(controller, n, options.seed, 0.05, 0.0);
+        return runBenchmark(scenario, n, pairs, options.minTime, nothing, [&] { controller->nextFrame(frameTime); });
+    }
+
+    populate(controller, n, options.seed, 2.0, 0.0);
+    return runBenchmark(scenario, n, n, options.minTime, nothing, [&] { area.render(&image); });
+}
+
+static QJsonObject toJson(const BenchmarkResult& result)
+{
+    QJsonObject object;
+    object["name"] = result.name;
+    object["scenario"] = result.scenario;
+    object["n"] = result.n;
+    object["skipped"] = result.skipped;
+    object["iterations"] = result.iterations;
+    object["seconds"] = result.seconds;
+    object["ns_per_op"] = result.nsPerOp;
+    object["body_steps_per_s"] = result.bodyStepsPerSecond;
+    if (result.cacheMissesPerOp >= 0.0)
+        object["cache_misses_per_op"] = result.cacheMissesPerOp;
+    if (result.workerImbalance >= 0.0)
+        object["worker_imbalance"] = result.workerImbalance;
+    return object;
+}
+
+static QHash<QString, double> loadBaseline(const QString& path, bool* ok)
+{
+    QHash<QString, double> baseline;
+    QFile file(path);
+    *ok = file.open(QIODevice::ReadOnly);
+    if (!*ok)
+        return baseline;
+
+    QJsonArray results = QJsonDocument::fromJson(file.readAll()).object()["results"].toArray();
+    for (const QJsonValue& value : results)
+    {
+        QJsonObject object = value.toObject();
+        if (!object["skipped"].toBool())
+            baseline.insert(object["name"].toString(), object["ns_per_op"].toDouble());
+    }
+    return baseline;
+}
+
+int main(int argc, char *argv[])
+{
+    if (qEnvironmentVariableIsEmpty("QT_QPA_PLATFORM"))
+        qputenv("QT_QPA_PLATFORM", "offscreen");
+
+    QApplication a(argc, argv);
+    QCommandLineParser parser;
+    parser.setApplicationDescription("Benchmarki symulatora: siły, kolizje, całkowanie, usuwanie obiektów, lokalność pamięci, rysowanie.\n"
+                                     "ns/op oznacza ns na parę obiektów (gravity, forces-*, collisions, collisions-swept, locality-*, step) albo na obiekt (pm-*, tree i pozostałe),\n"
+                                     "misses/op - chybienia cache na operację (liczniki perf, tylko Linux),\n"
+                                     "imbalance - czas zadań najbardziej obciążonego wątku puli względem średniej (1 = równo).");
+    parser.addHelpOption();
+    QCommandLineOption sizesOption("sizes", "Rozmiary N oddzielone przecinkami.", "list", "10,100,1000,10000,100000,1000000");
+    QCommandLineOption scenariosOption("scenarios", "Scenariusze oddzielone przecinkami.", "list",
+                                       "gravity,forces-double,forces-float,forces-mixed,pm-isolated,pm-periodic,tree,tracers,collisions,collisions-swept,collisions-listed,integration,escape,"
+                                       "locality-shuffled,locality-morton,reorder,step,render");
+    QCommandLineOption minTimeOption("min-time", "Minimalny czas pomiaru jednego benchmarku [s].", "seconds", "0.2");
+    QCommandLineOption pairLimitOption("pair-limit", "Pomiń scenariusze O(N^2) powyżej tej liczby par.", "pairs", "2e9");
+    QCommandLineOption seedOption("seed", "Ziarno generatora scenariuszy.", "seed", "42");
+    QCommandLineOption jsonOption("json", "Zapisz wyniki do pliku JSON.", "file");
+    QCommandLineOption baselineOption("baseline", "Porównaj z wynikami zapisanymi wcześniej przez --json.", "file");
+    QCommandLineOption thresholdOption("threshold", "Dopuszczalne spowolnienie względem baseline (0.1 = 10%).", "ratio", "0.1");
+    parser.addOption(sizesOption);
+    parser.addOption(scenariosOption);
+    parser.addOption(minTimeOption);
+    parser.addOption(pairLimitOption);
+    parser.addOption(seedOption);
+    parser.addOption(jsonOption);
+    parser.addOption(baselineOption);
+    parser.addOption(thresholdOption);
+    parser.process(a);
+
+    BenchmarkOptions options;
+    for (const QString& size : parser.value(sizesOption).split(','))
+        options.sizes.append(size.toInt());
+    options.scenarios = parser.value(scenariosOption).split(',');
+    options.minTime = parser.value(minTimeOption).toDouble();
+    options.pairLimit = parser.value(pairLimitOption).toDouble();
+    options.seed = parser.value(seedOption).toULongLong();
+
+    QHash<QString, double> baseline;
+    if (parser.isSet(baselineOption))
+    {
+        bool ok;
+        baseline = loadBaseline(parser.value(baselineOption), &ok);
+        if (!ok)
+        {
+            qCritical() << "Nie można otworzyć" << parser.value(baselineOption);
+            return 2;
+        }
+    }
+    double threshold = parser.value(thresholdOption).toDouble();
+
+    MainAppWindow window;
+    SimulationArea area(nullptr, window.getController());
+    area.resize(500, 500);
+    QImage image(500, 500, QImage::Format_ARGB32_Premultiplied);
+
+    QTextStream out(stdout);
+    out << QString("%1 %2 %3 %4 %5 %6 %7\n").arg("benchmark", -24).arg("iter", 8).arg("ns/op", 12).arg("body-steps/s", 14)
+                                            .arg("misses/op", 10).arg("imbalance", 10).arg("vs baseline", 12);
+
+    QJsonArray results;
+    int regressions = 0;
+    for (const QString& scenario : options.scenarios)
+    {
+        for (int n : options.sizes)
+        {
+            BenchmarkResult result = runScenario(scenario, n, options, window, area, image);
+            results.append(toJson(result));
+            if (result.skipped)
+            {
+                out << QString("%1 pominięto (N^2 > --pair-limit)\n").arg(result.name, -24);
+                out.flush();
+                continue;
+            }
+
+            QString comparison;
+            if (baseline.contains(result.name))
+            {
+                double ratio = result.nsPerOp / baseline.value(result.name);
+                comparison = QString("%1%").arg((ratio - 1.0) * 100.0, 0, 'f', 1);
+                if (ratio > 1.0 + threshold)
+                {
+                    comparison += " REGRESJA";
+                    ++regressions;
+                }
+            }
+
+            QString misses = result.cacheMissesPerOp >= 0.0 ? QString::number(result.cacheMissesPerOp, 'f', 4) : QString("-");
+            QString imbalance = result.workerImbalance >= 0.0 ? QString::number(result.workerImbalance, 'f', 2) : QString("-");
+            out << QString("%1 %2 %3 %4 %5 %6 %7\n").arg(result.name, -24).arg(result.iterations, 8)
+                       .arg(result.nsPerOp, 12, 'f', 3).arg(result.bodyStepsPerSecond, 14, 'g', 4).arg(misses, 10)
+                       .arg(imbalance, 10).arg(comparison, 12);
+            out.flush();
+        }
+    }
+
+    if (parser.isSet(jsonOption))
+    {
+        QJsonObject root;
+        root["seed"] = static_cast<qint64>(options.seed);
+        root["min_time"] = options.minTime;
+        root["results"] = results;
+        QFile file(parser.value(jsonOption));
+        if (!file.open(QIODevice::WriteOnly | QIODevice::Truncate))
+        {
+            qCritical() << "Nie można zapisać" << parser.value(jsonOption);
+            return 2;
+        }
+        file.write(QJsonDocument(root).toJson());
+    }
+
+    if (regressions > 0)
+    {
+        out << regressions << " benchmark(ów) wolniejszych niż baseline o ponad " << threshold * 100.0 << "%\n";
+        return 1;
+    }
+    return 0;
+}
@@ -0,0 +1,13 @@
+QT       += core gui widgets
+
+CONFIG += c++17 console
+CONFIG -= app_bundle
+
+# Headless runner that splits one scenario over several processes (Linux): gravsim-cluster scenario.json --ranks 4
+
+TARGET = gravsim-cluster
+
+SOURCES += \
+    main.cpp
+
+include(../GravitySimulatorQt/gravitysimulator.pri)
@@ -0,0 +1,235 @@
+#include <QCommandLineParser>
+#include <QCoreApplication>
+#include <QDebug>
+#include <QFile>
+#include <QJsonArray>
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <QProcess>
+#include <QTemporaryDir>
+#include <QTextStream>
+#include <algorithm>
+#include <cmath>
+#include <thread>
+#include "distributedsimulation.h"
+#include "scenario.h"
+#include "transport.h"
+
+struct RunOptions {
+    int ranks;
+    int rank;
+    QString socketDirectory;
+    int steps;
+    int rebalanceInterval;
+    int reportInterval;
+    double openingAngle;
+    int threads;
+    QString jsonPath;
+};
+
+// The coordinator starts every rank as a copy of this program with the same arguments plus its rank and the
+// socket directory, forwards their output and fails if any of them fails. A rank that dies closes its sockets,
+// so the others stop at their next exchange instead of waiting forever.
+static int launchRanks(const RunOptions& options)
+{
+    QTemporaryDir directory;
+    if (!directory.isValid())
+    {
+        qCritical() << "Nie można utworzyć katalogu gniazd";
+        return 2;
+    }
+
+    QStringList arguments = QCoreApplication::arguments().mid(1);
+    QList<QProcess*> processes;
+    for (int r = 0; r < options.ranks; ++r)
+    {
+        QProcess* process = new QProcess();
+        process->setProcessChannelMode(QProcess::ForwardedChannels);
+        process->start(QCoreApplication::applicationFilePath(),
+                       arguments + QStringList{"--rank", QString::number(r), "--socket-dir", directory.path()});
+        processes.append(process);
+    }
+
+    int result = 0;
+    for (int r = 0; r < processes.size(); ++r)
+    {
+        QProcess* process = processes[r];
+        process->waitForFinished(-1);
+        if (process->exitStatus() != QProcess::NormalExit || process->exitCode() != 0)
+        {
+            qCritical() << "Ranga" << r << "zakończyła się błędem" << process->exitCode();
+            result = 1;
+        }
+    }
+    qDeleteAll(processes);
+    return result;
+}
+
+static QJsonObject toJson(const DistributedSample& sample, double initialEnergy)
+{
+    QJsonObject object;
+    object["step"] = static_cast<qint64>(sample.step);
+    object["bodies"] = sample.bodyCount;
+    object["min_rank_bodies"] = sample.minRankBodies;
+    object["max_rank_bodies"] = sample.maxRankBodies;
+    object["imported_sources"] = sample.importedSources;
+    object["energy"] = sample.kinetic + sample.potential;
+    object["energy_drift"] = (sample.kinetic + sample.potential - initialEnergy) / std::fabs(initialEnergy);
+    object["momentum_x"] = sample.momentumX;
+    object["momentum_y"] = sample.momentumY;
+    object["max_force_ms"] = sample.maxForceMilliseconds;
+    object["mean_force_ms"] = sample.meanForceMilliseconds;
+    return object;
+}
+
+static int runRank(Scenario& scenario, const RunOptions& options)
+{
+    UnixSocketTransport transport;
+    if (!transport.connect(options.socketDirectory.toStdString(), options.rank, options.ranks, 30000))
+    {
+        qCritical() << "Ranga" << options.rank << "nie połączyła się z pozostałymi";
+        return 2;
+    }
+
+    DistributedSimulation simulation(&transport);
+    simulation.setGForce(scenario.getGForce());
+    simulation.setSoftening(scenario.getSoftening());
+    simulation.setBoundaryPolicy(scenario.getBoundaryPolicy());
+    simulation.setBounds(scenario.getBounds());
+    simulation.setOpeningAngle(options.openingAngle);
+    simulation.setRebalanceInterval(options.rebalanceInterval);
+    simulation.setThreadCount(options.threads);
+    simulation.load(scenario.getBodies());
+
+    bool leader = options.rank == 0;
+    QTextStream out(stdout);
+    QJsonArray samples;
+    DistributedSample sample;
+    if (!simulation.measure(sample))
+        return 1;
+    double initialEnergy = sample.kinetic + sample.potential;
+    if (leader)
+    {
+        out << scenario.getName() << ": " << sample.bodyCount << " obiektów, " << options.ranks << " rang, "
+            << options.steps << " kroków\n";
+        out << QString("%1 %2 %3 %4 %5 %6 %7\n").arg("krok", 8).arg("obiekty", 8).arg("min/max na rangę", 18)
+                   .arg("importy", 9).arg("siły max [ms]", 14).arg("siły śr [ms]", 13).arg("dE/E0", 11);
+        samples.append(toJson(sample, initialEnergy));
+    }
+
+    for (int step = 1; step <= options.steps; ++step)
+    {
+        if (!simulation.step(scenario.getTimeStep()))
+        {
+            qCritical() << "Ranga" << options.rank << "straciła połączenie w kroku" << step;
+            return 1;
+        }
+        if (step % options.reportInterval != 0 && step != options.steps)
+            continue;
+
+        if (!simulation.measure(sample))
+            return 1;
+        if (leader)
+        {
+            out << QString("%1 %2 %3 %4 %5 %6 %7\n").arg(step, 8).arg(sample.bodyCount, 8)
+                       .arg(QString("%1/%2").arg(sample.minRankBodies).arg(sample.maxRankBodies), 18)
+                       .arg(sample.importedSources, 9).arg(sample.maxForceMilliseconds, 14, 'f', 2)
+                       .arg(sample.meanForceMilliseconds, 13, 'f', 2)
+                       .arg((sample.kinetic + sample.potential - initialEnergy) / std::fabs(initialEnergy), 11, 'g', 3);
+            out.flush();
+            samples.append(toJson(sample, initialEnergy));
+        }
+    }
+
+    std::vector<DistributedBody> bodies;
+    if (!simulation.gather(bodies))
+        return 1;
+    if (leader && !options.jsonPath.isEmpty())
+    {
+        QJsonArray list;
+        for (const DistributedBody& body : bodies)
+        {
+            QJsonObject object;
+            object["name"] = scenario.getBodies()[body.id].name;
+            object["x"] = body.x;
+            object["y"] = body.y;
+            object["vx"] = body.vx;
+            object["vy"] = body.vy;
+            list.append(object);
+        }
+        QJsonObject root;
+        root["scenario"] = scenario.getName();
+        root["ranks"] = options.ranks;
+        root["samples"] = samples;
+        root["bodies"] = list;
+        QFile file(options.jsonPath);
+        if (!file.open(QIODevice::WriteOnly | QIODevice::Truncate))
+        {
+            qCritical() << "Nie można zapisać" << options.jsonPath;
+            return 2;
+        }
+        file.write(QJsonDocument(root).toJson());
+    }
+    return 0;
+}
+
+int main(int argc, char *argv[])
+{
+    QCoreApplication a(argc, argv);
+    QCommandLineParser parser;
+    parser.setApplicationDescription("Symulacja jednego scenariusza rozdzielona na kilka procesów (rang) połączonych gniazdami Unix.\n"
+                                     "Każda ranga liczy ciała swojej domeny (bisekcja ORB, okresowo wyważana zmierzonym kosztem sił);\n"
+                                     "zderzenia między rangami nie są rozwiązywane.");
+    parser.addHelpOption();
+    parser.addPositionalArgument("scenario", "Plik scenariusza JSON.");
+    QCommandLineOption ranksOption("ranks", "Liczba rang (procesów).", "n", "2");
+    QCommandLineOption stepsOption("steps", "Liczba kroków; domyślnie duration / time_step scenariusza.", "n");
+    QCommandLineOption rebalanceOption("rebalance", "Co ile kroków wyważać domeny (0 - nigdy).", "n", "50");
+    QCommandLineOption reportOption("report", "Co ile kroków wypisywać podsumowanie.", "n", "100");
+    QCommandLineOption angleOption("opening-angle", "Kąt otwarcia: komórki mniejsze względem odległości są wysyłane jako środek masy.",
+                                   "theta", "0.5");
+    QCommandLineOption threadsOption("threads", "Wątki na rangę; domyślnie rdzenie / rangi.", "n");
+    QCommandLineOption jsonOption("json", "Zapisz próbki i końcowy stan do pliku JSON.", "file");
+    QCommandLineOption rankOption("rank", "Numer rangi (ustawiany przez koordynatora).", "r");
+    QCommandLineOption socketOption("socket-dir", "Katalog gniazd (ustawiany przez koordynatora).", "dir");
+    rankOption.setFlags(QCommandLineOption::HiddenFromHelp);
+    socketOption.setFlags(QCommandLineOption::HiddenFromHelp);
+    parser.addOption(ranksOption);
+    parser.addOption(stepsOption);
+    parser.addOption(rebalanceOption);
+    parser.addOption(reportOption);
+    parser.addOption(angleOption);
+    parser.addOption(threadsOption);
+    parser.addOption(jsonOption);
+    parser.addOption(rankOption);
+    parser.addOption(socketOption);
+    parser.process(a);
+
+    if (parser.positionalArguments().size() != 1)
+        parser.showHelp(2);
+
+    Scenario scenario;
+    QString error;
+    if (!scenario.load(parser.positionalArguments().first(), &error))
+    {
+        qCritical() << error;
+        return 2;
+    }
+
+    RunOptions options;
+    options.ranks = std::max(1, parser.value(ranksOption).toInt());
+    options.rank = parser.isSet(rankOption) ? parser.value(rankOption).toInt() : -1;
+    options.socketDirectory = parser.value(socketOption);
+    options.steps = parser.isSet(stepsOption) ? parser.value(stepsOption).toInt()
+                                              : static_cast<int>(std::lround(scenario.getDuration() / scenario.getTimeStep()));
+    options.rebalanceInterval = parser.value(rebalanceOption).toInt();
+    options.reportInterval = std::max(1, parser.value(reportOption).toInt());
+    options.openingAngle = parser.value(angleOption).toDouble();
+    int cores = static_cast<int>(std::max(1u, std::thread::hardware_concurrency()));
+    options.threads = parser.isSet(threadsOption) ? parser.value(threadsOption).toInt() : std::max(1, cores / options.ranks);
+    options.jsonPath = parser.value(jsonOption);
+
+    if (options.rank < 0)
+        return launchRanks(options);
+    return runRank(scenario, options);
+}
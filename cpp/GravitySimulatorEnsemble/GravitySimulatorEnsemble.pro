@@ -0,0 +1,13 @@
+QT       += core gui widgets
+
+CONFIG += c++17 console
+CONFIG -= app_bundle
+
+# Parameter sweeps: gravsim-ensemble scenario.json [--sweep sweep.json] [--jobs n] [--output results.jsonl]
+
+TARGET = gravsim-ensemble
+
+SOURCES += \
+    main.cpp
+
+include(../GravitySimulatorQt/gravitysimulator.pri)
@@ -0,0 +1,297 @@
+#include <QCommandLineParser>
+#include <QCoreApplication>
+#include <QDebug>
+#include <QElapsedTimer>
+#include <QFile>
+#include <QJsonArray>
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <QTextStream>
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <mutex>
+#include <thread>
+#include <vector>
+#include "scenario.h"
+#include "simulationcontroller.h"
+
+// One swept setting: a dotted path into the scenario JSON ("gforce", "generate.seed") and its values.
+struct SweepParameter {
+    QString path;
+    QJsonArray values;
+};
+
+struct EnsembleRun {
+    int index;
+    QJsonObject parameters;
+    QJsonObject scenario;
+};
+
+// A list, a single value, or {"from", "to", "count"} evenly spaced with both ends included.
+static bool parseValues(const QString& path, const QJsonValue& spec, QJsonArray& values, QString* error)
+{
+    if (spec.isArray())
+    {
+        values = spec.toArray();
+    }
+    else if (spec.isObject())
+    {
+        QJsonObject range = spec.toObject();
+        int count = range["count"].toInt();
+        double from = range["from"].toDouble();
+        double to = range["to"].toDouble(from);
+        if (!range.contains("from") || count < 1)
+        {
+            *error = QString("sweep.%1: zakres wymaga from i count >= 1").arg(path);
+            return false;
+        }
+        for (int i = 0; i < count; ++i)
+            values.append(count == 1 ? from : from + (to - from) * i / (count - 1));
+    }
+    else
+    {
+        values = QJsonArray{spec};
+    }
+
+    if (values.isEmpty())
+    {
+        *error = QString("sweep.%1: pusta lista wartości").arg(path);
+        return false;
+    }
+    return true;
+}
+
+// "grid" runs every combination, the last parameter varying fastest; "zip" pairs the i-th values of all lists.
+static bool parseSweep(const QJsonObject& sweep, QList<SweepParameter>& parameters, bool& zip, QString* error)
+{
+    QString mode = sweep["mode"].toString("grid");
+    if (mode != "grid" && mode != "zip")
+    {
+        *error = QString("nieznany tryb przeglądu '%1' (grid, zip)").arg(mode);
+        return false;
+    }
+    zip = mode == "zip";
+
+    QJsonObject spec = sweep["parameters"].toObject();
+    for (const QString& path : spec.keys())
+    {
+        SweepParameter parameter{path, QJsonArray()};
+        if (!parseValues(path, spec[path], parameter.values, error))
+            return false;
+        if (zip && !parameters.isEmpty() && parameter.values.size() != parameters.first().values.size())
+        {
+            *error = QString("sweep.%1: w trybie zip wszystkie listy muszą mieć tę samą długość").arg(path);
+            return false;
+        }
+        parameters.append(parameter);
+    }
+    if (parameters.isEmpty())
+    {
+        *error = "sweep.parameters nie zawiera żadnych parametrów";
+        return false;
+    }
+    return true;
+}
+
+static void setPath(QJsonObject& object, const QStringList& keys, int depth, const QJsonValue& value)
+{
+    if (depth == keys.size() - 1)
+    {
+        object[keys[depth]] = value;
+        return;
+    }
+    QJsonObject child = object[keys[depth]].toObject();
+    setPath(child, keys, depth + 1, value);
+    object[keys[depth]] = child;
+}
+
+static QList<EnsembleRun> expand(QJsonObject base, const QList<SweepParameter>& parameters, bool zip)
+{
+    base.remove("sweep");
+    int count = zip ? parameters.first().values.size() : 1;
+    if (!zip)
+    {
+        for (const SweepParameter& parameter : parameters)
+            count *= parameter.values.size();
+    }
+
+    QList<EnsembleRun> runs;
+    for (int index = 0; index < count; ++index)
+    {
+        EnsembleRun run{index, QJsonObject(), base};
+        int rest = index;
+        for (int p = parameters.size() - 1; p >= 0; --p)
+        {
+            const SweepParameter& parameter = parameters[p];
+            QJsonValue value = parameter.values[zip ? index : rest % parameter.values.size()];
+            rest /= parameter.values.size();
+            run.parameters[parameter.path] = value;
+            setPath(run.scenario, parameter.path.split('.'), 0, value);
+        }
+        runs.append(run);
+    }
+    return runs;
+}
+
+static double relativeChange(double start, double end)
+{
+    return start != 0.0 ? (end - start) / std::fabs(start) : 0.0;
+}
+
+// Runs one member of the ensemble start to finish on the calling thread. The controller is its own and set to
+// a single thread, so concurrent runs share nothing but the results file.
+static QJsonObject runMember(const EnsembleRun& run)
+{
+    QJsonObject record;
+    record["run"] = run.index;
+    record["parameters"] = run.parameters;
+
+    Scenario scenario;
+    QString error;
+    QString integratorName = run.scenario["integrator"].toString("leapfrog");
+    if (!scenario.fromJson(run.scenario, &error))
+    {
+        record["error"] = error;
+        return record;
+    }
+    if (integratorName != "euler" && integratorName != "leapfrog")
+    {
+        record["error"] = QString("nieznany integrator '%1' (euler, leapfrog)").arg(integratorName);
+        return record;
+    }
+
+    SimulationController controller(nullptr, QPoint(500, 500), QPoint(100, 100), 6.67408, false, 1.0, 0.0, true, nullptr);
+    controller.setThreadCount(1);
+    scenario.apply(&controller);
+    controller.setIntegrator(integratorName == "euler" ? Integrator::Euler : Integrator::Leapfrog);
+
+    DiagnosticsSample start = controller.measureDiagnostics();
+    int steps = static_cast<int>(std::lround(scenario.getDuration() / scenario.getTimeStep()));
+    QElapsedTimer timer;
+    timer.start();
+    for (int step = 0; step < steps; ++step)
+        controller.nextFrame(scenario.getTimeStep());
+    double seconds = timer.nsecsElapsed() / 1e9;
+    DiagnosticsSample end = controller.measureDiagnostics();
+
+    // Changes over the whole run, merges and escapes included; a restitution below one shows up here.
+    double momentumScale = std::hypot(start.momentumX, start.momentumY);
+    record["steps"] = steps;
+    record["seconds"] = seconds;
+    record["bodies_initial"] = start.bodyCount;
+    record["bodies_final"] = end.bodyCount;
+    record["escaped"] = controller.getEscapeTally().count;
+    record["tracers"] = controller.getTestParticles().getCount();
+    record["energy_change"] = relativeChange(start.energy, end.energy);
+    record["momentum_change"] = std::hypot(end.momentumX - start.momentumX, end.momentumY - start.momentumY) /
+                                (momentumScale > 0.0 ? momentumScale : 1.0);
+    record["angular_momentum_change"] = relativeChange(start.angularMomentum, end.angularMomentum);
+    record["virial_ratio"] = end.virialRatio;
+    return record;
+}
+
+int main(int argc, char *argv[])
+{
+    QCoreApplication a(argc, argv);
+    QCommandLineParser parser;
+    parser.setApplicationDescription("Uruchamia zestaw niezależnych symulacji jednego scenariusza dla wszystkich kombinacji parametrów\n"
+                                     "z sekcji \"sweep\" (np. gforce, time_step, restitution, generate.seed), po jednej na rdzeń,\n"
+                                     "i dopisuje podsumowanie każdej zakończonej do pliku wyników (jeden obiekt JSON na wiersz).");
+    parser.addHelpOption();
+    parser.addPositionalArgument("scenario", "Plik scenariusza JSON.");
+    QCommandLineOption sweepOption("sweep", "Plik JSON z opisem przeglądu zamiast sekcji \"sweep\" scenariusza.", "file");
+    QCommandLineOption jobsOption("jobs", "Liczba jednocześnie liczonych symulacji; domyślnie liczba rdzeni.", "n");
+    QCommandLineOption outputOption("output", "Plik wyników (JSON Lines).", "file", "ensemble.jsonl");
+    parser.addOption(sweepOption);
+    parser.addOption(jobsOption);
+    parser.addOption(outputOption);
+    parser.process(a);
+
+    if (parser.positionalArguments().size() != 1)
+        parser.showHelp(2);
+
+    QString path = parser.positionalArguments().first();
+    Scenario scenario;
+    QString error;
+    if (!scenario.load(path, &error))
+    {
+        qCritical() << error;
+        return 2;
+    }
+
+    QJsonObject sweep = scenario.getSettings()["sweep"].toObject();
+    if (parser.isSet(sweepOption))
+    {
+        QFile file(parser.value(sweepOption));
+        if (!file.open(QIODevice::ReadOnly))
+        {
+            qCritical() << "Nie można otworzyć" << parser.value(sweepOption);
+            return 2;
+        }
+        sweep = QJsonDocument::fromJson(file.readAll()).object();
+    }
+
+    QList<SweepParameter> parameters;
+    bool zip = false;
+    if (!parseSweep(sweep, parameters, zip, &error))
+    {
+        qCritical() << error;
+        return 2;
+    }
+
+    QList<EnsembleRun> runs = expand(scenario.getSettings(), parameters, zip);
+    int runCount = static_cast<int>(runs.size());
+
+    QFile results(parser.value(outputOption));
+    if (!results.open(QIODevice::WriteOnly | QIODevice::Truncate))
+    {
+        qCritical() << "Nie można zapisać" << parser.value(outputOption);
+        return 2;
+    }
+
+    int cores = static_cast<int>(std::max(1u, std::thread::hardware_concurrency()));
+    int jobs = std::min(runCount, parser.isSet(jobsOption) ? std::max(1, parser.value(jobsOption).toInt()) : cores);
+    QTextStream out(stdout);
+    out << scenario.getName() << ": " << runCount << " symulacji, " << jobs << " naraz\n";
+    out.flush();
+
+    // Workers take the next run from a shared counter, so long and short runs balance out; a finished run is
+    // written and flushed at once, in completion order, and a crash loses only the runs still in flight.
+    std::atomic<int> next(0);
+    std::mutex resultsLock;
+    int finished = 0;
+    int failed = 0;
+    std::vector<std::thread> workers;
+    for (int w = 0; w < jobs; ++w)
+    {
+        workers.emplace_back([&] {
+            for (int i = next++; i < runCount; i = next++)
+            {
+                QJsonObject record = runMember(runs[i]);
+                QByteArray line = QJsonDocument(record).toJson(QJsonDocument::Compact) + "\n";
+                std::lock_guard<std::mutex> lock(resultsLock);
+                results.write(line);
+                results.flush();
+                ++finished;
+                if (record.contains("error"))
+                {
+                    ++failed;
+                    out << QString("%1/%2 symulacja %3: %4\n").arg(finished).arg(runCount).arg(i)
+                               .arg(record["error"].toString());
+                }
+                else
+                {
+                    out << QString("%1/%2 symulacja %3: %4 s, dE/E0 %5\n").arg(finished).arg(runCount).arg(i)
+                               .arg(record["seconds"].toDouble(), 0, 'f', 2).arg(record["energy_change"].toDouble(), 0, 'g', 3);
+                }
+                out.flush();
+            }
+        });
+    }
+    for (std::thread& worker : workers)
+        worker.join();
+
+    out << failed << " symulacji zakończonych błędem\n";
+    return failed > 0 ? 1 : 0;
+}
@@ -0,0 +1,27 @@
+QT       += core gui widgets
+
+TEMPLATE = lib
+CONFIG += c++17 plugin no_plugin_name_prefix
+CONFIG -= app_bundle
+
+# Python extension module: build, put gravsim.so (gravsim.pyd on Windows) on PYTHONPATH, then "import gravsim".
+# PYTHON selects the interpreter to build for: qmake PYTHON=python3.12
+
+TARGET = gravsim
+
+isEmpty(PYTHON): PYTHON = python3
+win32 {
+    QMAKE_EXTENSION_SHLIB = pyd
+    INCLUDEPATH += $$system($$PYTHON -c \"import sysconfig; print(sysconfig.get_paths()['include'])\")
+    LIBS += -L$$system($$PYTHON -c \"import sys, os; print(os.path.join(sys.base_prefix, 'libs'))\")
+} else {
+    QMAKE_EXTENSION_SHLIB = so
+    QMAKE_CXXFLAGS += $$system($$PYTHON-config --includes)
+    # The interpreter provides the Python symbols when it loads the module.
+    macx: QMAKE_LFLAGS_PLUGIN += -undefined dynamic_lookup
+}
+
+SOURCES += \
+    gravsimmodule.cpp
+
+include(../GravitySimulatorQt/gravitysimulator.pri)
@@ -0,0 +1,631 @@
+// Python.h has to come first, and before Qt defines its slots macro, which clashes with a CPython field name.
+#define PY_SSIZE_T_CLEAN
+#include <Python.h>
+#include <cstring>
+#include <new>
+#include <memory>
+#include <vector>
+#include "scenario.h"
+#include "simulationcontroller.h"
+
+enum class Column { X, Y, VelocityX, VelocityY, Mass, Radius, Id, TracerX, TracerY, TracerVelocityX, TracerVelocityY };
+
+static const int bodyColumnCount = 6;
+
+// Engine state behind a gravsim.Simulation. Bodies live in the controller's pool, one object per slot, so they
+// are mirrored in flat columns that Python views without copying: edits made through the views are written back
+// before the next step, and the columns are refreshed after it. Tracers are flat already and are shown directly.
+// Columns only grow while no view is exported, so an exported view never points at freed memory; after a step
+// that merged or dropped bodies its tail is stale and the view should be fetched again.
+struct SimulationState {
+    std::unique_ptr<SimulationController> controller;
+    std::vector<double> columns[bodyColumnCount];
+    std::vector<unsigned long long> ids;
+    int threadCount;
+    int exports;
+    bool stepping;
+};
+
+struct PySimulation {
+    PyObject_HEAD
+    SimulationState* state;
+};
+
+// One column handed to memoryview or numpy; keeps its simulation alive while the view exists.
+struct PyColumn {
+    PyObject_HEAD
+    PySimulation* owner;
+    Column column;
+    Py_ssize_t shape;
+    Py_ssize_t stride;
+};
+
+static PyTypeObject* columnType = nullptr;
+
+static void pullBodies(SimulationState& s)
+{
+    QList<SimulationObject*>& objects = s.controller->getSimulationObjects();
+    size_t n = objects.size();
+    for (std::vector<double>& column : s.columns)
+        column.resize(n);
+    s.ids.resize(n);
+    for (size_t i = 0; i < n; ++i)
+    {
+        SimulationObject* o = objects[static_cast<int>(i)];
+        s.columns[static_cast<int>(Column::X)][i] = o->getPosition().first;
+        s.columns[static_cast<int>(Column::Y)][i] = o->getPosition().second;
+        s.columns[static_cast<int>(Column::VelocityX)][i] = o->getVelocity().first;
+        s.columns[static_cast<int>(Column::VelocityY)][i] = o->getVelocity().second;
+        s.columns[static_cast<int>(Column::Mass)][i] = o->getMass();
+        s.columns[static_cast<int>(Column::Radius)][i] = o->getRadius();
+        s.ids[i] = o->getId();
+    }
+}
+
+// Writes edits made through the views into the bodies as one editBodies() batch of the rows that changed.
+static void pushBodies(SimulationState& s)
+{
+    QList<SimulationObject*>& objects = s.controller->getSimulationObjects();
+    if (static_cast<size_t>(objects.size()) != s.ids.size())
+        return;
+
+    const std::vector<double>* c = s.columns;
+    std::vector<BodyEdit> edits;
+    for (size_t i = 0; i < s.ids.size(); ++i)
+    {
+        SimulationObject* o = objects[static_cast<int>(i)];
+        double x = c[static_cast<int>(Column::X)][i], y = c[static_cast<int>(Column::Y)][i];
+        double vx = c[static_cast<int>(Column::VelocityX)][i], vy = c[static_cast<int>(Column::VelocityY)][i];
+        double mass = c[static_cast<int>(Column::Mass)][i], radius = c[static_cast<int>(Column::Radius)][i];
+        if (o->getPosition() != std::make_pair(x, y) || o->getMass() != mass || o->getRadius() != radius ||
+            o->getVelocity() != std::make_pair(vx, vy))
+            edits.push_back({o, {x, y}, {vx, vy}, mass, radius});
+    }
+    if (!edits.empty())
+        s.controller->editBodies(edits);
+}
+
+static bool checkIdle(PySimulation* self)
+{
+    if (self->state->stepping)
+    {
+        PyErr_SetString(PyExc_RuntimeError, "symulacja wykonuje właśnie step() w innym wątku");
+        return false;
+    }
+    return true;
+}
+
+// Adding may move the columns and tracer arrays, which exported views still point at.
+static bool checkNoExports(PySimulation* self)
+{
+    if (self->state->exports > 0)
+    {
+        PyErr_SetString(PyExc_BufferError, "najpierw zwolnij widoki tablic (memoryview, numpy) tej symulacji");
+        return false;
+    }
+    return true;
+}
+
+// A column argument: a 1-D float64 buffer (numpy array, array('d')), any sequence of numbers, or one number
+// used for every row.
+struct ColumnArgument {
+    std::vector<double> values;
+    bool scalar;
+};
+
+static bool readColumn(PyObject* object, const char* name, ColumnArgument& argument)
+{
+    argument.scalar = PyFloat_Check(object) || PyLong_Check(object);
+    if (argument.scalar)
+    {
+        argument.values.assign(1, PyFloat_AsDouble(object));
+        return !PyErr_Occurred();
+    }
+
+    Py_buffer view;
+    if (PyObject_CheckBuffer(object) && PyObject_GetBuffer(object, &view, PyBUF_C_CONTIGUOUS | PyBUF_FORMAT) == 0)
+    {
+        bool doubles = view.ndim == 1 && view.format && std::strcmp(view.format, "d") == 0;
+        if (doubles)
+        {
+            const double* data = static_cast<const double*>(view.buf);
+            argument.values.assign(data, data + view.len / sizeof(double));
+        }
+        PyBuffer_Release(&view);
+        if (doubles)
+            return true;
+    }
+    PyErr_Clear();
+
+    PyObject* sequence = PySequence_Fast(object, "");
+    if (!sequence)
+    {
+        PyErr_Format(PyExc_TypeError, "%s: oczekiwano liczby, tablicy lub sekwencji liczb", name);
+        return false;
+    }
+    Py_ssize_t n = PySequence_Fast_GET_SIZE(sequence);
+    argument.values.resize(n);
+    for (Py_ssize_t i = 0; i < n; ++i)
+        argument.values[i] = PyFloat_AsDouble(PySequence_Fast_GET_ITEM(sequence, i));
+    Py_DECREF(sequence);
+    return !PyErr_Occurred();
+}
+
+// Reads the columns and broadcasts the scalars; every array has to have the same length. Only scalars make a
+// single row, so empty arrays give none.
+static bool readColumns(PyObject* const* objects, const char* const* names, int count, std::vector<ColumnArgument>& arguments,
+                        Py_ssize_t& rows)
+{
+    arguments.resize(count);
+    rows = -1;
+    for (int c = 0; c < count; ++c)
+    {
+        if (!readColumn(objects[c], names[c], arguments[c]))
+            return false;
+        if (arguments[c].scalar)
+            continue;
+        Py_ssize_t n = static_cast<Py_ssize_t>(arguments[c].values.size());
+        if (rows >= 0 && n != rows)
+        {
+            PyErr_Format(PyExc_ValueError, "%s: długość %zd, a poprzednie kolumny mają %zd", names[c], n, rows);
+            return false;
+        }
+        rows = n;
+    }
+    if (rows < 0)
+        rows = 1;
+    for (ColumnArgument& argument : arguments)
+    {
+        if (argument.scalar)
+            argument.values.assign(rows, argument.values[0]);
+    }
+    return true;
+}
+
+static bool loadScenario(SimulationState& s, const char* path)
+{
+    Scenario scenario;
+    QString error;
+    if (!scenario.load(QString::fromUtf8(path), &error))
+    {
+        PyErr_SetString(PyExc_ValueError, error.toUtf8().constData());
+        return false;
+    }
+    scenario.apply(s.controller.get());
+    pullBodies(s);
+    return true;
+}
+
+static PyObject* simulationNew(PyTypeObject* type, PyObject*, PyObject*)
+{
+    PySimulation* self = reinterpret_cast<PySimulation*>(type->tp_alloc(type, 0));
+    if (!self)
+        return nullptr;
+    self->state = new SimulationState();
+    self->state->controller.reset(new SimulationController(nullptr, QPoint(500, 500), QPoint(100, 100), 6.67408, false, 1.0,
+                                                           0.0, true, nullptr));
+    self->state->controller->setIntegrator(Integrator::Leapfrog);
+    self->state->threadCount = 0;
+    self->state->exports = 0;
+    self->state->stepping = false;
+    return reinterpret_cast<PyObject*>(self);
+}
+
+static void simulationDealloc(PySimulation* self)
+{
+    PyTypeObject* type = Py_TYPE(self);
+    delete self->state;
+    type->tp_free(reinterpret_cast<PyObject*>(self));
+    Py_DECREF(type);
+}
+
+static int simulationInit(PySimulation* self, PyObject* args, PyObject* kwargs)
+{
+    static const char* keywords[] = {"scenario", nullptr};
+    const char* path = nullptr;
+    if (!PyArg_ParseTupleAndKeywords(args, kwargs, "|z", const_cast<char**>(keywords), &path))
+        return -1;
+    if (path && (!checkIdle(self) || !checkNoExports(self) || !loadScenario(*self->state, path)))
+        return -1;
+    return 0;
+}
+
+static PyObject* simulationLoad(PySimulation* self, PyObject* args)
+{
+    const char* path;
+    if (!PyArg_ParseTuple(args, "s", &path) || !checkIdle(self) || !checkNoExports(self) || !loadScenario(*self->state, path))
+        return nullptr;
+    Py_RETURN_NONE;
+}
+
+static PyObject* simulationClear(PySimulation* self, PyObject*)
+{
+    if (!checkIdle(self))
+        return nullptr;
+    SimulationController& controller = *self->state->controller;
+    double gforce = controller.getGForce();
+    controller.resetSimulation();
+    controller.setGForce(gforce);
+    pullBodies(*self->state);
+    Py_RETURN_NONE;
+}
+
+static PyObject* simulationAddBodies(PySimulation* self, PyObject* args, PyObject* kwargs)
+{
+    static const char* keywords[] = {"x", "y", "vx", "vy", "mass", "radius", nullptr};
+    PyObject* objects[bodyColumnCount] = {nullptr, nullptr, nullptr, nullptr, nullptr, nullptr};
+    PyObject* zero = PyFloat_FromDouble(0.0);
+    PyObject* defaultMass = PyFloat_FromDouble(10.0);
+    PyObject* defaultRadius = PyFloat_FromDouble(1.0);
+    objects[2] = objects[3] = zero;
+    objects[4] = defaultMass;
+    objects[5] = defaultRadius;
+
+    std::vector<ColumnArgument> columns;
+    Py_ssize_t rows = 0;
+    bool ok = PyArg_ParseTupleAndKeywords(args, kwargs, "OO|OOOO", const_cast<char**>(keywords), &objects[0], &objects[1],
+                                          &objects[2], &objects[3], &objects[4], &objects[5]) &&
+              checkIdle(self) && checkNoExports(self) && readColumns(objects, keywords, bodyColumnCount, columns, rows);
+    Py_DECREF(zero);
+    Py_DECREF(defaultMass);
+    Py_DECREF(defaultRadius);
+    if (!ok)
+        return nullptr;
+
+    SimulationState& s = *self->state;
+    pushBodies(s);
+    int first = static_cast<int>(s.controller->getSimulationObjects().size());
+    for (Py_ssize_t i = 0; i < rows; ++i)
+    {
+        s.controller->addSimulationObject(QString("b%1").arg(first + static_cast<int>(i)),
+                                          {columns[0].values[i], columns[1].values[i]},
+                                          {columns[2].values[i], columns[3].values[i]}, columns[5].values[i],
+                                          columns[4].values[i]);
+    }
+    pullBodies(s);
+    Py_RETURN_NONE;
+}
+
+static PyObject* simulationAddTracers(PySimulation* self, PyObject* args, PyObject* kwargs)
+{
+    static const char* keywords[] = {"x", "y", "vx", "vy", nullptr};
+    PyObject* zero = PyFloat_FromDouble(0.0);
+    PyObject* objects[4] = {nullptr, nullptr, zero, zero};
+    std::vector<ColumnArgument> columns;
+    Py_ssize_t rows = 0;
+    bool ok = PyArg_ParseTupleAndKeywords(args, kwargs, "OO|OO", const_cast<char**>(keywords), &objects[0], &objects[1],
+                                          &objects[2], &objects[3]) &&
+              checkIdle(self) && checkNoExports(self) && readColumns(objects, keywords, 4, columns, rows);
+    Py_DECREF(zero);
+    if (!ok)
+        return nullptr;
+
+    for (Py_ssize_t i = 0; i < rows; ++i)
+    {
+        self->state->controller->addTestParticle({columns[0].values[i], columns[1].values[i]},
+                                                 {columns[2].values[i], columns[3].values[i]});
+    }
+    Py_RETURN_NONE;
+}
+
+// The steps run without the GIL, so other Python threads (and other simulations) keep going meanwhile.
+static PyObject* simulationStep(PySimulation* self, PyObject* args)
+{
+    long long count = 1;
+    if (!PyArg_ParseTuple(args, "|L", &count) || !checkIdle(self))
+        return nullptr;
+    if (count < 0)
+    {
+        PyErr_SetString(PyExc_ValueError, "liczba kroków nie może być ujemna");
+        return nullptr;
+    }
+
+    SimulationState& s = *self->state;
+    pushBodies(s);
+    s.stepping = true;
+    bool failed = false;
+    Py_BEGIN_ALLOW_THREADS
+    try
+    {
+        double timeStep = s.controller->getTimeStep();
+        for (long long i = 0; i < count; ++i)
+            s.controller->nextFrame(timeStep);
+    }
+    catch (const std::bad_alloc&)
+    {
+        failed = true;
+    }
+    Py_END_ALLOW_THREADS
+    s.stepping = false;
+    pullBodies(s);
+    if (failed)
+        return PyErr_NoMemory();
+    Py_RETURN_NONE;
+}
+
+static PyObject* simulationDiagnostics(PySimulation* self, PyObject*)
+{
+    if (!checkIdle(self))
+        return nullptr;
+    pushBodies(*self->state);
+    DiagnosticsSample sample = self->state->controller->measureDiagnostics();
+    return Py_BuildValue("{s:K,s:d,s:i,s:d,s:d,s:d,s:d,s:d,s:d,s:d,s:d,s:d,s:d}", "step",
+                         static_cast<unsigned long long>(sample.step), "time", sample.time, "bodies", sample.bodyCount,
+                         "kinetic", sample.kinetic, "potential", sample.potential, "energy", sample.energy, "momentum_x",
+                         sample.momentumX, "momentum_y", sample.momentumY, "angular_momentum", sample.angularMomentum,
+                         "virial_ratio", sample.virialRatio, "energy_drift", sample.energyDrift, "momentum_drift",
+                         sample.momentumDrift, "angular_momentum_drift", sample.angularMomentumDrift);
+}
+
+static PyObject* makeColumn(PySimulation* self, Column column)
+{
+    PyColumn* result = PyObject_New(PyColumn, columnType);
+    if (!result)
+        return nullptr;
+    Py_INCREF(self);
+    result->owner = self;
+    result->column = column;
+    result->shape = 0;
+    result->stride = 0;
+    PyObject* view = PyMemoryView_FromObject(reinterpret_cast<PyObject*>(result));
+    Py_DECREF(result);
+    return view;
+}
+
+static PyObject* simulationGetColumn(PySimulation* self, void* closure)
+{
+    return makeColumn(self, static_cast<Column>(reinterpret_cast<intptr_t>(closure)));
+}
+
+static PyObject* simulationGetBodyCount(PySimulation* self, void*)
+{
+    return PyLong_FromSsize_t(static_cast<Py_ssize_t>(self->state->ids.size()));
+}
+
+static PyObject* simulationGetTracerCount(PySimulation* self, void*)
+{
+    return PyLong_FromLong(self->state->controller->getTestParticles().getCount());
+}
+
+static PyObject* simulationGetTime(PySimulation* self, void*)
+{
+    return PyFloat_FromDouble(self->state->controller->getSimulationTime());
+}
+
+static PyObject* simulationGetStepCount(PySimulation* self, void*)
+{
+    return PyLong_FromUnsignedLongLong(self->state->controller->getStepCount());
+}
+
+static PyObject* simulationGetGForce(PySimulation* self, void*)
+{
+    return PyFloat_FromDouble(self->state->controller->getGForce());
+}
+
+static int simulationSetGForce(PySimulation* self, PyObject* value, void*)
+{
+    double gforce = value ? PyFloat_AsDouble(value) : 0.0;
+    if (!value || PyErr_Occurred() || !checkIdle(self))
+        return -1;
+    self->state->controller->setGForce(gforce);
+    self->state->controller->invalidateForces();
+    return 0;
+}
+
+static PyObject* simulationGetTimeStep(PySimulation* self, void*)
+{
+    return PyFloat_FromDouble(self->state->controller->getTimeStep());
+}
+
+static int simulationSetTimeStep(PySimulation* self, PyObject* value, void*)
+{
+    double timeStep = value ? PyFloat_AsDouble(value) : 0.0;
+    if (!value || PyErr_Occurred() || !checkIdle(self))
+        return -1;
+    if (!(timeStep > 0.0))
+    {
+        PyErr_SetString(PyExc_ValueError, "time_step musi być dodatni");
+        return -1;
+    }
+    self->state->controller->setTimeStep(timeStep);
+    return 0;
+}
+
+static PyObject* simulationGetIntegrator(PySimulation* self, void*)
+{
+    return PyUnicode_FromString(self->state->controller->getIntegrator() == Integrator::Euler ? "euler" : "leapfrog");
+}
+
+static int simulationSetIntegrator(PySimulation* self, PyObject* value, void*)
+{
+    const char* name = value ? PyUnicode_AsUTF8(value) : nullptr;
+    if (!name || !checkIdle(self))
+        return -1;
+    if (std::strcmp(name, "euler") != 0 && std::strcmp(name, "leapfrog") != 0)
+    {
+        PyErr_Format(PyExc_ValueError, "nieznany integrator '%s' (euler, leapfrog)", name);
+        return -1;
+    }
+    self->state->controller->setIntegrator(std::strcmp(name, "euler") == 0 ? Integrator::Euler : Integrator::Leapfrog);
+    return 0;
+}
+
+// 0 leaves the engine's default of one thread per core.
+static PyObject* simulationGetThreads(PySimulation* self, void*)
+{
+    return PyLong_FromLong(self->state->threadCount);
+}
+
+static int simulationSetThreads(PySimulation* self, PyObject* value, void*)
+{
+    long threads = value ? PyLong_AsLong(value) : 0;
+    if (!value || PyErr_Occurred() || !checkIdle(self))
+        return -1;
+    if (threads <= 0)
+    {
+        PyErr_SetString(PyExc_ValueError, "threads musi być dodatnie");
+        return -1;
+    }
+    self->state->threadCount = static_cast<int>(threads);
+    self->state->controller->setThreadCount(static_cast<int>(threads));
+    return 0;
+}
+
+static void columnDealloc(PyColumn* self)
+{
+    PyTypeObject* type = Py_TYPE(self);
+    Py_DECREF(self->owner);
+    type->tp_free(reinterpret_cast<PyObject*>(self));
+    Py_DECREF(type);
+}
+
+static int columnGetBuffer(PyColumn* self, Py_buffer* view, int flags)
+{
+    SimulationState& s = *self->owner->state;
+    TestParticles& tracers = s.controller->getTestParticles();
+    // Tracers and ids are read-only: the engine keeps them as they are.
+    static double empty = 0.0;
+    bool readOnly = self->column >= Column::Id;
+    void* data = nullptr;
+    Py_ssize_t itemSize = sizeof(double);
+    const char* format = "d";
+    switch (self->column)
+    {
+    case Column::Id:
+        data = s.ids.data();
+        self->shape = static_cast<Py_ssize_t>(s.ids.size());
+        itemSize = sizeof(unsigned long long);
+        format = "Q";
+        break;
+    case Column::TracerX:
+    case Column::TracerY:
+    case Column::TracerVelocityX:
+    case Column::TracerVelocityY:
+    {
+        const std::vector<double>& values = self->column == Column::TracerX ? tracers.getX()
+                                          : self->column == Column::TracerY ? tracers.getY()
+                                          : self->column == Column::TracerVelocityX ? tracers.getVelocityX()
+                                                                                    : tracers.getVelocityY();
+        data = const_cast<double*>(values.data());
+        self->shape = static_cast<Py_ssize_t>(values.size());
+        break;
+    }
+    default:
+        data = s.columns[static_cast<int>(self->column)].data();
+        self->shape = static_cast<Py_ssize_t>(s.columns[static_cast<int>(self->column)].size());
+        break;
+    }
+
+    if (readOnly && (flags & PyBUF_WRITABLE))
+    {
+        PyErr_SetString(PyExc_BufferError, "ta kolumna jest tylko do odczytu");
+        view->obj = nullptr;
+        return -1;
+    }
+    self->stride = itemSize;
+    view->buf = data ? data : &empty;
+    view->obj = reinterpret_cast<PyObject*>(self);
+    Py_INCREF(self);
+    view->len = self->shape * itemSize;
+    view->readonly = readOnly;
+    view->itemsize = itemSize;
+    view->format = (flags & PyBUF_FORMAT) ? const_cast<char*>(format) : nullptr;
+    view->ndim = 1;
+    view->shape = (flags & PyBUF_ND) == PyBUF_ND ? &self->shape : nullptr;
+    view->strides = (flags & PyBUF_STRIDES) == PyBUF_STRIDES ? &self->stride : nullptr;
+    view->suboffsets = nullptr;
+    view->internal = nullptr;
+    ++s.exports;
+    return 0;
+}
+
+static void columnReleaseBuffer(PyColumn* self, Py_buffer*)
+{
+    --self->owner->state->exports;
+}
+
+static PyMethodDef simulationMethods[] = {
+    {"load", reinterpret_cast<PyCFunction>(simulationLoad), METH_VARARGS,
+     "load(path)\n\nZastępuje stan scenariuszem z pliku JSON."},
+    {"clear", reinterpret_cast<PyCFunction>(simulationClear), METH_NOARGS, "Usuwa wszystkie obiekty i znaczniki."},
+    {"add_bodies", reinterpret_cast<PyCFunction>(reinterpret_cast<void (*)()>(simulationAddBodies)), METH_VARARGS | METH_KEYWORDS,
+     "add_bodies(x, y, vx=0, vy=0, mass=10, radius=1)\n\nDodaje obiekty z tablic; liczba zamiast tablicy dotyczy wszystkich."},
+    {"add_tracers", reinterpret_cast<PyCFunction>(reinterpret_cast<void (*)()>(simulationAddTracers)), METH_VARARGS | METH_KEYWORDS,
+     "add_tracers(x, y, vx=0, vy=0)\n\nDodaje bezmasowe znaczniki z tablic."},
+    {"step", reinterpret_cast<PyCFunction>(simulationStep), METH_VARARGS,
+     "step(n=1)\n\nWykonuje n kroków time_step bez blokady GIL."},
+    {"diagnostics", reinterpret_cast<PyCFunction>(simulationDiagnostics), METH_NOARGS,
+     "Energia, pęd i moment pędu obecnego stanu jako słownik."},
+    {nullptr, nullptr, 0, nullptr}};
+
+#define COLUMN(name, column, doc) \
+    {const_cast<char*>(name), reinterpret_cast<getter>(simulationGetColumn), nullptr, const_cast<char*>(doc), \
+     reinterpret_cast<void*>(static_cast<intptr_t>(Column::column))}
+
+static PyGetSetDef simulationGetSet[] = {
+    COLUMN("x", X, "Położenia x obiektów (float64, zapisywalne)."),
+    COLUMN("y", Y, "Położenia y obiektów (float64, zapisywalne)."),
+    COLUMN("vx", VelocityX, "Prędkości x obiektów (float64, zapisywalne)."),
+    COLUMN("vy", VelocityY, "Prędkości y obiektów (float64, zapisywalne)."),
+    COLUMN("mass", Mass, "Masy obiektów (float64, zapisywalne)."),
+    COLUMN("radius", Radius, "Promienie obiektów (float64, zapisywalne)."),
+    COLUMN("id", Id, "Identyfikatory obiektów (uint64); kolejność obiektów zmienia się przy porządkowaniu Mortona."),
+    COLUMN("tracer_x", TracerX, "Położenia x znaczników (float64, tylko do odczytu)."),
+    COLUMN("tracer_y", TracerY, "Położenia y znaczników (float64, tylko do odczytu)."),
+    COLUMN("tracer_vx", TracerVelocityX, "Prędkości x znaczników (float64, tylko do odczytu)."),
+    COLUMN("tracer_vy", TracerVelocityY, "Prędkości y znaczników (float64, tylko do odczytu)."),
+    {const_cast<char*>("body_count"), reinterpret_cast<getter>(simulationGetBodyCount), nullptr, nullptr, nullptr},
+    {const_cast<char*>("tracer_count"), reinterpret_cast<getter>(simulationGetTracerCount), nullptr, nullptr, nullptr},
+    {const_cast<char*>("time"), reinterpret_cast<getter>(simulationGetTime), nullptr, nullptr, nullptr},
+    {const_cast<char*>("step_count"), reinterpret_cast<getter>(simulationGetStepCount), nullptr, nullptr, nullptr},
+    {const_cast<char*>("gforce"), reinterpret_cast<getter>(simulationGetGForce), reinterpret_cast<setter>(simulationSetGForce),
+     nullptr, nullptr},
+    {const_cast<char*>("time_step"), reinterpret_cast<getter>(simulationGetTimeStep),
+     reinterpret_cast<setter>(simulationSetTimeStep), nullptr, nullptr},
+    {const_cast<char*>("integrator"), reinterpret_cast<getter>(simulationGetIntegrator),
+     reinterpret_cast<setter>(simulationSetIntegrator), nullptr, nullptr},
+    {const_cast<char*>("threads"), reinterpret_cast<getter>(simulationGetThreads), reinterpret_cast<setter>(simulationSetThreads),
+     nullptr, nullptr},
+    {nullptr, nullptr, nullptr, nullptr, nullptr}};
+
+#undef COLUMN
+
+static PyModuleDef gravsimModule = {PyModuleDef_HEAD_INIT, "gravsim",
+                                    "Silnik GravitySimulator: symulacja bez interfejsu, stan obiektów jako tablice (protokół bufora).",
+                                    -1, nullptr, nullptr, nullptr, nullptr, nullptr};
+
+// Buffer slots in a type spec need Python 3.9 or newer.
+static PyType_Slot simulationSlots[] = {
+    {Py_tp_doc, const_cast<char*>("Simulation(scenario=None)\n\nSymulacja wczytana z pliku scenariusza JSON albo pusta.")},
+    {Py_tp_new, reinterpret_cast<void*>(simulationNew)},
+    {Py_tp_init, reinterpret_cast<void*>(simulationInit)},
+    {Py_tp_dealloc, reinterpret_cast<void*>(simulationDealloc)},
+    {Py_tp_methods, simulationMethods},
+    {Py_tp_getset, simulationGetSet},
+    {0, nullptr}};
+
+static PyType_Slot columnSlots[] = {
+    {Py_tp_dealloc, reinterpret_cast<void*>(columnDealloc)},
+    {Py_bf_getbuffer, reinterpret_cast<void*>(columnGetBuffer)},
+    {Py_bf_releasebuffer, reinterpret_cast<void*>(columnReleaseBuffer)},
+    {0, nullptr}};
+
+static PyType_Spec simulationSpec = {"gravsim.Simulation", sizeof(PySimulation), 0, Py_TPFLAGS_DEFAULT, simulationSlots};
+static PyType_Spec columnSpec = {"gravsim._Column", sizeof(PyColumn), 0, Py_TPFLAGS_DEFAULT, columnSlots};
+
+PyMODINIT_FUNC PyInit_gravsim(void)
+{
+    PyObject* module = PyModule_Create(&gravsimModule);
+    if (!module)
+        return nullptr;
+
+    columnType = reinterpret_cast<PyTypeObject*>(PyType_FromSpec(&columnSpec));
+    PyObject* simulationType = PyType_FromSpec(&simulationSpec);
+    if (!columnType || !simulationType || PyModule_AddObject(module, "Simulation", simulationType) < 0)
+    {
+        Py_XDECREF(simulationType);
+        Py_DECREF(module);
+        return nullptr;
+    }
+    return module;
+}
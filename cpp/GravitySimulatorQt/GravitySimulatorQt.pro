@@ -9,19 +9,9 @@ CONFIG += c++17
 #DEFINES += QT_DISABLE_DEPRECATED_BEFORE=0x060000    # disables all the APIs deprecated before Qt 6.0.0
 
 SOURCES += \
-    main.cpp \
-    mainwindow.cpp \
-    simulationarea.cpp \
-    simulationcontroller.cpp \
-    simulationobject.cpp \
-    simulationobjecttile.cpp
+    main.cpp
 
-HEADERS += \
-    SimulationArea.h \
-    mainwindow.h \
-    simulationcontroller.h \
-    simulationobject.h \
-    simulationobjecttile.h
+include(gravitysimulator.pri)
 
 FORMS += \
     mainwindow.ui
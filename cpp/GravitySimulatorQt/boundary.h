@@ -0,0 +1,62 @@
+#ifndef BOUNDARY_H
+#define BOUNDARY_H
+
+#include <cmath>
+
+// What happens to a body that crosses the simulation bounds:
+//   Open     - it is deleted,
+//   Reflect  - it is mirrored back inside and the velocity component across the wall flips,
+//   Periodic - it re-enters from the opposite side (forces stay open unless the particle-mesh solver is periodic),
+//   Absorb   - it is deleted and its mass, momentum and energy are added to the escape tally.
+enum class BoundaryPolicy { Open, Reflect, Periodic, Absorb };
+
+struct SimulationBounds {
+    double left;
+    double top;
+    double right;
+    double bottom;
+};
+
+// Everything the absorbing walls have taken out of the system. energy is kinetic plus the potential energy the
+// body had with those that remained, so energy + tally.energy is conserved.
+struct EscapeTally {
+    int count;
+    double mass;
+    double momentumX;
+    double momentumY;
+    double energy;
+};
+
+// Folds a coordinate back into [low, high] for the reflecting and periodic walls; returns whether it was outside.
+inline bool reflectInto(double& position, double& velocity, double low, double high)
+{
+    if (position < low)
+    {
+        position = 2.0 * low - position;
+        velocity = -velocity;
+    }
+    else if (position > high)
+    {
+        position = 2.0 * high - position;
+        velocity = -velocity;
+    }
+    else
+    {
+        return false;
+    }
+    // A body more than a box width outside is only pulled back to the wall.
+    if (position < low || position > high)
+        position = position < low ? low : high;
+    return true;
+}
+
+inline bool wrapInto(double& position, double low, double high)
+{
+    if (position >= low && position <= high)
+        return false;
+    double width = high - low;
+    position -= width * std::floor((position - low) / width);
+    return true;
+}
+
+#endif // BOUNDARY_H
@@ -0,0 +1,158 @@
+#include "diagnostics.h"
+#include <algorithm>
+#include <cmath>
+#include <thread>
+#include "reduction.h"
+
+static const size_t maxHistory = 4096;
+
+SimulationDiagnostics::SimulationDiagnostics()
+    : threadCount(std::max(1u, std::thread::hardware_concurrency())), softening{SofteningKernel::None, 0.0},
+      hasReference(false), reference() {}
+
+std::vector<DiagnosticBody>& SimulationDiagnostics::getBodies()
+{
+    return bodies;
+}
+
+std::vector<double>& SimulationDiagnostics::getPotentials()
+{
+    return potentials;
+}
+
+void SimulationDiagnostics::setThreadCount(int val)
+{
+    threadCount = std::max(1, val);
+}
+
+// Energies are measured with the same softened potential the forces derive from.
+void SimulationDiagnostics::setSoftening(const Softening& val)
+{
+    softening = val;
+}
+
+const std::vector<DiagnosticsSample>& SimulationDiagnostics::getHistory()
+{
+    return history;
+}
+
+void SimulationDiagnostics::clear()
+{
+    history.clear();
+    hasReference = false;
+}
+
+bool SimulationDiagnostics::openLog(const std::string& path)
+{
+    closeLog();
+    log.open(path);
+    if (!log)
+        return false;
+
+    log << "step,time,bodies,kinetic,potential,energy,px,py,lz,virial,energy_drift,momentum_drift,lz_drift\n";
+    return true;
+}
+
+void SimulationDiagnostics::closeLog()
+{
+    if (log.is_open())
+        log.close();
+}
+
+// Specific potential of every body. Each thread owns a range of rows and sums the full row,
+// so there are no shared accumulators; the pairwise work is done twice in exchange.
+void SimulationDiagnostics::computePotentials(double gforce)
+{
+    size_t n = bodies.size();
+    potentials.assign(n, 0.0);
+
+    parallelFor(n, threadCount, 256, [this, gforce, n](size_t, size_t begin, size_t end) {
+        std::vector<double> scratch;
+        for (size_t i = begin; i < end; ++i)
+        {
+            potentials[i] = gforce * pairwiseSum<double>(n, [this, i](size_t j) {
+                if (j == i)
+                    return 0.0;
+                double distX = bodies[j].x - bodies[i].x;
+                double distY = bodies[j].y - bodies[i].y;
+                double dist = std::sqrt(distX * distX + distY * distY);
+                return bodies[j].mass * softenedPotential(dist, softening.kernel, softening.length);
+            }, scratch);
+        }
+    });
+}
+
+namespace {
+
+struct Totals {
+    double kinetic;
+    double potential;
+    double momentumX;
+    double momentumY;
+    double angularMomentum;
+
+    Totals operator+(const Totals& other) const
+    {
+        return {kinetic + other.kinetic, potential + other.potential, momentumX + other.momentumX,
+                momentumY + other.momentumY, angularMomentum + other.angularMomentum};
+    }
+};
+
+}
+
+DiagnosticsSample SimulationDiagnostics::compute(double gforce, uint64_t step, double time)
+{
+    computePotentials(gforce);
+    return summarize(step, time);
+}
+
+DiagnosticsSample SimulationDiagnostics::computeFromPotentials(uint64_t step, double time)
+{
+    return summarize(step, time);
+}
+
+DiagnosticsSample SimulationDiagnostics::summarize(uint64_t step, double time)
+{
+    DiagnosticsSample sample = DiagnosticsSample();
+    sample.step = step;
+    sample.time = time;
+    sample.bodyCount = static_cast<int>(bodies.size());
+    Totals totals = parallelPairwiseSum<Totals>(bodies.size(), threadCount, [this](size_t i) {
+        const DiagnosticBody& b = bodies[i];
+        return Totals{0.5 * b.mass * (b.vx * b.vx + b.vy * b.vy), 0.5 * b.mass * potentials[i], b.mass * b.vx,
+                      b.mass * b.vy, b.mass * (b.x * b.vy - b.y * b.vx)};
+    });
+    sample.kinetic = totals.kinetic;
+    sample.potential = totals.potential;
+    sample.momentumX = totals.momentumX;
+    sample.momentumY = totals.momentumY;
+    sample.angularMomentum = totals.angularMomentum;
+    sample.energy = sample.kinetic + sample.potential;
+    sample.virialRatio = sample.potential != 0.0 ? 2.0 * sample.kinetic / std::fabs(sample.potential) : 0.0;
+
+    // Escapes and merges change the conserved totals, so drift is measured against the current set of bodies.
+    if (!hasReference || reference.bodyCount != sample.bodyCount)
+    {
+        reference = sample;
+        hasReference = true;
+    }
+    double momentumScale = std::hypot(reference.momentumX, reference.momentumY);
+    sample.energyDrift = reference.energy != 0.0 ? (sample.energy - reference.energy) / std::fabs(reference.energy) : 0.0;
+    sample.momentumDrift = std::hypot(sample.momentumX - reference.momentumX, sample.momentumY - reference.momentumY) /
+                           (momentumScale > 0.0 ? momentumScale : 1.0);
+    sample.angularMomentumDrift = reference.angularMomentum != 0.0
+        ? (sample.angularMomentum - reference.angularMomentum) / std::fabs(reference.angularMomentum) : 0.0;
+
+    if (history.size() == maxHistory)
+        history.erase(history.begin(), history.begin() + maxHistory / 2);
+    history.push_back(sample);
+
+    if (log.is_open())
+    {
+        log << sample.step << ',' << sample.time << ',' << sample.bodyCount << ',' << sample.kinetic << ','
+            << sample.potential << ',' << sample.energy << ',' << sample.momentumX << ',' << sample.momentumY << ','
+            << sample.angularMomentum << ',' << sample.virialRatio << ',' << sample.energyDrift << ','
+            << sample.momentumDrift << ',' << sample.angularMomentumDrift << '\n';
+    }
+    return sample;
+}
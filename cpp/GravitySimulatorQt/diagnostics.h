@@ -0,0 +1,67 @@
+#ifndef DIAGNOSTICS_H
+#define DIAGNOSTICS_H
+
+#include <cstdint>
+#include <fstream>
+#include <string>
+#include <vector>
+#include "softening.h"
+
+struct DiagnosticBody {
+    double x;
+    double y;
+    double vx;
+    double vy;
+    double mass;
+};
+
+struct DiagnosticsSample {
+    uint64_t step;
+    double time;
+    int bodyCount;
+    double kinetic;
+    double potential;
+    double energy;
+    double momentumX;
+    double momentumY;
+    double angularMomentum;
+    double virialRatio;
+    // Relative to the first sample taken with the current set of bodies.
+    double energyDrift;
+    double momentumDrift;
+    double angularMomentumDrift;
+};
+
+class SimulationDiagnostics {
+public:
+    SimulationDiagnostics();
+
+    // Bodies are staged here by the caller before compute().
+    std::vector<DiagnosticBody>& getBodies();
+    // Specific potentials of the staged bodies: the ones compute() found, or ones the caller stages for
+    // computeFromPotentials(), which then skips the O(N^2) pass.
+    std::vector<double>& getPotentials();
+    DiagnosticsSample compute(double gforce, uint64_t step, double time);
+    DiagnosticsSample computeFromPotentials(uint64_t step, double time);
+    void setThreadCount(int val);
+    void setSoftening(const Softening& val);
+    const std::vector<DiagnosticsSample>& getHistory();
+    void clear();
+    bool openLog(const std::string& path);
+    void closeLog();
+
+private:
+    std::vector<DiagnosticBody> bodies;
+    std::vector<double> potentials;
+    std::vector<DiagnosticsSample> history;
+    int threadCount;
+    Softening softening;
+    bool hasReference;
+    DiagnosticsSample reference;
+    std::ofstream log;
+
+    void computePotentials(double gforce);
+    DiagnosticsSample summarize(uint64_t step, double time);
+};
+
+#endif // DIAGNOSTICS_H
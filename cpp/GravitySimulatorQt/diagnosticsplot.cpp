@@ -0,0 +1,62 @@
+#include <QPainter>
+#include <QPolygonF>
+#include <algorithm>
+#include <cmath>
+#include "diagnosticsplot.h"
+
+DiagnosticsPlot::DiagnosticsPlot(QWidget *parent, SimulationController *simulationController)
+    : QWidget(parent), simulationController(simulationController)
+{
+    setFixedSize(200, 130);
+}
+
+void DiagnosticsPlot::paintEvent(QPaintEvent *event) {
+    QPainter painter(this);
+    painter.setPen(Qt::transparent);
+    painter.setBrush(QColor(151, 172, 184));
+    painter.drawRect(rect());
+    painter.setFont(QFont("Sans", 8));
+
+    const std::vector<DiagnosticsSample> &history = simulationController->getDiagnostics().getHistory();
+    if (history.empty())
+    {
+        painter.setPen(Qt::black);
+        painter.drawText(QPointF(5, 15), "brak pomiarów");
+        return;
+    }
+
+    const DiagnosticsSample &last = history.back();
+    painter.setPen(Qt::black);
+    painter.drawText(QPointF(5, 12), QString("E: %1  ΔE: %2").arg(last.energy, 0, 'g', 6).arg(last.energyDrift, 0, 'e', 2));
+    painter.drawText(QPointF(5, 24), QString("p: %1; %2").arg(last.momentumX, 0, 'g', 4).arg(last.momentumY, 0, 'g', 4));
+    painter.drawText(QPointF(5, 36), QString("L: %1  ΔL: %2").arg(last.angularMomentum, 0, 'g', 6).arg(last.angularMomentumDrift, 0, 'e', 2));
+    painter.drawText(QPointF(5, 48), QString("2K/|U|: %1").arg(last.virialRatio, 0, 'f', 3));
+
+    // Both series share a symmetric, auto-scaled axis.
+    const int plotTop = 56;
+    const int plotHeight = height() - plotTop - 4;
+    const int count = std::min<int>(history.size(), width());
+    double scale = 1e-12;
+    for (int i = history.size() - count; i < static_cast<int>(history.size()); ++i)
+        scale = std::max({scale, std::fabs(history[i].energyDrift), std::fabs(history[i].angularMomentumDrift)});
+
+    painter.setPen(Qt::darkGray);
+    painter.drawLine(QPointF(0, plotTop + plotHeight / 2.0), QPointF(width(), plotTop + plotHeight / 2.0));
+
+    QPolygonF energy;
+    QPolygonF angular;
+    for (int i = 0; i < count; ++i)
+    {
+        const DiagnosticsSample &s = history[history.size() - count + i];
+        double x = width() - count + i;
+        energy << QPointF(x, plotTop + plotHeight * (0.5 - 0.5 * s.energyDrift / scale));
+        angular << QPointF(x, plotTop + plotHeight * (0.5 - 0.5 * s.angularMomentumDrift / scale));
+    }
+    painter.setBrush(Qt::NoBrush);
+    painter.setPen(Qt::white);
+    painter.drawPolyline(energy);
+    painter.setPen(Qt::blue);
+    painter.drawPolyline(angular);
+    painter.setPen(Qt::black);
+    painter.drawText(QPointF(5, plotTop + 10), QString("±%1").arg(scale, 0, 'e', 1));
+}
@@ -0,0 +1,23 @@
+#ifndef DIAGNOSTICS_PLOT_H
+#define DIAGNOSTICS_PLOT_H
+
+#include <QWidget>
+#include "simulationcontroller.h"
+
+class SimulationController;
+
+// Live plot of relative energy and angular momentum drift, with the latest conserved quantities as text.
+class DiagnosticsPlot : public QWidget {
+    Q_OBJECT
+
+public:
+    DiagnosticsPlot(QWidget *parent, SimulationController *simulationController);
+
+protected:
+    void paintEvent(QPaintEvent *event) override;
+
+private:
+    SimulationController *simulationController;
+};
+
+#endif // DIAGNOSTICS_PLOT_H
@@ -0,0 +1,466 @@
+#include "distributedsimulation.h"
+#include <algorithm>
+#include <cmath>
+#include <thread>
+#include "parallelfor.h"
+#include "profiler.h"
+
+DistributedSimulation::DistributedSimulation(Transport* transport)
+    : transport(transport), gforce(6.67408), softening{SofteningKernel::None, 0.0}, openingAngle(0.5),
+      rebalanceInterval(50), boundaryPolicy(BoundaryPolicy::Open), bounds{-100.0, -100.0, 600.0, 600.0},
+      threadCount(std::max(1u, std::thread::hardware_concurrency())), forcesValid(false), stepCount(0),
+      lastForceNanoseconds(0), costNanoseconds(0) {}
+
+void DistributedSimulation::load(const QList<ScenarioBody>& list)
+{
+    std::vector<double> x, y;
+    for (const ScenarioBody& body : list)
+    {
+        x.push_back(body.x);
+        y.push_back(body.y);
+    }
+    domains.bisect(x, y, std::vector<double>(list.size(), 1.0), transport->getSize());
+
+    bodies.clear();
+    for (int i = 0; i < list.size(); ++i)
+    {
+        const ScenarioBody& body = list[i];
+        if (domains.findDomain(body.x, body.y) == transport->getRank())
+            bodies.push_back({i, body.x, body.y, body.vx, body.vy, 0.0, 0.0, body.mass, body.radius});
+    }
+    forcesValid = false;
+    stepCount = 0;
+    costNanoseconds = 0;
+}
+
+// Kick-drift-kick as in SimulationController::simulateLeapfrog, except that the walls act before the second
+// force evaluation: bodies they move migrate together with those that drifted out of the domain.
+bool DistributedSimulation::step(double frameTime)
+{
+    if (!forcesValid)
+    {
+        if (!exchangeEssentials())
+            return false;
+        computeAccelerations();
+    }
+
+    for (DistributedBody& body : bodies)
+    {
+        body.vx += body.ax * 0.5 * frameTime;
+        body.vy += body.ay * 0.5 * frameTime;
+        body.x += body.vx * frameTime;
+        body.y += body.vy * frameTime;
+    }
+    applyBoundaries();
+    if (!migrate() || !exchangeEssentials())
+        return false;
+    computeAccelerations();
+    for (DistributedBody& body : bodies)
+    {
+        body.vx += body.ax * 0.5 * frameTime;
+        body.vy += body.ay * 0.5 * frameTime;
+    }
+    forcesValid = true;
+    ++stepCount;
+
+    if (rebalanceInterval > 0 && stepCount % rebalanceInterval == 0)
+        return rebalance();
+    return true;
+}
+
+// Every rank sends the positions of its bodies with its measured cost per body, so all ranks bisect the same
+// input and agree on the new domains without further messages.
+bool DistributedSimulation::rebalance()
+{
+    MessageWriter writer;
+    writer.put<double>(static_cast<double>(costNanoseconds) / std::max<size_t>(1, bodies.size()));
+    std::vector<double> x, y;
+    for (const DistributedBody& body : bodies)
+    {
+        x.push_back(body.x);
+        y.push_back(body.y);
+    }
+    writer.putVector(x);
+    writer.putVector(y);
+
+    std::vector<std::vector<char>> messages;
+    if (!allGather(*transport, writer.getData(), messages))
+        return false;
+
+    std::vector<double> allX, allY, cost;
+    for (const std::vector<char>& message : messages)
+    {
+        MessageReader reader(message);
+        double perBody = reader.get<double>();
+        reader.getVector(x);
+        reader.getVector(y);
+        allX.insert(allX.end(), x.begin(), x.end());
+        allY.insert(allY.end(), y.begin(), y.end());
+        cost.insert(cost.end(), x.size(), perBody);
+    }
+    domains.bisect(allX, allY, cost, transport->getSize());
+    costNanoseconds = 0;
+    return migrate();
+}
+
+bool DistributedSimulation::measure(DistributedSample& sample)
+{
+    if (!exchangeEssentials())
+        return false;
+
+    double kinetic = 0.0, momentumX = 0.0, momentumY = 0.0;
+    for (const DistributedBody& body : bodies)
+    {
+        kinetic += 0.5 * body.mass * (body.vx * body.vx + body.vy * body.vy);
+        momentumX += body.mass * body.vx;
+        momentumY += body.mass * body.vy;
+    }
+    MessageWriter writer;
+    writer.put<double>(static_cast<double>(bodies.size()));
+    writer.put<double>(static_cast<double>(imported.size()));
+    writer.put<double>(kinetic);
+    writer.put<double>(computePotential());
+    writer.put<double>(momentumX);
+    writer.put<double>(momentumY);
+    writer.put<double>(lastForceNanoseconds / 1e6);
+
+    std::vector<std::vector<char>> messages;
+    if (!allGather(*transport, writer.getData(), messages))
+        return false;
+
+    sample = DistributedSample{stepCount, 0, 0, 0, 0, 0.0, 0.0, 0.0, 0.0, 0.0, 0.0};
+    for (size_t r = 0; r < messages.size(); ++r)
+    {
+        MessageReader reader(messages[r]);
+        int count = static_cast<int>(reader.get<double>());
+        sample.bodyCount += count;
+        sample.minRankBodies = r == 0 ? count : std::min(sample.minRankBodies, count);
+        sample.maxRankBodies = std::max(sample.maxRankBodies, count);
+        sample.importedSources += static_cast<int>(reader.get<double>());
+        sample.kinetic += reader.get<double>();
+        sample.potential += reader.get<double>();
+        sample.momentumX += reader.get<double>();
+        sample.momentumY += reader.get<double>();
+        double milliseconds = reader.get<double>();
+        sample.maxForceMilliseconds = std::max(sample.maxForceMilliseconds, milliseconds);
+        sample.meanForceMilliseconds += milliseconds / messages.size();
+    }
+    return true;
+}
+
+bool DistributedSimulation::gather(std::vector<DistributedBody>& result)
+{
+    std::vector<std::vector<char>> outgoing(transport->getSize());
+    MessageWriter writer;
+    writer.putVector(bodies);
+    outgoing[0] = writer.getData();
+    std::vector<std::vector<char>> incoming;
+    if (!transport->exchange(outgoing, incoming))
+        return false;
+
+    result.clear();
+    if (transport->getRank() != 0)
+        return true;
+
+    result = bodies;
+    std::vector<DistributedBody> received;
+    for (const std::vector<char>& message : incoming)
+    {
+        MessageReader reader(message);
+        reader.getVector(received);
+        result.insert(result.end(), received.begin(), received.end());
+    }
+    std::sort(result.begin(), result.end(), [](const DistributedBody& a, const DistributedBody& b) { return a.id < b.id; });
+    return true;
+}
+
+// The bodies are binned on a grid over their extent, about four per cell. For every other rank each cell is
+// either summarised or sent body by body, depending on how large it looks from that rank's domain.
+bool DistributedSimulation::exchangeEssentials()
+{
+    int size = transport->getSize();
+    int rank = transport->getRank();
+    std::vector<std::vector<char>> outgoing(size);
+
+    size_t n = bodies.size();
+    if (n > 0)
+    {
+        double minX = bodies[0].x, maxX = bodies[0].x, minY = bodies[0].y, maxY = bodies[0].y;
+        for (const DistributedBody& body : bodies)
+        {
+            minX = std::min(minX, body.x);
+            maxX = std::max(maxX, body.x);
+            minY = std::min(minY, body.y);
+            maxY = std::max(maxY, body.y);
+        }
+        int cellsPerAxis = std::min(64, std::max(1, static_cast<int>(std::sqrt(n / 4.0))));
+        double cellX = std::max(1e-9, (maxX - minX) / cellsPerAxis * (1.0 + 1e-9));
+        double cellY = std::max(1e-9, (maxY - minY) / cellsPerAxis * (1.0 + 1e-9));
+        int cellCount = cellsPerAxis * cellsPerAxis;
+
+        std::vector<int> cellStart(cellCount + 1, 0);
+        std::vector<int> cellOf(n);
+        for (size_t i = 0; i < n; ++i)
+        {
+            int column = std::min(cellsPerAxis - 1, static_cast<int>((bodies[i].x - minX) / cellX));
+            int row = std::min(cellsPerAxis - 1, static_cast<int>((bodies[i].y - minY) / cellY));
+            cellOf[i] = row * cellsPerAxis + column;
+            ++cellStart[cellOf[i] + 1];
+        }
+        for (int c = 0; c < cellCount; ++c)
+            cellStart[c + 1] += cellStart[c];
+        std::vector<int> cellBodies(n);
+        std::vector<int> fill(cellStart.begin(), cellStart.end() - 1);
+        for (size_t i = 0; i < n; ++i)
+            cellBodies[fill[cellOf[i]]++] = static_cast<int>(i);
+
+        std::vector<SourcePoint> centres(cellCount);
+        std::vector<double> radii(cellCount, 0.0);
+        for (int c = 0; c < cellCount; ++c)
+        {
+            SourcePoint centre = {0.0, 0.0, 0.0};
+            for (int p = cellStart[c]; p < cellStart[c + 1]; ++p)
+            {
+                const DistributedBody& body = bodies[cellBodies[p]];
+                centre.x += body.mass * body.x;
+                centre.y += body.mass * body.y;
+                centre.mass += body.mass;
+            }
+            if (centre.mass > 0.0)
+            {
+                centre.x /= centre.mass;
+                centre.y /= centre.mass;
+            }
+            for (int p = cellStart[c]; p < cellStart[c + 1]; ++p)
+            {
+                const DistributedBody& body = bodies[cellBodies[p]];
+                radii[c] = std::max(radii[c], std::hypot(body.x - centre.x, body.y - centre.y));
+            }
+            centres[c] = centre;
+        }
+
+        for (int r = 0; r < size; ++r)
+        {
+            if (r == rank)
+                continue;
+            std::vector<SourcePoint> essentials;
+            for (int c = 0; c < cellCount; ++c)
+            {
+                if (cellStart[c] == cellStart[c + 1])
+                    continue;
+                if (radii[c] < openingAngle * distanceToDomain(domains.getDomain(r), centres[c].x, centres[c].y))
+                {
+                    essentials.push_back(centres[c]);
+                    continue;
+                }
+                for (int p = cellStart[c]; p < cellStart[c + 1]; ++p)
+                {
+                    const DistributedBody& body = bodies[cellBodies[p]];
+                    essentials.push_back({body.x, body.y, body.mass});
+                }
+            }
+            MessageWriter writer;
+            writer.putVector(essentials);
+            outgoing[r] = writer.getData();
+        }
+    }
+
+    std::vector<std::vector<char>> incoming;
+    if (!transport->exchange(outgoing, incoming))
+        return false;
+
+    imported.clear();
+    std::vector<SourcePoint> received;
+    for (const std::vector<char>& message : incoming)
+    {
+        MessageReader reader(message);
+        reader.getVector(received);
+        imported.insert(imported.end(), received.begin(), received.end());
+    }
+    return true;
+}
+
+// Own bodies and imported points are summed in a fixed order per body, so the thread count does not matter.
+void DistributedSimulation::computeAccelerations()
+{
+    PROFILE_SCOPE(ProfilePhase::Gravity);
+    uint64_t start = Profiler::now();
+    size_t n = bodies.size();
+    parallelFor(n, threadCount, 64, [this, n](size_t, size_t begin, size_t end) {
+        for (size_t i = begin; i < end; ++i)
+        {
+            DistributedBody& target = bodies[i];
+            double sumX = 0.0;
+            double sumY = 0.0;
+            for (size_t j = 0; j < n; ++j)
+            {
+                if (j == i)
+                    continue;
+                double dx = bodies[j].x - target.x;
+                double dy = bodies[j].y - target.y;
+                double scale = bodies[j].mass * softenedInverseCube(dx * dx + dy * dy, softening.kernel, softening.length);
+                sumX += dx * scale;
+                sumY += dy * scale;
+            }
+            for (const SourcePoint& source : imported)
+            {
+                double dx = source.x - target.x;
+                double dy = source.y - target.y;
+                double scale = source.mass * softenedInverseCube(dx * dx + dy * dy, softening.kernel, softening.length);
+                sumX += dx * scale;
+                sumY += dy * scale;
+            }
+            target.ax = gforce * sumX;
+            target.ay = gforce * sumY;
+        }
+    });
+    lastForceNanoseconds = Profiler::now() - start;
+    costNanoseconds += lastForceNanoseconds;
+}
+
+// Half of every own pair, plus the own bodies' share of the pairs with imported points (each rank counts its half).
+double DistributedSimulation::computePotential()
+{
+    double potential = 0.0;
+    size_t n = bodies.size();
+    for (size_t i = 0; i < n; ++i)
+    {
+        double sum = 0.0;
+        for (size_t j = 0; j < n; ++j)
+        {
+            if (j != i)
+                sum += 0.5 * bodies[j].mass * softenedPotential(std::hypot(bodies[j].x - bodies[i].x, bodies[j].y - bodies[i].y),
+                                                                softening.kernel, softening.length);
+        }
+        for (const SourcePoint& source : imported)
+            sum += 0.5 * source.mass * softenedPotential(std::hypot(source.x - bodies[i].x, source.y - bodies[i].y),
+                                                         softening.kernel, softening.length);
+        potential += gforce * bodies[i].mass * sum;
+    }
+    return potential;
+}
+
+void DistributedSimulation::applyBoundaries()
+{
+    if (boundaryPolicy == BoundaryPolicy::Reflect || boundaryPolicy == BoundaryPolicy::Periodic)
+    {
+        for (DistributedBody& body : bodies)
+        {
+            if (boundaryPolicy == BoundaryPolicy::Reflect)
+            {
+                reflectInto(body.x, body.vx, bounds.left, bounds.right);
+                reflectInto(body.y, body.vy, bounds.top, bounds.bottom);
+            }
+            else
+            {
+                wrapInto(body.x, bounds.left, bounds.right);
+                wrapInto(body.y, bounds.top, bounds.bottom);
+            }
+        }
+        return;
+    }
+
+    bodies.erase(std::remove_if(bodies.begin(), bodies.end(), [this](const DistributedBody& body) {
+        return body.x < bounds.left || body.x > bounds.right || body.y < bounds.top || body.y > bounds.bottom;
+    }), bodies.end());
+}
+
+bool DistributedSimulation::migrate()
+{
+    int size = transport->getSize();
+    int rank = transport->getRank();
+    std::vector<std::vector<DistributedBody>> leaving(size);
+    size_t kept = 0;
+    for (size_t i = 0; i < bodies.size(); ++i)
+    {
+        int owner = domains.findDomain(bodies[i].x, bodies[i].y);
+        if (owner == rank)
+            bodies[kept++] = bodies[i];
+        else
+            leaving[owner].push_back(bodies[i]);
+    }
+    bodies.resize(kept);
+
+    std::vector<std::vector<char>> outgoing(size);
+    for (int r = 0; r < size; ++r)
+    {
+        MessageWriter writer;
+        writer.putVector(leaving[r]);
+        outgoing[r] = writer.getData();
+    }
+    std::vector<std::vector<char>> incoming;
+    if (!transport->exchange(outgoing, incoming))
+        return false;
+
+    std::vector<DistributedBody> arrived;
+    for (const std::vector<char>& message : incoming)
+    {
+        MessageReader reader(message);
+        reader.getVector(arrived);
+        bodies.insert(bodies.end(), arrived.begin(), arrived.end());
+    }
+    return true;
+}
+
+std::vector<DistributedBody>& DistributedSimulation::getBodies()
+{
+    return bodies;
+}
+
+DomainDecomposition& DistributedSimulation::getDomains()
+{
+    return domains;
+}
+
+uint64_t DistributedSimulation::getStepCount()
+{
+    return stepCount;
+}
+
+void DistributedSimulation::setGForce(double val)
+{
+    gforce = val;
+    forcesValid = false;
+}
+
+void DistributedSimulation::setSoftening(const Softening& val)
+{
+    softening = val;
+    forcesValid = false;
+}
+
+void DistributedSimulation::setOpeningAngle(double val)
+{
+    openingAngle = std::max(0.0, val);
+    forcesValid = false;
+}
+
+double DistributedSimulation::getOpeningAngle()
+{
+    return openingAngle;
+}
+
+void DistributedSimulation::setRebalanceInterval(int val)
+{
+    rebalanceInterval = std::max(0, val);
+}
+
+int DistributedSimulation::getRebalanceInterval()
+{
+    return rebalanceInterval;
+}
+
+void DistributedSimulation::setBoundaryPolicy(BoundaryPolicy val)
+{
+    boundaryPolicy = val;
+}
+
+void DistributedSimulation::setBounds(const SimulationBounds& val)
+{
+    bounds = val;
+}
+
+void DistributedSimulation::setThreadCount(int val)
+{
+    threadCount = std::max(1, val);
+}
@@ -0,0 +1,106 @@
+#ifndef DISTRIBUTED_SIMULATION_H
+#define DISTRIBUTED_SIMULATION_H
+
+#include <cstdint>
+#include <vector>
+#include <QList>
+#include "boundary.h"
+#include "domaindecomposition.h"
+#include "scenario.h"
+#include "softening.h"
+#include "transport.h"
+
+struct DistributedBody {
+    int32_t id;
+    double x;
+    double y;
+    double vx;
+    double vy;
+    double ax;
+    double ay;
+    double mass;
+    double radius;
+};
+
+// A point mass another rank needs for its forces: a single body, or a whole cell at its centre of mass.
+struct SourcePoint {
+    double x;
+    double y;
+    double mass;
+};
+
+// Totals over all ranks, identical on every rank.
+struct DistributedSample {
+    uint64_t step;
+    int bodyCount;
+    int minRankBodies;
+    int maxRankBodies;
+    int importedSources;
+    double kinetic;
+    double potential;
+    double momentumX;
+    double momentumY;
+    // Force time of the last step on the slowest rank and on average.
+    double maxForceMilliseconds;
+    double meanForceMilliseconds;
+};
+
+// One rank's part of a simulation split over several processes. The rank owns the bodies inside its domain
+// and integrates them with kick-drift-kick leapfrog. Gravity from the other domains arrives as their locally
+// essential data: a cell of bodies that looks small from this domain (its radius over the distance to the
+// domain below the opening angle) comes as one point at its centre of mass, a nearer one as its bodies (ghosts).
+// Bodies that leave the domain migrate to their new owner after the drift, and every rebalanceInterval steps
+// the domains are bisected again with each body weighted by the force time its rank measured per body.
+// Collisions are not resolved across ranks.
+class DistributedSimulation {
+public:
+    explicit DistributedSimulation(Transport* transport);
+
+    // Every rank passes the same list and keeps the bodies in its share of an even split by count.
+    void load(const QList<ScenarioBody>& list);
+    // Returns false when the transport failed; the ranks are then out of step and must stop.
+    bool step(double frameTime);
+    bool rebalance();
+    bool measure(DistributedSample& sample);
+    // All bodies on rank 0 ordered by id; the other ranks get an empty list.
+    bool gather(std::vector<DistributedBody>& result);
+
+    std::vector<DistributedBody>& getBodies();
+    DomainDecomposition& getDomains();
+    uint64_t getStepCount();
+    void setGForce(double val);
+    void setSoftening(const Softening& val);
+    void setOpeningAngle(double val);
+    double getOpeningAngle();
+    void setRebalanceInterval(int val);
+    int getRebalanceInterval();
+    void setBoundaryPolicy(BoundaryPolicy val);
+    void setBounds(const SimulationBounds& val);
+    void setThreadCount(int val);
+
+private:
+    Transport* transport;
+    DomainDecomposition domains;
+    std::vector<DistributedBody> bodies;
+    std::vector<SourcePoint> imported;
+    double gforce;
+    Softening softening;
+    double openingAngle;
+    int rebalanceInterval;
+    BoundaryPolicy boundaryPolicy;
+    SimulationBounds bounds;
+    int threadCount;
+    bool forcesValid;
+    uint64_t stepCount;
+    uint64_t lastForceNanoseconds;
+    // Force time since the last rebalance, the cost that drives the next one.
+    uint64_t costNanoseconds;
+
+    bool exchangeEssentials();
+    void computeAccelerations();
+    double computePotential();
+    void applyBoundaries();
+    bool migrate();
+};
+
+#endif // DISTRIBUTED_SIMULATION_H
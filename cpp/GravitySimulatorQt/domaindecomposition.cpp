@@ -0,0 +1,132 @@
+#include "domaindecomposition.h"
+#include <algorithm>
+#include <cmath>
+#include <limits>
+#include <numeric>
+
+static const double infinity = std::numeric_limits<double>::infinity();
+
+// Where to cut a side that holds no bodies: its middle, or a finite edge, or the origin.
+static double middle(double low, double high)
+{
+    if (std::isfinite(low) && std::isfinite(high))
+        return 0.5 * (low + high);
+    if (std::isfinite(low))
+        return low;
+    return std::isfinite(high) ? high : 0.0;
+}
+
+DomainDecomposition::DomainDecomposition()
+    : domains(1, SimulationBounds{-infinity, -infinity, infinity, infinity}) {}
+
+void DomainDecomposition::bisect(const std::vector<double>& x, const std::vector<double>& y, const std::vector<double>& cost,
+                                 int domainCount)
+{
+    domainCount = std::max(1, domainCount);
+    domains.assign(domainCount, SimulationBounds{-infinity, -infinity, infinity, infinity});
+    order.resize(x.size());
+    std::iota(order.begin(), order.end(), 0);
+    split(x, y, cost, 0, order.size(), SimulationBounds{-infinity, -infinity, infinity, infinity}, 0, domainCount);
+}
+
+void DomainDecomposition::split(const std::vector<double>& x, const std::vector<double>& y, const std::vector<double>& cost,
+                                size_t begin, size_t end, SimulationBounds box, int firstDomain, int count)
+{
+    if (count == 1)
+    {
+        domains[firstDomain] = box;
+        return;
+    }
+
+    int leftCount = count / 2;
+    double minX = infinity, minY = infinity, maxX = -infinity, maxY = -infinity, total = 0.0;
+    for (size_t k = begin; k < end; ++k)
+    {
+        int i = order[k];
+        minX = std::min(minX, x[i]);
+        maxX = std::max(maxX, x[i]);
+        minY = std::min(minY, y[i]);
+        maxY = std::max(maxY, y[i]);
+        total += cost[i];
+    }
+
+    bool alongX = begin == end || maxX - minX >= maxY - minY;
+    double cut;
+    size_t middleIndex = begin;
+    if (begin == end)
+    {
+        cut = middle(box.left, box.right);
+    }
+    else
+    {
+        // Without measured costs every body weighs the same.
+        bool uniform = !(total > 0.0);
+        auto weight = [&](int i) { return uniform ? 1.0 : cost[i]; };
+        auto coordinate = [&](int i) { return alongX ? x[i] : y[i]; };
+        std::sort(order.begin() + begin, order.begin() + end, [&](int a, int b) {
+            return coordinate(a) < coordinate(b) || (coordinate(a) == coordinate(b) && a < b);
+        });
+
+        double target = (uniform ? static_cast<double>(end - begin) : total) * leftCount / count;
+        double accumulated = 0.0;
+        size_t k = begin;
+        while (k < end && accumulated + weight(order[k]) <= target)
+            accumulated += weight(order[k++]);
+        if (k < end && target - accumulated > accumulated + weight(order[k]) - target)
+            accumulated += weight(order[k++]);
+
+        if (k == begin)
+            cut = coordinate(order[begin]);
+        else if (k == end)
+            cut = std::nextafter(coordinate(order[end - 1]), infinity);
+        else
+            cut = 0.5 * (coordinate(order[k - 1]) + coordinate(order[k]));
+        // Equal coordinates all fall on one side of the cut.
+        middleIndex = std::lower_bound(order.begin() + begin, order.begin() + end, cut,
+                                       [&](int i, double value) { return coordinate(i) < value; }) - order.begin();
+    }
+
+    SimulationBounds low = box;
+    SimulationBounds high = box;
+    if (alongX)
+    {
+        low.right = cut;
+        high.left = cut;
+    }
+    else
+    {
+        low.bottom = cut;
+        high.top = cut;
+    }
+    split(x, y, cost, begin, middleIndex, low, firstDomain, leftCount);
+    split(x, y, cost, middleIndex, end, high, firstDomain + leftCount, count - leftCount);
+}
+
+int DomainDecomposition::getDomainCount()
+{
+    return static_cast<int>(domains.size());
+}
+
+const SimulationBounds& DomainDecomposition::getDomain(int i)
+{
+    return domains[i];
+}
+
+int DomainDecomposition::findDomain(double x, double y)
+{
+    for (size_t d = 0; d < domains.size(); ++d)
+    {
+        const SimulationBounds& domain = domains[d];
+        if (x >= domain.left && x < domain.right && y >= domain.top && y < domain.bottom)
+            return static_cast<int>(d);
+    }
+    // Only NaN positions get here.
+    return 0;
+}
+
+double distanceToDomain(const SimulationBounds& domain, double x, double y)
+{
+    double dx = std::max(0.0, std::max(domain.left - x, x - domain.right));
+    double dy = std::max(0.0, std::max(domain.top - y, y - domain.bottom));
+    return std::sqrt(dx * dx + dy * dy);
+}
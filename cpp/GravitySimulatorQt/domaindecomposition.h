@@ -0,0 +1,31 @@
+#ifndef DOMAIN_DECOMPOSITION_H
+#define DOMAIN_DECOMPOSITION_H
+
+#include <vector>
+#include "boundary.h"
+
+// Orthogonal recursive bisection of the plane into one domain per rank. Each cut runs across the longer side of
+// the bodies' extent at the point where the cost on either side is proportional to the number of ranks it gets,
+// so uneven rank counts work too. Domains tile the whole plane (outer edges are infinite) and contain their
+// left and top edges, so every position has exactly one owner.
+class DomainDecomposition {
+public:
+    DomainDecomposition();
+
+    void bisect(const std::vector<double>& x, const std::vector<double>& y, const std::vector<double>& cost, int domainCount);
+    int getDomainCount();
+    const SimulationBounds& getDomain(int i);
+    int findDomain(double x, double y);
+
+private:
+    std::vector<SimulationBounds> domains;
+    std::vector<int> order;
+
+    void split(const std::vector<double>& x, const std::vector<double>& y, const std::vector<double>& cost,
+               size_t begin, size_t end, SimulationBounds box, int firstDomain, int count);
+};
+
+// Distance from a point to the nearest point of a domain, 0 inside it.
+double distanceToDomain(const SimulationBounds& domain, double x, double y);
+
+#endif // DOMAIN_DECOMPOSITION_H
@@ -0,0 +1,161 @@
+#include "fft.h"
+#include <cmath>
+#include <thread>
+#include "parallelfor.h"
+
+static const double pi = 3.14159265358979323846;
+
+RealFft2D::RealFft2D()
+    : width(0), height(0), threadCount(std::max(1u, std::thread::hardware_concurrency())) {}
+
+void RealFft2D::setSize(int width, int height)
+{
+    if (this->width == width && this->height == height)
+        return;
+
+    this->width = width;
+    this->height = height;
+    rowTwiddles = makeTwiddles(width / 2);
+    columnTwiddles = makeTwiddles(height);
+    splitTwiddles.resize(width / 2 + 1);
+    for (int k = 0; k <= width / 2; ++k)
+        splitTwiddles[k] = std::polar(1.0, -2.0 * pi * k / width);
+}
+
+void RealFft2D::setThreadCount(int val)
+{
+    threadCount = std::max(1, val);
+}
+
+int RealFft2D::getWidth()
+{
+    return width;
+}
+
+int RealFft2D::getHeight()
+{
+    return height;
+}
+
+int RealFft2D::getSpectrumWidth()
+{
+    return width / 2 + 1;
+}
+
+std::vector<std::complex<double>> RealFft2D::makeTwiddles(int n)
+{
+    std::vector<std::complex<double>> twiddles(n / 2);
+    for (int k = 0; k < n / 2; ++k)
+        twiddles[k] = std::polar(1.0, -2.0 * pi * k / n);
+    return twiddles;
+}
+
+void RealFft2D::transform(std::complex<double>* data, int n, const std::vector<std::complex<double>>& twiddles,
+                          bool inverse)
+{
+    for (int i = 1, j = 0; i < n; ++i)
+    {
+        int bit = n >> 1;
+        for (; j & bit; bit >>= 1)
+            j ^= bit;
+        j ^= bit;
+        if (i < j)
+            std::swap(data[i], data[j]);
+    }
+
+    for (int length = 2; length <= n; length <<= 1)
+    {
+        int half = length / 2;
+        int stride = n / length;
+        for (int start = 0; start < n; start += length)
+        {
+            for (int k = 0; k < half; ++k)
+            {
+                std::complex<double> w = inverse ? std::conj(twiddles[k * stride]) : twiddles[k * stride];
+                std::complex<double> odd = data[start + k + half] * w;
+                data[start + k + half] = data[start + k] - odd;
+                data[start + k] += odd;
+            }
+        }
+    }
+}
+
+// Each row of n reals is packed into n / 2 complex values (even + i odd), transformed, and split into the
+// n / 2 + 1 bins of the real spectrum.
+void RealFft2D::forward(const std::vector<double>& grid, std::vector<std::complex<double>>& spectrum)
+{
+    int half = width / 2;
+    int bins = half + 1;
+    spectrum.resize(static_cast<size_t>(bins) * height);
+
+    parallelFor(height, threadCount, 16, [&](size_t, size_t begin, size_t end) {
+        std::vector<std::complex<double>> packed(half);
+        for (size_t row = begin; row < end; ++row)
+        {
+            const double* in = &grid[row * width];
+            std::complex<double>* out = &spectrum[row * bins];
+            for (int m = 0; m < half; ++m)
+                packed[m] = std::complex<double>(in[2 * m], in[2 * m + 1]);
+            transform(packed.data(), half, rowTwiddles, false);
+
+            for (int k = 0; k <= half; ++k)
+            {
+                std::complex<double> a = packed[k % half];
+                std::complex<double> b = std::conj(packed[(half - k) % half]);
+                std::complex<double> even = 0.5 * (a + b);
+                std::complex<double> odd = std::complex<double>(0.0, -0.5) * (a - b);
+                out[k] = even + splitTwiddles[k] * odd;
+            }
+        }
+    });
+
+    transformColumns(spectrum, false);
+}
+
+void RealFft2D::inverse(std::vector<std::complex<double>>& spectrum, std::vector<double>& grid)
+{
+    int half = width / 2;
+    int bins = half + 1;
+    grid.resize(static_cast<size_t>(width) * height);
+    transformColumns(spectrum, true);
+
+    double scale = 1.0 / (static_cast<double>(half) * height);
+    parallelFor(height, threadCount, 16, [&](size_t, size_t begin, size_t end) {
+        std::vector<std::complex<double>> packed(half);
+        for (size_t row = begin; row < end; ++row)
+        {
+            const std::complex<double>* in = &spectrum[row * bins];
+            double* out = &grid[row * width];
+            for (int k = 0; k < half; ++k)
+            {
+                std::complex<double> a = in[k];
+                std::complex<double> b = std::conj(in[half - k]);
+                std::complex<double> even = 0.5 * (a + b);
+                std::complex<double> odd = 0.5 * (a - b) * std::conj(splitTwiddles[k]);
+                packed[k] = even + std::complex<double>(0.0, 1.0) * odd;
+            }
+            transform(packed.data(), half, rowTwiddles, true);
+            for (int m = 0; m < half; ++m)
+            {
+                out[2 * m] = packed[m].real() * scale;
+                out[2 * m + 1] = packed[m].imag() * scale;
+            }
+        }
+    });
+}
+
+void RealFft2D::transformColumns(std::vector<std::complex<double>>& spectrum, bool inverse)
+{
+    int bins = width / 2 + 1;
+    parallelFor(bins, threadCount, 8, [&](size_t, size_t begin, size_t end) {
+        std::vector<std::complex<double>> column(height);
+        for (size_t c = begin; c < end; ++c)
+        {
+            for (int r = 0; r < height; ++r)
+                column[r] = spectrum[r * bins + c];
+            transform(column.data(), height, columnTwiddles, inverse);
+            for (int r = 0; r < height; ++r)
+                spectrum[r * bins + c] = column[r];
+        }
+    });
+}
@@ -0,0 +1,39 @@
+#ifndef FFT_H
+#define FFT_H
+
+#include <complex>
+#include <vector>
+
+// Two-dimensional real-to-complex FFT on power-of-two grids. A grid of height rows of width reals maps to a
+// spectrum of height rows of width / 2 + 1 bins; rows use a half-length complex transform, columns a full one.
+// forward() is unnormalised, inverse() divides by width * height, so inverse(forward(g)) == g.
+class RealFft2D {
+public:
+    RealFft2D();
+    void setSize(int width, int height);
+    void setThreadCount(int val);
+    int getWidth();
+    int getHeight();
+    int getSpectrumWidth();
+
+    void forward(const std::vector<double>& grid, std::vector<std::complex<double>>& spectrum);
+    void inverse(std::vector<std::complex<double>>& spectrum, std::vector<double>& grid);
+
+    // In-place radix-2 transform of n complex values (n a power of two) using twiddles for that n.
+    static void transform(std::complex<double>* data, int n, const std::vector<std::complex<double>>& twiddles,
+                          bool inverse);
+    static std::vector<std::complex<double>> makeTwiddles(int n);
+
+private:
+    int width;
+    int height;
+    int threadCount;
+    std::vector<std::complex<double>> rowTwiddles;
+    std::vector<std::complex<double>> columnTwiddles;
+    // e^(-2 pi i k / width) for the real-to-complex split.
+    std::vector<std::complex<double>> splitTwiddles;
+
+    void transformColumns(std::vector<std::complex<double>>& spectrum, bool inverse);
+};
+
+#endif // FFT_H
@@ -0,0 +1,108 @@
+#ifndef GRAVITY_KERNEL_H
+#define GRAVITY_KERNEL_H
+
+#include <algorithm>
+#include <cmath>
+#include <thread>
+#include <vector>
+#include "reduction.h"
+#include "softening.h"
+
+enum class Precision { Double, Float, Mixed };
+
+// Direct-sum gravity over structure-of-arrays storage. Position is the type bodies are stored in, Pair the type
+// the pairwise force is evaluated in and Accumulator the type the accelerations are summed in:
+//   <double, double, double> - same arithmetic as SimulationObject::applyGravity,
+//   <float, float, float>    - twice the SIMD width and half the memory traffic,
+//   <double, float, double>  - float pair math on exact double separations, summed in double.
+// Every body sums its own full row with the fixed-shape pairwise reduction, so rows can go to any thread and the
+// result does not depend on the thread count; the pairwise work is done twice in exchange, as in the diagnostics.
+template <typename Accumulator>
+struct ForceSum {
+    Accumulator x;
+    Accumulator y;
+
+    ForceSum operator+(const ForceSum& other) const
+    {
+        return {x + other.x, y + other.y};
+    }
+};
+
+template <typename Position, typename Pair, typename Accumulator>
+class GravityKernel {
+public:
+    GravityKernel()
+        : threadCount(std::max(1u, std::thread::hardware_concurrency())) {}
+
+    std::vector<Position> x;
+    std::vector<Position> y;
+    std::vector<Pair> mass;
+    std::vector<Accumulator> ax;
+    std::vector<Accumulator> ay;
+
+    void resize(size_t n)
+    {
+        x.resize(n);
+        y.resize(n);
+        mass.resize(n);
+        ax.resize(n);
+        ay.resize(n);
+    }
+
+    size_t size() const
+    {
+        return x.size();
+    }
+
+    void setThreadCount(int val)
+    {
+        threadCount = std::max(1, val);
+    }
+
+    void compute(double gforce, const Softening& softening)
+    {
+        switch (softening.kernel)
+        {
+        case SofteningKernel::Plummer:
+            compute<SofteningKernel::Plummer>(gforce, softening.length);
+            break;
+        case SofteningKernel::Spline:
+            compute<SofteningKernel::Spline>(gforce, softening.length);
+            break;
+        default:
+            compute<SofteningKernel::None>(gforce, softening.length);
+            break;
+        }
+    }
+
+    // One instantiation per softening kernel, so the pair loop has no branch on it.
+    template <SofteningKernel Softened>
+    void compute(double gforce, double softeningLength)
+    {
+        const size_t n = x.size();
+        const Pair length = static_cast<Pair>(softeningLength);
+
+        parallelFor(n, threadCount, 64, [&](size_t, size_t begin, size_t end) {
+            std::vector<ForceSum<Accumulator>> scratch;
+            for (size_t i = begin; i < end; ++i)
+            {
+                const Position xi = x[i];
+                const Position yi = y[i];
+                // The body itself has zero separation and adds nothing for any kernel.
+                ForceSum<Accumulator> sum = pairwiseSum<ForceSum<Accumulator>>(n, [&](size_t j) {
+                    const Pair dx = static_cast<Pair>(x[j] - xi);
+                    const Pair dy = static_cast<Pair>(y[j] - yi);
+                    const Pair scale = softenedInverseCube<Softened>(dx * dx + dy * dy, length) * mass[j];
+                    return ForceSum<Accumulator>{static_cast<Accumulator>(dx * scale), static_cast<Accumulator>(dy * scale)};
+                }, scratch);
+                ax[i] = static_cast<Accumulator>(gforce) * sum.x;
+                ay[i] = static_cast<Accumulator>(gforce) * sum.y;
+            }
+        });
+    }
+
+private:
+    int threadCount;
+};
+
+#endif // GRAVITY_KERNEL_H
@@ -0,0 +1,71 @@
+# The sources of gravitysimulator.pri for CMake projects (the Qt Quick app); keep the two lists in step.
+# Callers link Qt6::Widgets, the engine's widgets are compiled in even where they are not shown.
+
+set(GRAVSIM_ENGINE_DIR ${CMAKE_CURRENT_LIST_DIR})
+
+set(GRAVSIM_ENGINE_SOURCES
+    ${GRAVSIM_ENGINE_DIR}/diagnostics.cpp
+    ${GRAVSIM_ENGINE_DIR}/diagnosticsplot.cpp
+    ${GRAVSIM_ENGINE_DIR}/distributedsimulation.cpp
+    ${GRAVSIM_ENGINE_DIR}/domaindecomposition.cpp
+    ${GRAVSIM_ENGINE_DIR}/fft.cpp
+    ${GRAVSIM_ENGINE_DIR}/jobsystem.cpp
+    ${GRAVSIM_ENGINE_DIR}/mainwindow.cpp
+    ${GRAVSIM_ENGINE_DIR}/mortonorder.cpp
+    ${GRAVSIM_ENGINE_DIR}/neighbourlist.cpp
+    ${GRAVSIM_ENGINE_DIR}/pmsolver.cpp
+    ${GRAVSIM_ENGINE_DIR}/profiler.cpp
+    ${GRAVSIM_ENGINE_DIR}/regularization.cpp
+    ${GRAVSIM_ENGINE_DIR}/scenario.cpp
+    ${GRAVSIM_ENGINE_DIR}/simulationarea.cpp
+    ${GRAVSIM_ENGINE_DIR}/simulationcontroller.cpp
+    ${GRAVSIM_ENGINE_DIR}/simulationobject.cpp
+    ${GRAVSIM_ENGINE_DIR}/simulationobjectpool.cpp
+    ${GRAVSIM_ENGINE_DIR}/simulationobjecttile.cpp
+    ${GRAVSIM_ENGINE_DIR}/telemetrypublisher.cpp
+    ${GRAVSIM_ENGINE_DIR}/testparticles.cpp
+    ${GRAVSIM_ENGINE_DIR}/trajectorypreview.cpp
+    ${GRAVSIM_ENGINE_DIR}/treesolver.cpp
+    ${GRAVSIM_ENGINE_DIR}/transport.cpp
+    ${GRAVSIM_ENGINE_DIR}/boundary.h
+    ${GRAVSIM_ENGINE_DIR}/diagnostics.h
+    ${GRAVSIM_ENGINE_DIR}/diagnosticsplot.h
+    ${GRAVSIM_ENGINE_DIR}/distributedsimulation.h
+    ${GRAVSIM_ENGINE_DIR}/domaindecomposition.h
+    ${GRAVSIM_ENGINE_DIR}/fft.h
+    ${GRAVSIM_ENGINE_DIR}/gravitykernel.h
+    ${GRAVSIM_ENGINE_DIR}/jobsystem.h
+    ${GRAVSIM_ENGINE_DIR}/mainwindow.h
+    ${GRAVSIM_ENGINE_DIR}/mortonorder.h
+    ${GRAVSIM_ENGINE_DIR}/neighbourlist.h
+    ${GRAVSIM_ENGINE_DIR}/parallelfor.h
+    ${GRAVSIM_ENGINE_DIR}/pmsolver.h
+    ${GRAVSIM_ENGINE_DIR}/profiler.h
+    ${GRAVSIM_ENGINE_DIR}/reduction.h
+    ${GRAVSIM_ENGINE_DIR}/regularization.h
+    ${GRAVSIM_ENGINE_DIR}/scenario.h
+    ${GRAVSIM_ENGINE_DIR}/simulationarea.h
+    ${GRAVSIM_ENGINE_DIR}/simulationcontroller.h
+    ${GRAVSIM_ENGINE_DIR}/simulationobject.h
+    ${GRAVSIM_ENGINE_DIR}/simulationobjectpool.h
+    ${GRAVSIM_ENGINE_DIR}/simulationobjecttile.h
+    ${GRAVSIM_ENGINE_DIR}/softening.h
+    ${GRAVSIM_ENGINE_DIR}/telemetry.h
+    ${GRAVSIM_ENGINE_DIR}/telemetrypublisher.h
+    ${GRAVSIM_ENGINE_DIR}/testparticles.h
+    ${GRAVSIM_ENGINE_DIR}/trajectorypreview.h
+    ${GRAVSIM_ENGINE_DIR}/treesolver.h
+    ${GRAVSIM_ENGINE_DIR}/transport.h
+)
+
+find_package(Threads REQUIRED)
+set(GRAVSIM_ENGINE_LIBRARIES Threads::Threads)
+if (UNIX AND NOT APPLE)
+    list(APPEND GRAVSIM_ENGINE_LIBRARIES rt)
+endif()
+
+# -DGRAVSIM_PROFILING=ON enables the per-phase timers, as CONFIG+=profiling does for qmake.
+option(GRAVSIM_PROFILING "Per-phase engine timers" OFF)
+if (GRAVSIM_PROFILING)
+    add_compile_definitions(GRAVSIM_PROFILING)
+endif()
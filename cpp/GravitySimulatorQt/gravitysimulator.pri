@@ -0,0 +1,65 @@
+# Simulation and widget sources shared by the application and the tools built on top of it.
+# gravitysimulator.cmake lists the same files for the CMake-built Qt Quick app.
+
+INCLUDEPATH += $$PWD
+
+SOURCES += \
+    $$PWD/diagnostics.cpp \
+    $$PWD/diagnosticsplot.cpp \
+    $$PWD/distributedsimulation.cpp \
+    $$PWD/domaindecomposition.cpp \
+    $$PWD/fft.cpp \
+    $$PWD/jobsystem.cpp \
+    $$PWD/mainwindow.cpp \
+    $$PWD/mortonorder.cpp \
+    $$PWD/neighbourlist.cpp \
+    $$PWD/pmsolver.cpp \
+    $$PWD/profiler.cpp \
+    $$PWD/regularization.cpp \
+    $$PWD/scenario.cpp \
+    $$PWD/simulationarea.cpp \
+    $$PWD/simulationcontroller.cpp \
+    $$PWD/simulationobject.cpp \
+    $$PWD/simulationobjectpool.cpp \
+    $$PWD/simulationobjecttile.cpp \
+    $$PWD/telemetrypublisher.cpp \
+    $$PWD/testparticles.cpp \
+    $$PWD/trajectorypreview.cpp \
+    $$PWD/treesolver.cpp \
+    $$PWD/transport.cpp
+
+HEADERS += \
+    $$PWD/boundary.h \
+    $$PWD/diagnostics.h \
+    $$PWD/diagnosticsplot.h \
+    $$PWD/distributedsimulation.h \
+    $$PWD/domaindecomposition.h \
+    $$PWD/fft.h \
+    $$PWD/gravitykernel.h \
+    $$PWD/jobsystem.h \
+    $$PWD/mainwindow.h \
+    $$PWD/mortonorder.h \
+    $$PWD/neighbourlist.h \
+    $$PWD/parallelfor.h \
+    $$PWD/pmsolver.h \
+    $$PWD/profiler.h \
+    $$PWD/reduction.h \
+    $$PWD/regularization.h \
+    $$PWD/scenario.h \
+    $$PWD/simulationarea.h \
+    $$PWD/simulationcontroller.h \
+    $$PWD/simulationobject.h \
+    $$PWD/simulationobjectpool.h \
+    $$PWD/simulationobjecttile.h \
+    $$PWD/softening.h \
+    $$PWD/telemetry.h \
+    $$PWD/telemetrypublisher.h \
+    $$PWD/testparticles.h \
+    $$PWD/trajectorypreview.h \
+    $$PWD/treesolver.h \
+    $$PWD/transport.h
+
+unix:!macx: LIBS += -lrt
+
+# qmake CONFIG+=profiling enables the per-phase timers, the overlay and trace export.
+CONFIG(profiling): DEFINES += GRAVSIM_PROFILING
@@ -0,0 +1,310 @@
+#include "jobsystem.h"
+#include <algorithm>
+#include "profiler.h"
+
+struct Job {
+    std::function<void()> run;
+    // Unfinished dependencies, plus one held by submit() until they are all registered.
+    std::atomic<int> pending;
+    std::atomic<bool> finished;
+    std::mutex mutex;
+    std::vector<JobHandle> dependents;
+};
+
+struct JobSystem::RangeLoop {
+    const std::function<void(size_t, size_t)>* work;
+    size_t grain;
+    std::atomic<size_t> remaining;
+};
+
+namespace {
+
+thread_local JobSystem* currentSystem = nullptr;
+thread_local int currentWorker = -1;
+// Whether the job running on this thread was taken from another thread's deque.
+thread_local bool runningStolen = false;
+// Time inside the running job that belongs to nested jobs or to idle waiting, so it is not counted twice.
+thread_local uint64_t excludedNanoseconds = 0;
+
+JobHandle makeJob(std::function<void()> run)
+{
+    JobHandle job = std::make_shared<Job>();
+    job->run = std::move(run);
+    job->pending.store(0, std::memory_order_relaxed);
+    job->finished.store(false, std::memory_order_relaxed);
+    return job;
+}
+
+}
+
+JobSystem& JobSystem::instance()
+{
+    static JobSystem system(static_cast<int>(std::thread::hardware_concurrency()) - 1);
+    return system;
+}
+
+JobSystem::JobSystem(int workerCount)
+    : queued(0), stopping(false)
+{
+    workerCount = std::max(0, workerCount);
+    for (int i = 0; i <= workerCount; ++i)
+    {
+        queues.emplace_back(new Queue());
+        queues.back()->busyNanoseconds.store(0, std::memory_order_relaxed);
+        queues.back()->jobCount.store(0, std::memory_order_relaxed);
+        queues.back()->stealCount.store(0, std::memory_order_relaxed);
+    }
+    for (int i = 0; i < workerCount; ++i)
+        workers.emplace_back(&JobSystem::workerLoop, this, i);
+}
+
+JobSystem::~JobSystem()
+{
+    {
+        std::lock_guard<std::mutex> lock(sleepMutex);
+        stopping = true;
+    }
+    sleeping.notify_all();
+    for (std::thread& worker : workers)
+        worker.join();
+}
+
+JobHandle JobSystem::submit(std::function<void()> job, const std::vector<JobHandle>& dependencies)
+{
+    JobHandle handle = makeJob(std::move(job));
+    handle->pending.store(1, std::memory_order_relaxed);
+    for (const JobHandle& dependency : dependencies)
+    {
+        if (!dependency)
+            continue;
+        std::lock_guard<std::mutex> lock(dependency->mutex);
+        if (!dependency->finished.load(std::memory_order_relaxed))
+        {
+            handle->pending.fetch_add(1, std::memory_order_relaxed);
+            dependency->dependents.push_back(handle);
+        }
+    }
+    if (handle->pending.fetch_sub(1, std::memory_order_acq_rel) == 1)
+        push(handle);
+    return handle;
+}
+
+void JobSystem::wait(const JobHandle& job)
+{
+    if (job)
+        helpUntil([&job] { return job->finished.load(std::memory_order_acquire); });
+}
+
+void JobSystem::runTasks(size_t count, const std::function<void(size_t)>& task)
+{
+    if (count == 0)
+        return;
+
+    std::atomic<size_t> remaining(count);
+    for (size_t i = 1; i < count; ++i)
+    {
+        push(makeJob([&task, &remaining, i] {
+            task(i);
+            remaining.fetch_sub(1, std::memory_order_acq_rel);
+        }));
+    }
+    execute(makeJob([&task, &remaining] {
+        task(0);
+        remaining.fetch_sub(1, std::memory_order_acq_rel);
+    }), currentQueue(), false);
+    helpUntil([&remaining] { return remaining.load(std::memory_order_acquire) == 0; });
+}
+
+void JobSystem::parallelFor(size_t count, int threadCount, size_t minGrain, const std::function<void(size_t, size_t)>& work)
+{
+    size_t grain = std::max<size_t>(1, minGrain);
+    size_t threads = std::min<size_t>(std::max(1, threadCount), queues.size());
+    if (threads == 1 || count < 2 * grain)
+    {
+        if (count > 0)
+            work(0, count);
+        return;
+    }
+
+    int splits = 0;
+    while ((static_cast<size_t>(1) << splits) < 4 * threads)
+        ++splits;
+    std::shared_ptr<RangeLoop> loop = std::make_shared<RangeLoop>();
+    loop->work = &work;
+    loop->grain = grain;
+    loop->remaining.store(count, std::memory_order_relaxed);
+    execute(makeJob([this, &loop, count, splits] { runRange(loop, 0, count, splits); }), currentQueue(), false);
+    helpUntil([&loop] { return loop->remaining.load(std::memory_order_acquire) == 0; });
+}
+
+// Halves are pushed to the back of this thread's deque and thieves take them from the front, so the first
+// steal gets half of the whole range. A stolen piece means some thread ran dry, so it may be split further.
+void JobSystem::runRange(const std::shared_ptr<RangeLoop>& loop, size_t begin, size_t end, int splits)
+{
+    if (runningStolen)
+        splits += 2;
+    while (splits > 0 && end - begin >= 2 * loop->grain)
+    {
+        size_t middle = begin + (end - begin) / 2;
+        --splits;
+        push(makeJob([this, loop, middle, end, splits] { runRange(loop, middle, end, splits); }));
+        end = middle;
+    }
+    (*loop->work)(begin, end);
+    loop->remaining.fetch_sub(end - begin, std::memory_order_acq_rel);
+}
+
+int JobSystem::getWorkerCount()
+{
+    return static_cast<int>(workers.size());
+}
+
+std::vector<WorkerStats> JobSystem::getStats()
+{
+    std::vector<WorkerStats> stats;
+    for (const std::unique_ptr<Queue>& slot : queues)
+    {
+        stats.push_back({slot->busyNanoseconds.load(std::memory_order_relaxed), slot->jobCount.load(std::memory_order_relaxed),
+                         slot->stealCount.load(std::memory_order_relaxed)});
+    }
+    return stats;
+}
+
+void JobSystem::resetStats()
+{
+    for (const std::unique_ptr<Queue>& slot : queues)
+    {
+        slot->busyNanoseconds.store(0, std::memory_order_relaxed);
+        slot->jobCount.store(0, std::memory_order_relaxed);
+        slot->stealCount.store(0, std::memory_order_relaxed);
+    }
+}
+
+int JobSystem::currentQueue()
+{
+    return currentSystem == this ? currentWorker : static_cast<int>(queues.size()) - 1;
+}
+
+void JobSystem::push(const JobHandle& job)
+{
+    Queue& slot = *queues[currentQueue()];
+    {
+        std::lock_guard<std::mutex> lock(slot.mutex);
+        slot.jobs.push_back(job);
+    }
+    queued.fetch_add(1, std::memory_order_release);
+    if (workers.empty())
+        return;
+    {
+        std::lock_guard<std::mutex> lock(sleepMutex);
+    }
+    sleeping.notify_one();
+}
+
+JobHandle JobSystem::take(int slot, bool* stolen)
+{
+    if (queued.load(std::memory_order_acquire) <= 0)
+        return nullptr;
+
+    {
+        Queue& own = *queues[slot];
+        std::lock_guard<std::mutex> lock(own.mutex);
+        if (!own.jobs.empty())
+        {
+            JobHandle job = std::move(own.jobs.back());
+            own.jobs.pop_back();
+            queued.fetch_sub(1, std::memory_order_relaxed);
+            *stolen = false;
+            return job;
+        }
+    }
+
+    int count = static_cast<int>(queues.size());
+    for (int k = 1; k < count; ++k)
+    {
+        Queue& victim = *queues[(slot + k) % count];
+        std::lock_guard<std::mutex> lock(victim.mutex);
+        if (!victim.jobs.empty())
+        {
+            JobHandle job = std::move(victim.jobs.front());
+            victim.jobs.pop_front();
+            queued.fetch_sub(1, std::memory_order_relaxed);
+            *stolen = true;
+            return job;
+        }
+    }
+    return nullptr;
+}
+
+void JobSystem::execute(const JobHandle& job, int slot, bool stolen)
+{
+    bool outerStolen = runningStolen;
+    uint64_t outerExcluded = excludedNanoseconds;
+    runningStolen = stolen;
+    excludedNanoseconds = 0;
+
+    uint64_t start = Profiler::now();
+    job->run();
+    job->run = nullptr;
+    uint64_t elapsed = Profiler::now() - start;
+
+    Queue& counters = *queues[slot];
+    counters.busyNanoseconds.fetch_add(elapsed - std::min(elapsed, excludedNanoseconds), std::memory_order_relaxed);
+    counters.jobCount.fetch_add(1, std::memory_order_relaxed);
+    if (stolen)
+        counters.stealCount.fetch_add(1, std::memory_order_relaxed);
+    runningStolen = outerStolen;
+    excludedNanoseconds = outerExcluded + elapsed;
+    finish(job);
+}
+
+void JobSystem::finish(const JobHandle& job)
+{
+    std::vector<JobHandle> ready;
+    {
+        std::lock_guard<std::mutex> lock(job->mutex);
+        job->finished.store(true, std::memory_order_release);
+        ready.swap(job->dependents);
+    }
+    for (const JobHandle& dependent : ready)
+        if (dependent->pending.fetch_sub(1, std::memory_order_acq_rel) == 1)
+            push(dependent);
+}
+
+void JobSystem::helpUntil(const std::function<bool()>& done)
+{
+    int slot = currentQueue();
+    while (!done())
+    {
+        bool stolen = false;
+        JobHandle job = take(slot, &stolen);
+        if (job)
+        {
+            execute(job, slot, stolen);
+            continue;
+        }
+        uint64_t start = Profiler::now();
+        std::this_thread::yield();
+        excludedNanoseconds += Profiler::now() - start;
+    }
+}
+
+void JobSystem::workerLoop(int slot)
+{
+    currentSystem = this;
+    currentWorker = slot;
+    for (;;)
+    {
+        bool stolen = false;
+        JobHandle job = take(slot, &stolen);
+        if (job)
+        {
+            execute(job, slot, stolen);
+            continue;
+        }
+        std::unique_lock<std::mutex> lock(sleepMutex);
+        sleeping.wait(lock, [this] { return stopping || queued.load(std::memory_order_acquire) > 0; });
+        if (stopping)
+            return;
+    }
+}
@@ -0,0 +1,79 @@
+#ifndef JOB_SYSTEM_H
+#define JOB_SYSTEM_H
+
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+struct Job;
+typedef std::shared_ptr<Job> JobHandle;
+
+// Time a thread spent running jobs, excluding the time it waited for nested jobs, and the number of jobs
+// it ran, of which stolen came from another thread's deque.
+struct WorkerStats {
+    uint64_t busyNanoseconds;
+    uint64_t jobs;
+    uint64_t steals;
+};
+
+// Engine-wide work-stealing pool. Every worker owns a deque: it pushes and pops its own jobs at the back and
+// steals from the front of the others, so thieves take the oldest and, for split ranges, largest pieces.
+// Threads outside the pool (the GUI thread, tools) share one extra deque. A thread waiting for a job runs other
+// jobs in the meantime, so jobs may themselves submit and wait.
+class JobSystem {
+public:
+    static JobSystem& instance();
+
+    explicit JobSystem(int workerCount);
+    ~JobSystem();
+
+    // Queues job to run once all dependencies have finished; empty handles count as finished.
+    JobHandle submit(std::function<void()> job, const std::vector<JobHandle>& dependencies = {});
+    void wait(const JobHandle& job);
+    // Runs task(0) ... task(count - 1) as separate jobs, task(0) on the calling thread, and returns when all
+    // have finished.
+    void runTasks(size_t count, const std::function<void(size_t)>& task);
+    // Runs work(begin, end) over [0, count). The range is halved up front into about four pieces per thread
+    // and a piece is halved again whenever it is stolen, down to minGrain items, so uneven work spreads
+    // itself over idle workers. A threadCount of 1 runs the whole range on the calling thread.
+    void parallelFor(size_t count, int threadCount, size_t minGrain, const std::function<void(size_t, size_t)>& work);
+
+    int getWorkerCount();
+    // One entry per worker, then one shared by all threads outside the pool.
+    std::vector<WorkerStats> getStats();
+    void resetStats();
+
+private:
+    struct alignas(64) Queue {
+        std::mutex mutex;
+        std::deque<JobHandle> jobs;
+        std::atomic<uint64_t> busyNanoseconds;
+        std::atomic<uint64_t> jobCount;
+        std::atomic<uint64_t> stealCount;
+    };
+    struct RangeLoop;
+
+    std::vector<std::unique_ptr<Queue>> queues;
+    std::vector<std::thread> workers;
+    std::atomic<int> queued;
+    std::mutex sleepMutex;
+    std::condition_variable sleeping;
+    bool stopping;
+
+    int currentQueue();
+    void push(const JobHandle& job);
+    JobHandle take(int slot, bool* stolen);
+    void execute(const JobHandle& job, int slot, bool stolen);
+    void finish(const JobHandle& job);
+    void helpUntil(const std::function<bool()>& done);
+    void runRange(const std::shared_ptr<RangeLoop>& loop, size_t begin, size_t end, int splits);
+    void workerLoop(int slot);
+};
+
+#endif // JOB_SYSTEM_H
@@ -8,9 +8,23 @@ int main(int argc, char *argv[])
     QApplication a(argc, argv);
     MainAppWindow mainAppWindow;
     QTimer timer;
+    QString telemetryName = qEnvironmentVariable("GRAVSIM_TELEMETRY");
+    if (!telemetryName.isEmpty() && !mainAppWindow.getController()->enableTelemetry(telemetryName, 16, 16384))
+        qWarning() << "Nie udało się utworzyć kanału telemetrii" << telemetryName;
+
+    QString diagnosticsLog = qEnvironmentVariable("GRAVSIM_DIAGNOSTICS_LOG");
+    if (!diagnosticsLog.isEmpty())
+    {
+        if (!mainAppWindow.getController()->getDiagnostics().openLog(diagnosticsLog.toStdString()))
+            qWarning() << "Nie udało się otworzyć dziennika diagnostyki" << diagnosticsLog;
+        mainAppWindow.getController()->setDiagnosticsInterval(10);
+    }
+
     SimulationArea* simulationArea = mainAppWindow.getSimulationArea();
     QObject::connect(&timer, &QTimer::timeout, simulationArea, &SimulationArea::updateSimulation);
     QObject::connect(&timer, &QTimer::timeout, &mainAppWindow, &MainAppWindow::updateTiles);
+    QObject::connect(&timer, &QTimer::timeout, &mainAppWindow, &MainAppWindow::updateDiagnostics);
+    QObject::connect(&timer, &QTimer::timeout, &mainAppWindow, &MainAppWindow::refreshPreview);
     QObject::connect(&timer, &QTimer::timeout, mainAppWindow.getController(), &SimulationController::brr);
     timer.start(1);
     mainAppWindow.show();
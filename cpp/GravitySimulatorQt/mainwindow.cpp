@@ -1,7 +1,9 @@
 #include "mainwindow.h"
 #include "simulationobjecttile.h"
-#include "SimulationArea.h"
+#include "simulationarea.h"
 #include <QDateTime>
+#include <QFileDialog>
+#include <QHash>
 
 SimulationArea* MainAppWindow::getSimulationArea()
 {
@@ -24,6 +26,7 @@ MainAppWindow::MainAppWindow() : simulationArea() {
     controller = new SimulationController(this, QPoint(500, 500), QPoint(100, 100), 6.67408, false, 1.0, 0.0, true, nullptr);
     controller->setParent(this);
     simulationArea = new SimulationArea(this, controller);
+    previewTimer.start();
     rootWidget = new QWidget(this);
     setCentralWidget(rootWidget);
     rootLayout = new QVBoxLayout(rootWidget);
@@ -164,6 +167,39 @@ void MainAppWindow::toggleAdding() {
             setInfoLabel("brak obiektów do edycji!");
         }
     }
+    updatePreview();
+}
+
+// Predicts where the body being placed or edited would go with the values typed so far; empty fields fall back
+// to what adding or editing would use. In adding mode the body starts under the cursor unless a position is typed.
+void MainAppWindow::updatePreview() {
+    previewTimer.restart();
+    QPointF cursor;
+    bool hovering = simulationArea->getCursorPosition(cursor);
+    SimulationObject *edited = controller->getEditedObject();
+    if (!controller->getIsAdding() && edited) {
+        std::pair<double, double> position = edited->getPosition();
+        std::pair<double, double> velocity = edited->getVelocity();
+        controller->previewTrajectory(getPositionEditValue(position.first, position.second),
+                                      getVelocityEditValue(velocity.first, velocity.second),
+                                      getMassEditValue(edited->getMass()), getRadiusEditValue(edited->getRadius()),
+                                      edited);
+    } else if (controller->getIsAdding() &&
+               (hovering || (!positionEditX->text().isEmpty() && !positionEditY->text().isEmpty()))) {
+        controller->previewTrajectory(getPositionEditValue(cursor.x(), cursor.y()), getVelocityEditValue(0.0, 0.0),
+                                      getMassEditValue(10.0), getRadiusEditValue(10.0), nullptr);
+    } else {
+        controller->clearPreview();
+    }
+}
+
+// While the simulation runs the other bodies move away from the state a preview started from, so it is redone
+// a few times per second, but never before it finished: a whole-system prediction could otherwise never get far.
+void MainAppWindow::refreshPreview() {
+    if (!controller->getIsPaused() && previewTimer.elapsed() >= 250 &&
+        controller->getTrajectoryPreview().getIsComplete()) {
+        updatePreview();
+    }
 }
 
 void MainAppWindow::showNewSimulationDialogue() {
@@ -188,11 +224,38 @@ void MainAppWindow::showNewSimulationDialogue() {
     }
 }
 
-QList<SimulationObjectTile*> MainAppWindow::getObjectTiles()
+QList<SimulationObjectTile*>& MainAppWindow::getObjectTiles()
 {
     return objectTiles;
 }
 
+// Called once after the controller removed or moved bodies: tiles of removed bodies are dropped in one batch
+// and the others are pointed at their body's current pool slot.
+void MainAppWindow::syncObjectTiles() {
+    if (objectTiles.isEmpty()) {
+        return;
+    }
+
+    QHash<quint64, SimulationObject*> objectsById;
+    for (SimulationObject *o : controller->getSimulationObjects()) {
+        objectsById.insert(o->getId(), o);
+    }
+
+    objectPanel->setUpdatesEnabled(false);
+    QList<SimulationObjectTile*> kept;
+    for (SimulationObjectTile *tile : objectTiles) {
+        SimulationObject *o = objectsById.value(tile->getId(), nullptr);
+        if (o) {
+            tile->setSimulationObject(o);
+            kept.append(tile);
+        } else {
+            tile->detach();
+        }
+    }
+    objectTiles = kept;
+    objectPanel->setUpdatesEnabled(true);
+}
+
 void MainAppWindow::changeSimulationSpeed() {
     bool conversionOk;
     double newSpeed = simSpeedField->text().replace(',', '.').toDouble(&conversionOk);
@@ -203,11 +266,42 @@ void MainAppWindow::changeSimulationSpeed() {
 }
 
 void MainAppWindow::updateTiles() {
-    for (SimulationObjectTile *tile : objectTiles) {
+    PROFILE_SCOPE(ProfilePhase::Tiles);
+    // Tiles of removed bodies are dropped in a batch by syncObjectTiles(); iterating over a copy only guards
+    // against a tile whose pool slot changed hands removing itself on the way.
+    const QList<SimulationObjectTile*> tiles = objectTiles;
+    for (SimulationObjectTile *tile : tiles) {
         tile->update();
     }
 }
 
+void MainAppWindow::updateDiagnostics() {
+    if (controller->getDiagnosticsInterval() > 0)
+        diagnosticsPlot->update();
+}
+
+void MainAppWindow::toggleDiagnostics(bool val) {
+    controller->setDiagnosticsInterval(val ? 10 : 0);
+    if (val)
+        controller->measureDiagnostics();
+    diagnosticsPlot->update();
+}
+
+void MainAppWindow::toggleMerging(bool val) {
+    controller->setCollisionMode(val ? CollisionMode::Merge : CollisionMode::Bounce);
+    setInfoLabel(val ? "zderzające się obiekty łączą się" : "zderzające się obiekty odbijają się");
+}
+
+void MainAppWindow::changeBoundaryPolicy(int index) {
+    controller->setBoundaryPolicy(static_cast<BoundaryPolicy>(boundaryComboBox->itemData(index).toInt()));
+    setInfoLabel("brzeg obszaru: " + boundaryComboBox->itemText(index));
+}
+
+void MainAppWindow::togglePreviewMoveSources(bool val) {
+    controller->getTrajectoryPreview().setMoveSources(val);
+    updatePreview();
+}
+
 void MainAppWindow::createMenuBar() {
     aboutMenu = new QMenu("O aplikacji");
     menuBar = new QMenuBar();
@@ -218,6 +312,37 @@ void MainAppWindow::createMenuBar() {
     newAction->setText("Opis aplikacji:\nAplikacja służy do symulowania oddziaływań grawitacyjnych\
  pomiędzy obiektami o zadanych masach.\nZasymulowano również niecentralne odbicia idealnie sprężyste.");
     aboutMenu->addAction(newAction);
+
+#ifdef GRAVSIM_PROFILING
+    profilingMenu = menuBar->addMenu("Profilowanie");
+    QAction *overlayAction = profilingMenu->addAction("Nakładka wydajności");
+    overlayAction->setCheckable(true);
+    connect(overlayAction, &QAction::toggled, this, &MainAppWindow::toggleProfilingOverlay);
+    QAction *traceAction = profilingMenu->addAction("Nagrywaj ślad");
+    traceAction->setCheckable(true);
+    connect(traceAction, &QAction::toggled, this, [](bool val) { Profiler::setTracing(val); });
+    QAction *exportAction = profilingMenu->addAction("Eksportuj ślad...");
+    connect(exportAction, &QAction::triggered, this, &MainAppWindow::exportProfilingTrace);
+#else
+    profilingMenu = nullptr;
+#endif
+}
+
+void MainAppWindow::toggleProfilingOverlay(bool val)
+{
+    simulationArea->setOverlayVisible(val);
+}
+
+void MainAppWindow::exportProfilingTrace()
+{
+    QString path = QFileDialog::getSaveFileName(this, "Eksportuj ślad", "gravsim-trace.json", "Chrome trace (*.json)");
+    if (path.isEmpty())
+        return;
+
+    if (Profiler::exportTrace(path.toStdString()))
+        setInfoLabel("zapisano ślad do " + path);
+    else
+        setInfoLabel("nie udało się zapisać śladu");
 }
 
 void MainAppWindow::createObjectPanel() {
@@ -285,6 +410,13 @@ void MainAppWindow::createPropertiesPanel() {
     connect(positionEditX, &QLineEdit::returnPressed, this, &MainAppWindow::adjustEdited);
     connect(positionEditY, &QLineEdit::returnPressed, this, &MainAppWindow::adjustEdited);
 
+    connect(massEdit, &QLineEdit::textChanged, this, &MainAppWindow::updatePreview);
+    connect(radiusEdit, &QLineEdit::textChanged, this, &MainAppWindow::updatePreview);
+    connect(velocityEditX, &QLineEdit::textChanged, this, &MainAppWindow::updatePreview);
+    connect(velocityEditY, &QLineEdit::textChanged, this, &MainAppWindow::updatePreview);
+    connect(positionEditX, &QLineEdit::textChanged, this, &MainAppWindow::updatePreview);
+    connect(positionEditY, &QLineEdit::textChanged, this, &MainAppWindow::updatePreview);
+
     propertiesLayout->addWidget(nameLabel);
     propertiesLayout->addWidget(nameEdit);
     propertiesLayout->addWidget(massLabel);
@@ -297,6 +429,30 @@ void MainAppWindow::createPropertiesPanel() {
     propertiesLayout->addWidget(positionEditRow);
     propertiesLayout->addWidget(addEditButton2);
 
+    previewCheckBox = new QCheckBox("Podgląd ruchu całego układu", this);
+    connect(previewCheckBox, &QCheckBox::toggled, this, &MainAppWindow::togglePreviewMoveSources);
+    propertiesLayout->addWidget(previewCheckBox);
+
+    mergeCheckBox = new QCheckBox("Łączenie przy zderzeniach", this);
+    connect(mergeCheckBox, &QCheckBox::toggled, this, &MainAppWindow::toggleMerging);
+    propertiesLayout->addWidget(mergeCheckBox);
+
+    boundaryLabel = new QLabel("Brzeg obszaru", this);
+    boundaryComboBox = new QComboBox(this);
+    boundaryComboBox->addItem("otwarty", static_cast<int>(BoundaryPolicy::Open));
+    boundaryComboBox->addItem("odbijający", static_cast<int>(BoundaryPolicy::Reflect));
+    boundaryComboBox->addItem("periodyczny", static_cast<int>(BoundaryPolicy::Periodic));
+    boundaryComboBox->addItem("pochłaniający", static_cast<int>(BoundaryPolicy::Absorb));
+    connect(boundaryComboBox, &QComboBox::currentIndexChanged, this, &MainAppWindow::changeBoundaryPolicy);
+    propertiesLayout->addWidget(boundaryLabel);
+    propertiesLayout->addWidget(boundaryComboBox);
+
+    diagnosticsCheckBox = new QCheckBox("Diagnostyka (co 10 kroków)", this);
+    connect(diagnosticsCheckBox, &QCheckBox::toggled, this, &MainAppWindow::toggleDiagnostics);
+    diagnosticsPlot = new DiagnosticsPlot(this, controller);
+    propertiesLayout->addWidget(diagnosticsCheckBox);
+    propertiesLayout->addWidget(diagnosticsPlot);
+
     nameEdit->installEventFilter(this);
 
     propertiesLayout->addStretch();
@@ -11,16 +11,20 @@
 #include <QPushButton>
 #include <QLabel>
 #include <QLineEdit>
+#include <QCheckBox>
+#include <QComboBox>
 #include <QDoubleValidator>
 #include <QMessageBox>
 #include <QDateTime>
 #include "simulationcontroller.h"
-#include "SimulationArea.h"
+#include "simulationarea.h"
 #include "simulationobjecttile.h"
+#include "diagnosticsplot.h"
 
 class SimulationArea;
 class SimulationController;
 class SimulationObjectTile;
+class DiagnosticsPlot;
 
 class MainAppWindow : public QMainWindow {
     Q_OBJECT
@@ -31,7 +35,8 @@ public:
     SimulationController* getController();
     QVBoxLayout* getSimulationObjectLayout();
     void setInfoLabel(const QString &text);
-    QList<SimulationObjectTile*> getObjectTiles();
+    QList<SimulationObjectTile*>& getObjectTiles();
+    void syncObjectTiles();
     QString getNameEditValue(QString defaultValue);
     double getMassEditValue(double defaultValue);
     double getRadiusEditValue(double defaultValue);
@@ -42,8 +47,11 @@ public:
 
 public slots:
     void updateTiles();
+    void updateDiagnostics();
     void addObjectTile(SimulationObject *o);
     void toggleAdding();
+    void updatePreview();
+    void refreshPreview();
 
 private slots:
     void adjustEdited();
@@ -52,6 +60,12 @@ private slots:
     void togglePause();
     void showNewSimulationDialogue();
     void changeSimulationSpeed();
+    void toggleProfilingOverlay(bool val);
+    void exportProfilingTrace();
+    void toggleDiagnostics(bool val);
+    void toggleMerging(bool val);
+    void changeBoundaryPolicy(int index);
+    void togglePreviewMoveSources(bool val);
 
 private:
     SimulationController *controller;
@@ -63,6 +77,7 @@ private:
     QMenuBar *menuBar;
     QMenu *aboutMenu;
     QAction *newAction;
+    QMenu *profilingMenu;
     QWidget *menuBarWidget;
     QHBoxLayout *menuBarLayout;
     QLabel *infoLabel;
@@ -95,6 +110,13 @@ private:
     QLabel *positionLabelX;
     QLabel *positionLabelY;
     QWidget *positionEditRow;
+    QCheckBox *diagnosticsCheckBox;
+    QCheckBox *mergeCheckBox;
+    QCheckBox *previewCheckBox;
+    QElapsedTimer previewTimer;
+    QLabel *boundaryLabel;
+    QComboBox *boundaryComboBox;
+    DiagnosticsPlot *diagnosticsPlot;
     QWidget *aboutView;
     QVBoxLayout *aboutViewLayout;
     QLabel *aboutViewTextLabel;
@@ -0,0 +1,115 @@
+#include "mortonorder.h"
+#include <algorithm>
+#include <array>
+#include <thread>
+#include "parallelfor.h"
+
+MortonOrder::MortonOrder()
+    : threadCount(std::max(1u, std::thread::hardware_concurrency())) {}
+
+std::vector<double>& MortonOrder::getX()
+{
+    return x;
+}
+
+std::vector<double>& MortonOrder::getY()
+{
+    return y;
+}
+
+void MortonOrder::setThreadCount(int val)
+{
+    threadCount = std::max(1, val);
+}
+
+uint32_t MortonOrder::interleave(uint32_t x, uint32_t y)
+{
+    auto spread = [](uint32_t v) {
+        v &= 0xffff;
+        v = (v | (v << 8)) & 0x00ff00ff;
+        v = (v | (v << 4)) & 0x0f0f0f0f;
+        v = (v | (v << 2)) & 0x33333333;
+        v = (v | (v << 1)) & 0x55555555;
+        return v;
+    };
+    return spread(x) | (spread(y) << 1);
+}
+
+double MortonOrder::computeKeys()
+{
+    size_t n = std::min(x.size(), y.size());
+    entries.resize(n);
+    if (n == 0)
+        return 0.0;
+
+    double minX = x[0], maxX = x[0], minY = y[0], maxY = y[0];
+    for (size_t i = 1; i < n; ++i)
+    {
+        minX = std::min(minX, x[i]);
+        maxX = std::max(maxX, x[i]);
+        minY = std::min(minY, y[i]);
+        maxY = std::max(maxY, y[i]);
+    }
+
+    // Square cells, so the curve does not favour one axis when the box is elongated.
+    double extent = std::max(maxX - minX, maxY - minY);
+    double scale = extent > 0.0 ? 65535.0 / extent : 0.0;
+    size_t inversions = 0;
+    for (size_t i = 0; i < n; ++i)
+    {
+        uint32_t cellX = static_cast<uint32_t>((x[i] - minX) * scale);
+        uint32_t cellY = static_cast<uint32_t>((y[i] - minY) * scale);
+        entries[i] = (static_cast<uint64_t>(interleave(cellX, cellY)) << 32) | i;
+        if (i > 0 && (entries[i - 1] >> 32) > (entries[i] >> 32))
+            ++inversions;
+    }
+    return n > 1 ? static_cast<double>(inversions) / (n - 1) : 0.0;
+}
+
+// Four stable passes over the key bytes. Every worker histograms its own range, the offsets are laid out
+// digit-major then worker-major, and each worker scatters its range without synchronisation.
+void MortonOrder::sort()
+{
+    size_t n = entries.size();
+    scratch.resize(n);
+    size_t workers = std::min<size_t>(threadCount, std::max<size_t>(1, n / 65536));
+    std::vector<std::array<size_t, 256>> counts(workers);
+
+    for (int shift = 32; shift < 64; shift += 8)
+    {
+        parallelFor(n, static_cast<int>(workers), 65536, [this, &counts, shift](size_t w, size_t begin, size_t end) {
+            counts[w].fill(0);
+            for (size_t i = begin; i < end; ++i)
+                ++counts[w][(entries[i] >> shift) & 0xff];
+        });
+
+        size_t offset = 0;
+        bool single = false;
+        for (int digit = 0; digit < 256 && !single; ++digit)
+        {
+            size_t total = 0;
+            for (size_t w = 0; w < workers; ++w)
+            {
+                size_t count = counts[w][digit];
+                counts[w][digit] = offset;
+                offset += count;
+                total += count;
+            }
+            single = total == n;
+        }
+        // Every key has the same digit, the pass would not move anything.
+        if (single)
+            continue;
+
+        parallelFor(n, static_cast<int>(workers), 65536, [this, &counts, shift](size_t w, size_t begin, size_t end) {
+            for (size_t i = begin; i < end; ++i)
+                scratch[counts[w][(entries[i] >> shift) & 0xff]++] = entries[i];
+        });
+        entries.swap(scratch);
+    }
+}
+
+uint32_t MortonOrder::getIndex(size_t i)
+{
+    return static_cast<uint32_t>(entries[i]);
+}
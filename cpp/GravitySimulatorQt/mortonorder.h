@@ -0,0 +1,36 @@
+#ifndef MORTON_ORDER_H
+#define MORTON_ORDER_H
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+// Z-order (Morton) keys of a set of points and the permutation that sorts them. Keys are 16 bits per axis over
+// the bounding box of the points; the sort is a least-significant-digit radix sort split across threads.
+class MortonOrder {
+public:
+    MortonOrder();
+
+    // Points are staged here by the caller before computeKeys().
+    std::vector<double>& getX();
+    std::vector<double>& getY();
+    // Fraction of neighbouring points in staged order whose keys are out of order:
+    // 0 for Morton order, about 0.5 for a random one.
+    double computeKeys();
+    void sort();
+    // Staged index of the i-th point in Morton order, valid after sort().
+    uint32_t getIndex(size_t i);
+    void setThreadCount(int val);
+
+    static uint32_t interleave(uint32_t x, uint32_t y);
+
+private:
+    std::vector<double> x;
+    std::vector<double> y;
+    // Key in the upper 32 bits, staged index in the lower.
+    std::vector<uint64_t> entries;
+    std::vector<uint64_t> scratch;
+    int threadCount;
+};
+
+#endif // MORTON_ORDER_H
@@ -0,0 +1,178 @@
+#include "neighbourlist.h"
+#include <algorithm>
+#include <cmath>
+#include <thread>
+#include "parallelfor.h"
+
+// Upper bound on grid columns and rows, so a few far-flung bodies cannot blow up the cell array.
+static const int maxCellsPerAxis = 1024;
+
+NeighbourList::NeighbourList()
+    : skin(2.0), threadCount(std::max(1u, std::thread::hardware_concurrency())), builtSkin(0.0), valid(false), buildCount(0) {}
+
+bool NeighbourList::update(const QList<SimulationObject*>& objects, double frameTime)
+{
+    int n = objects.size();
+    double maxSpeed2 = 0.0;
+    double maxShift2 = 0.0;
+    for (int i = 0; i < n; ++i)
+    {
+        std::pair<double, double> velocity = objects[i]->getVelocity();
+        maxSpeed2 = std::max(maxSpeed2, velocity.first * velocity.first + velocity.second * velocity.second);
+        if (valid && i < static_cast<int>(builtX.size()))
+        {
+            std::pair<double, double> position = objects[i]->getPosition();
+            double dx = position.first - builtX[i];
+            double dy = position.second - builtY[i];
+            maxShift2 = std::max(maxShift2, dx * dx + dy * dy);
+        }
+    }
+
+    // Two bodies approach each other by at most twice the largest shift plus twice the largest sweep.
+    double reach = std::sqrt(maxSpeed2) * frameTime;
+    if (valid && n == static_cast<int>(builtX.size()) && std::sqrt(maxShift2) + reach < 0.5 * builtSkin)
+        return false;
+
+    build(objects, reach);
+    return true;
+}
+
+// Bodies are binned on a grid with cells as wide as the largest candidate distance, so every candidate of a body
+// lies in its own or one of the eight surrounding cells.
+void NeighbourList::build(const QList<SimulationObject*>& objects, double reach)
+{
+    int n = objects.size();
+    // The skin must at least cover the sweep of this step, or the list would be stale straight away.
+    builtSkin = std::max(skin, 4.0 * reach);
+    builtX.resize(n);
+    builtY.resize(n);
+    start.assign(n + 1, 0);
+    candidates.clear();
+    valid = true;
+    ++buildCount;
+    if (n == 0)
+        return;
+
+    double minX = 0.0, minY = 0.0, maxX = 0.0, maxY = 0.0, maxRadius = 0.0;
+    for (int i = 0; i < n; ++i)
+    {
+        std::pair<double, double> position = objects[i]->getPosition();
+        builtX[i] = position.first;
+        builtY[i] = position.second;
+        minX = i == 0 ? position.first : std::min(minX, position.first);
+        minY = i == 0 ? position.second : std::min(minY, position.second);
+        maxX = i == 0 ? position.first : std::max(maxX, position.first);
+        maxY = i == 0 ? position.second : std::max(maxY, position.second);
+        maxRadius = std::max(maxRadius, objects[i]->getRadius());
+    }
+
+    double cell = 2.0 * maxRadius + builtSkin;
+    int columns = std::min(maxCellsPerAxis, std::max(1, static_cast<int>((maxX - minX) / cell) + 1));
+    int rows = std::min(maxCellsPerAxis, std::max(1, static_cast<int>((maxY - minY) / cell) + 1));
+    double cellX = std::max(cell, (maxX - minX) / columns * (1.0 + 1e-9));
+    double cellY = std::max(cell, (maxY - minY) / rows * (1.0 + 1e-9));
+
+    cellOf.resize(n);
+    cellStart.assign(static_cast<size_t>(columns) * rows + 1, 0);
+    cellBodies.resize(n);
+    for (int i = 0; i < n; ++i)
+    {
+        int column = std::min(columns - 1, static_cast<int>((builtX[i] - minX) / cellX));
+        int row = std::min(rows - 1, static_cast<int>((builtY[i] - minY) / cellY));
+        cellOf[i] = row * columns + column;
+        ++cellStart[cellOf[i] + 1];
+    }
+    for (size_t c = 1; c < cellStart.size(); ++c)
+        cellStart[c] += cellStart[c - 1];
+    std::vector<int> fill(cellStart.begin(), cellStart.end() - 1);
+    // Bodies enter their cells in list order, so each cell's members are ascending.
+    for (int i = 0; i < n; ++i)
+        cellBodies[fill[cellOf[i]]++] = i;
+
+    auto visitCandidates = [&](int i, auto&& visit) {
+        int column = cellOf[i] % columns;
+        int row = cellOf[i] / columns;
+        double radius = objects[i]->getRadius();
+        for (int r = std::max(0, row - 1); r <= std::min(rows - 1, row + 1); ++r)
+        {
+            for (int c = std::max(0, column - 1); c <= std::min(columns - 1, column + 1); ++c)
+            {
+                int cellIndex = r * columns + c;
+                for (int p = cellStart[cellIndex]; p < cellStart[cellIndex + 1]; ++p)
+                {
+                    int j = cellBodies[p];
+                    if (j <= i)
+                        continue;
+                    double dx = builtX[j] - builtX[i];
+                    double dy = builtY[j] - builtY[i];
+                    double limit = radius + objects[j]->getRadius() + builtSkin;
+                    if (dx * dx + dy * dy < limit * limit)
+                        visit(j);
+                }
+            }
+        }
+    };
+
+    // Bodies in crowded cells have many more candidates than the rest, so both passes are balanced by work
+    // stealing: the first counts every body's candidates, the second writes them into their slots.
+    parallelForDynamic(n, threadCount, 256, [&](size_t begin, size_t end) {
+        for (size_t i = begin; i < end; ++i)
+        {
+            int count = 0;
+            visitCandidates(static_cast<int>(i), [&count](int) { ++count; });
+            start[i + 1] = count;
+        }
+    });
+    for (int i = 0; i < n; ++i)
+        start[i + 1] += start[i];
+    candidates.resize(start[n]);
+    parallelForDynamic(n, threadCount, 256, [&](size_t begin, size_t end) {
+        for (size_t i = begin; i < end; ++i)
+        {
+            int* out = candidates.data() + start[i];
+            visitCandidates(static_cast<int>(i), [&out](int j) { *out++ = j; });
+            std::sort(candidates.data() + start[i], out);
+        }
+    });
+}
+
+void NeighbourList::invalidate()
+{
+    valid = false;
+}
+
+const int* NeighbourList::begin(int i)
+{
+    return candidates.data() + start[i];
+}
+
+const int* NeighbourList::end(int i)
+{
+    return candidates.data() + start[i + 1];
+}
+
+int NeighbourList::getPairCount()
+{
+    return static_cast<int>(candidates.size());
+}
+
+quint64 NeighbourList::getBuildCount()
+{
+    return buildCount;
+}
+
+void NeighbourList::setSkin(double val)
+{
+    skin = std::max(0.0, val);
+    valid = false;
+}
+
+double NeighbourList::getSkin()
+{
+    return skin;
+}
+
+void NeighbourList::setThreadCount(int val)
+{
+    threadCount = std::max(1, val);
+}
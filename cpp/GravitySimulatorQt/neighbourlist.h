@@ -0,0 +1,47 @@
+#ifndef NEIGHBOUR_LIST_H
+#define NEIGHBOUR_LIST_H
+
+#include <vector>
+#include <QList>
+#include "simulationobject.h"
+
+// Verlet list of collision candidates. Every pair closer than the sum of radii plus a skin when the list is built
+// is stored, and the list stays complete until bodies have moved far enough to close the skin: half of it per
+// body, counting the sweep of the coming step. Until then collision passes only scan the stored pairs.
+// Candidates are kept per body in ascending order, so passes visit pairs in the same order as a full i < j loop.
+class NeighbourList {
+public:
+    NeighbourList();
+    // Rebuilds the list if it could miss a contact within the next frameTime of travel (0 for overlap checks
+    // at the current positions). Returns whether it rebuilt.
+    bool update(const QList<SimulationObject*>& objects, double frameTime);
+    // Forces a rebuild on the next update(), e.g. after the list indices or radii changed.
+    void invalidate();
+
+    // Candidates j > i of the i-th body.
+    const int* begin(int i);
+    const int* end(int i);
+    int getPairCount();
+    quint64 getBuildCount();
+    void setSkin(double val);
+    double getSkin();
+    void setThreadCount(int val);
+
+private:
+    double skin;
+    int threadCount;
+    double builtSkin;
+    bool valid;
+    quint64 buildCount;
+    std::vector<double> builtX;
+    std::vector<double> builtY;
+    std::vector<int> start;
+    std::vector<int> candidates;
+    std::vector<int> cellStart;
+    std::vector<int> cellBodies;
+    std::vector<int> cellOf;
+
+    void build(const QList<SimulationObject*>& objects, double reach);
+};
+
+#endif // NEIGHBOUR_LIST_H
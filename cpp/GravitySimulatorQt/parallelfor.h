@@ -0,0 +1,32 @@
+#ifndef PARALLEL_FOR_H
+#define PARALLEL_FOR_H
+
+#include <algorithm>
+#include <cstddef>
+#include "jobsystem.h"
+
+// Splits [0, count) into one contiguous range per worker and runs work(worker, begin, end) on each as a job of
+// the engine's JobSystem, the first range on the calling thread. Workers are capped so that each gets at least
+// minPerWorker items. The ranges depend only on count and threadCount, never on which thread runs them.
+template <typename Work>
+void parallelFor(size_t count, int threadCount, size_t minPerWorker, const Work& work)
+{
+    size_t workers = std::min<size_t>(std::max(1, threadCount), std::max<size_t>(1, count / std::max<size_t>(1, minPerWorker)));
+    size_t chunk = (count + workers - 1) / workers;
+    if (workers == 1)
+    {
+        work(0, 0, count);
+        return;
+    }
+    JobSystem::instance().runTasks(workers, [&](size_t w) { work(w, std::min(count, w * chunk), std::min(count, (w + 1) * chunk)); });
+}
+
+// For loops whose items differ widely in cost: the range is split on demand and balanced by work stealing
+// (see JobSystem::parallelFor), so work(begin, end) must not depend on where the pieces end.
+template <typename Work>
+void parallelForDynamic(size_t count, int threadCount, size_t minGrain, const Work& work)
+{
+    JobSystem::instance().parallelFor(count, threadCount, minGrain, work);
+}
+
+#endif // PARALLEL_FOR_H
@@ -0,0 +1,392 @@
+#include "pmsolver.h"
+#include <algorithm>
+#include <cmath>
+#include <thread>
+#include "parallelfor.h"
+
+static const double pi = 3.14159265358979323846;
+// Mean of 1 / r over a unit cell centred on the origin, 4 asinh(1); the unsplit kernel's value at r = 0.
+static const double cellAverage = 3.5254943480781717;
+
+ParticleMeshSolver::ParticleMeshSolver()
+    : gridSize(256), boundary(MeshBoundary::Isolated), boxLeft(0.0), boxTop(0.0), boxWidth(1.0), boxHeight(1.0),
+      shortRange(false), threadCount(std::max(1u, std::thread::hardware_concurrency())), originX(0.0), originY(0.0),
+      cellX(1.0), cellY(1.0), meshWidth(0), meshHeight(0), split(1.0), isolatedGreenSize(0),
+      isolatedGreenSplit(false) {}
+
+void ParticleMeshSolver::resize(size_t n)
+{
+    x.resize(n);
+    y.resize(n);
+    mass.resize(n);
+    ax.resize(n);
+    ay.resize(n);
+}
+
+void ParticleMeshSolver::compute(double gforce, const Softening& softening)
+{
+    std::fill(ax.begin(), ax.end(), 0.0);
+    std::fill(ay.begin(), ay.end(), 0.0);
+    if (x.empty())
+        return;
+
+    fitGrid();
+    deposit();
+    solve(gforce);
+    interpolate();
+    if (shortRange)
+        addShortRange(gforce, softening);
+}
+
+void ParticleMeshSolver::fitGrid()
+{
+    if (boundary == MeshBoundary::Periodic)
+    {
+        originX = boxLeft;
+        originY = boxTop;
+        cellX = boxWidth / gridSize;
+        cellY = boxHeight / gridSize;
+        meshWidth = gridSize;
+        meshHeight = gridSize;
+    }
+    else
+    {
+        auto rangeX = std::minmax_element(x.begin(), x.end());
+        auto rangeY = std::minmax_element(y.begin(), y.end());
+        double extent = std::max(*rangeX.second - *rangeX.first, *rangeY.second - *rangeY.first);
+        if (extent <= 0.0)
+            extent = 1.0;
+        // Two spare cells on each side keep the cloud-in-cell stencil and the four-point differences inside the
+        // unpadded quarter of the mesh.
+        cellX = extent / (gridSize - 5);
+        cellY = cellX;
+        originX = *rangeX.first - 2.0 * cellX;
+        originY = *rangeY.first - 2.0 * cellY;
+        meshWidth = 2 * gridSize;
+        meshHeight = 2 * gridSize;
+    }
+    split = splitScale * std::max(cellX, cellY);
+}
+
+// Bodies are split into a fixed number of lanes, each deposited into its own grid by whichever thread takes it,
+// and the grids are summed cell-wise in lane order. No two threads write the same value, and since the lanes
+// depend only on the body count the density is the same for any thread count.
+void ParticleMeshSolver::deposit()
+{
+    size_t cells = static_cast<size_t>(meshWidth) * meshHeight;
+    size_t n = x.size();
+    size_t lanes = std::min<size_t>(depositLanes, std::max<size_t>(1, n / 65536));
+    size_t laneSize = (n + lanes - 1) / lanes;
+    if (privateDensity.size() < lanes)
+        privateDensity.resize(lanes);
+
+    parallelFor(lanes, threadCount, 1, [&](size_t, size_t firstLane, size_t lastLane) {
+        for (size_t lane = firstLane; lane < lastLane; ++lane)
+        {
+            privateDensity[lane].assign(cells, 0.0);
+            depositRange(privateDensity[lane], lane * laneSize, std::min(n, (lane + 1) * laneSize));
+        }
+    });
+
+    density.resize(cells);
+    parallelFor(cells, threadCount, 65536, [&](size_t, size_t begin, size_t end) {
+        for (size_t c = begin; c < end; ++c)
+        {
+            double sum = 0.0;
+            for (size_t lane = 0; lane < lanes; ++lane)
+                sum += privateDensity[lane][c];
+            density[c] = sum;
+        }
+    });
+}
+
+void ParticleMeshSolver::depositRange(std::vector<double>& grid, size_t begin, size_t end)
+{
+    for (size_t i = begin; i < end; ++i)
+    {
+        double gx = (x[i] - originX) / cellX;
+        double gy = (y[i] - originY) / cellY;
+        int i0 = static_cast<int>(std::floor(gx));
+        int j0 = static_cast<int>(std::floor(gy));
+        double fx = gx - i0;
+        double fy = gy - j0;
+        int i1 = i0 + 1;
+        int j1 = j0 + 1;
+        i0 = ((i0 % meshWidth) + meshWidth) % meshWidth;
+        j0 = ((j0 % meshHeight) + meshHeight) % meshHeight;
+        i1 = ((i1 % meshWidth) + meshWidth) % meshWidth;
+        j1 = ((j1 % meshHeight) + meshHeight) % meshHeight;
+
+        double m = mass[i];
+        grid[static_cast<size_t>(j0) * meshWidth + i0] += m * (1.0 - fx) * (1.0 - fy);
+        grid[static_cast<size_t>(j0) * meshWidth + i1] += m * fx * (1.0 - fy);
+        grid[static_cast<size_t>(j1) * meshWidth + i0] += m * (1.0 - fx) * fy;
+        grid[static_cast<size_t>(j1) * meshWidth + i1] += m * fx * fy;
+    }
+}
+
+void ParticleMeshSolver::buildIsolatedGreen()
+{
+    int size = 2 * gridSize;
+    std::vector<double> kernel(static_cast<size_t>(size) * size);
+    for (int row = 0; row < size; ++row)
+    {
+        int dy = row <= gridSize ? row : row - size;
+        for (int col = 0; col < size; ++col)
+        {
+            int dx = col <= gridSize ? col : col - size;
+            double r = std::sqrt(static_cast<double>(dx * dx + dy * dy));
+            double value;
+            if (shortRange)
+                value = r > 0.0 ? -std::erf(r / (2.0 * splitScale)) / r : -1.0 / (splitScale * std::sqrt(pi));
+            else
+                value = r > 0.0 ? -1.0 / r : -cellAverage;
+            kernel[static_cast<size_t>(row) * size + col] = value;
+        }
+    }
+    fft.setSize(size, size);
+    fft.forward(kernel, isolatedGreen);
+    isolatedGreenSize = gridSize;
+    isolatedGreenSplit = shortRange;
+}
+
+// Potential on the mesh: the transform of the density times the transform of -G / r, or of its long-range part
+// when the short-range correction adds the rest.
+void ParticleMeshSolver::solve(double gforce)
+{
+    fft.setThreadCount(threadCount);
+    if (boundary == MeshBoundary::Isolated && (isolatedGreenSize != gridSize || isolatedGreenSplit != shortRange))
+        buildIsolatedGreen();
+
+    fft.setSize(meshWidth, meshHeight);
+    fft.forward(density, spectrum);
+
+    int bins = fft.getSpectrumWidth();
+    parallelFor(meshHeight, threadCount, 16, [&](size_t, size_t begin, size_t end) {
+        for (size_t row = begin; row < end; ++row)
+        {
+            for (int col = 0; col < bins; ++col)
+            {
+                size_t index = row * bins + col;
+                if (boundary == MeshBoundary::Isolated)
+                {
+                    spectrum[index] *= gforce / cellX * isolatedGreen[index];
+                    continue;
+                }
+
+                // Transform of the planar kernel 1 / r is 2 pi / k; of its long-range part erf(r / 2s) / r,
+                // 2 pi erfc(k s) / k.
+                int wave = static_cast<int>(row) <= meshHeight / 2 ? static_cast<int>(row) : static_cast<int>(row) - meshHeight;
+                double kx = 2.0 * pi * col / boxWidth;
+                double ky = 2.0 * pi * wave / boxHeight;
+                double k = std::sqrt(kx * kx + ky * ky);
+                double longRange = shortRange ? std::erfc(k * split) : 1.0;
+                double green = k > 0.0 ? -2.0 * pi * longRange / k / (cellX * cellY) : 0.0;
+                spectrum[index] *= gforce * green;
+            }
+        }
+    });
+
+    fft.inverse(spectrum, potential);
+}
+
+void ParticleMeshSolver::interpolate()
+{
+    auto phi = [this](int i, int j) {
+        i = ((i % meshWidth) + meshWidth) % meshWidth;
+        j = ((j % meshHeight) + meshHeight) % meshHeight;
+        return potential[static_cast<size_t>(j) * meshWidth + i];
+    };
+
+    parallelFor(x.size(), threadCount, 4096, [&](size_t, size_t begin, size_t end) {
+        for (size_t b = begin; b < end; ++b)
+        {
+            double gx = (x[b] - originX) / cellX;
+            double gy = (y[b] - originY) / cellY;
+            int i0 = static_cast<int>(std::floor(gx));
+            int j0 = static_cast<int>(std::floor(gy));
+            double fx = gx - i0;
+            double fy = gy - j0;
+
+            double sumX = 0.0;
+            double sumY = 0.0;
+            for (int dj = 0; dj < 2; ++dj)
+            {
+                for (int di = 0; di < 2; ++di)
+                {
+                    int i = i0 + di;
+                    int j = j0 + dj;
+                    double weight = (di ? fx : 1.0 - fx) * (dj ? fy : 1.0 - fy);
+                    double gradX = (8.0 * (phi(i + 1, j) - phi(i - 1, j)) - (phi(i + 2, j) - phi(i - 2, j))) / (12.0 * cellX);
+                    double gradY = (8.0 * (phi(i, j + 1) - phi(i, j - 1)) - (phi(i, j + 2) - phi(i, j - 2))) / (12.0 * cellY);
+                    sumX -= weight * gradX;
+                    sumY -= weight * gradY;
+                }
+            }
+            ax[b] = sumX;
+            ay[b] = sumY;
+        }
+    });
+}
+
+// P3M correction: the part of the force the mesh leaves out, summed over pairs within the cutoff found through
+// a chaining mesh of cutoff-sized cells. Every body sums its own neighbours, so there are no shared writes, and
+// since a body costs as much as its neighbourhood is crowded the bodies are balanced by work stealing.
+void ParticleMeshSolver::addShortRange(double gforce, const Softening& softening)
+{
+    double cutoff = cutoffScale * split;
+    bool periodic = boundary == MeshBoundary::Periodic;
+    double left = periodic ? boxLeft : originX;
+    double top = periodic ? boxTop : originY;
+    double width = periodic ? boxWidth : meshWidth / 2 * cellX;
+    double height = periodic ? boxHeight : meshHeight / 2 * cellY;
+    int columns = std::max(1, static_cast<int>(width / cutoff));
+    int rows = std::max(1, static_cast<int>(height / cutoff));
+    double chainX = width / columns;
+    double chainY = height / rows;
+    size_t n = x.size();
+
+    auto cellOf = [&](size_t b, int& column, int& row) {
+        column = static_cast<int>(std::floor((x[b] - left) / chainX));
+        row = static_cast<int>(std::floor((y[b] - top) / chainY));
+        if (periodic)
+        {
+            column = ((column % columns) + columns) % columns;
+            row = ((row % rows) + rows) % rows;
+        }
+        else
+        {
+            column = std::min(std::max(column, 0), columns - 1);
+            row = std::min(std::max(row, 0), rows - 1);
+        }
+    };
+
+    cellStart.assign(static_cast<size_t>(columns) * rows + 1, 0);
+    cellBodies.resize(n);
+    for (size_t b = 0; b < n; ++b)
+    {
+        int column, row;
+        cellOf(b, column, row);
+        ++cellStart[static_cast<size_t>(row) * columns + column + 1];
+    }
+    for (size_t c = 1; c < cellStart.size(); ++c)
+        cellStart[c] += cellStart[c - 1];
+    std::vector<int> fill(cellStart.begin(), cellStart.end() - 1);
+    for (size_t b = 0; b < n; ++b)
+    {
+        int column, row;
+        cellOf(b, column, row);
+        cellBodies[fill[static_cast<size_t>(row) * columns + column]++] = static_cast<int>(b);
+    }
+
+    double cutoff2 = cutoff * cutoff;
+    double twoSplit = 2.0 * split;
+    double shapeScale = 1.0 / (split * std::sqrt(pi));
+    parallelForDynamic(n, threadCount, 256, [&](size_t begin, size_t end) {
+        int neighbours[9];
+        for (size_t b = begin; b < end; ++b)
+        {
+            int column, row;
+            cellOf(b, column, row);
+            int count = 0;
+            for (int dr = -1; dr <= 1; ++dr)
+            {
+                for (int dc = -1; dc <= 1; ++dc)
+                {
+                    int c = column + dc;
+                    int r = row + dr;
+                    if (periodic)
+                    {
+                        c = ((c % columns) + columns) % columns;
+                        r = ((r % rows) + rows) % rows;
+                    }
+                    else if (c < 0 || c >= columns || r < 0 || r >= rows)
+                    {
+                        continue;
+                    }
+                    int cell = r * columns + c;
+                    // Small periodic meshes reach the same cell through several offsets.
+                    if (std::find(neighbours, neighbours + count, cell) == neighbours + count)
+                        neighbours[count++] = cell;
+                }
+            }
+
+            double sumX = 0.0;
+            double sumY = 0.0;
+            for (int k = 0; k < count; ++k)
+            {
+                for (int p = cellStart[neighbours[k]]; p < cellStart[neighbours[k] + 1]; ++p)
+                {
+                    size_t other = static_cast<size_t>(cellBodies[p]);
+                    if (other == b)
+                        continue;
+
+                    double dx = x[other] - x[b];
+                    double dy = y[other] - y[b];
+                    if (periodic)
+                    {
+                        dx -= boxWidth * std::round(dx / boxWidth);
+                        dy -= boxHeight * std::round(dy / boxHeight);
+                    }
+                    double dist2 = dx * dx + dy * dy;
+                    if (dist2 >= cutoff2)
+                        continue;
+
+                    double dist = std::sqrt(dist2);
+                    double shape = std::erfc(dist / twoSplit) + dist * shapeScale * std::exp(-dist2 / (twoSplit * twoSplit));
+                    double scale = gforce * mass[other] * shape * softenedInverseCube(dist2, softening.kernel, softening.length);
+                    sumX += dx * scale;
+                    sumY += dy * scale;
+                }
+            }
+            ax[b] += sumX;
+            ay[b] += sumY;
+        }
+    });
+}
+
+void ParticleMeshSolver::setGridSize(int val)
+{
+    int size = 8;
+    while (size < val)
+        size <<= 1;
+    gridSize = size;
+}
+
+int ParticleMeshSolver::getGridSize()
+{
+    return gridSize;
+}
+
+void ParticleMeshSolver::setBoundary(MeshBoundary val)
+{
+    boundary = val;
+}
+
+MeshBoundary ParticleMeshSolver::getBoundary()
+{
+    return boundary;
+}
+
+void ParticleMeshSolver::setPeriodicBox(double left, double top, double width, double height)
+{
+    boxLeft = left;
+    boxTop = top;
+    boxWidth = width;
+    boxHeight = height;
+}
+
+void ParticleMeshSolver::setShortRange(bool val)
+{
+    shortRange = val;
+}
+
+bool ParticleMeshSolver::getShortRange()
+{
+    return shortRange;
+}
+
+void ParticleMeshSolver::setThreadCount(int val)
+{
+    threadCount = std::max(1, val);
+}
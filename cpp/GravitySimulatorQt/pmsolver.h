@@ -0,0 +1,89 @@
+#ifndef PM_SOLVER_H
+#define PM_SOLVER_H
+
+#include <complex>
+#include <vector>
+#include "fft.h"
+#include "softening.h"
+
+enum class ForceSolver { Direct, ParticleMesh, Tree };
+enum class MeshBoundary { Periodic, Isolated };
+
+// Particle-mesh gravity. Masses are deposited cloud-in-cell on a square grid, convolved with the Green's function
+// of the engine's force law (G m / r^2 in the plane, i.e. a 1 / r potential whose 2-D transform is 2 pi / k) by a
+// real-to-complex FFT, differentiated with four-point differences and interpolated back cloud-in-cell.
+// Without short range the mesh carries the whole force, resolved down to a few cells. With it (P3M) the mesh
+// carries only the long-range part of a Gaussian split at scale splitScale cells and the rest is summed directly
+// over pairs closer than cutoffScale split lengths.
+// Periodic boundaries wrap the given box; isolated ones zero-pad a grid fitted to the bodies to twice its size.
+class ParticleMeshSolver {
+public:
+    static constexpr double splitScale = 1.25;
+    static constexpr double cutoffScale = 4.5;
+    // Bodies are deposited in at most this many independently summed lanes.
+    static const int depositLanes = 8;
+
+    ParticleMeshSolver();
+
+    // Bodies are staged here by the caller before compute(); accelerations come back in ax, ay.
+    std::vector<double> x;
+    std::vector<double> y;
+    std::vector<double> mass;
+    std::vector<double> ax;
+    std::vector<double> ay;
+
+    void resize(size_t n);
+    void compute(double gforce, const Softening& softening);
+
+    void setGridSize(int val);
+    int getGridSize();
+    void setBoundary(MeshBoundary val);
+    MeshBoundary getBoundary();
+    void setPeriodicBox(double left, double top, double width, double height);
+    void setShortRange(bool val);
+    bool getShortRange();
+    void setThreadCount(int val);
+
+private:
+    int gridSize;
+    MeshBoundary boundary;
+    double boxLeft;
+    double boxTop;
+    double boxWidth;
+    double boxHeight;
+    bool shortRange;
+    int threadCount;
+
+    // Geometry of the current solve: origin and cell size of the particle grid, mesh dimensions (doubled when
+    // isolated) and the split length in world units.
+    double originX;
+    double originY;
+    double cellX;
+    double cellY;
+    int meshWidth;
+    int meshHeight;
+    double split;
+
+    RealFft2D fft;
+    std::vector<std::vector<double>> privateDensity;
+    std::vector<double> density;
+    std::vector<double> potential;
+    std::vector<std::complex<double>> spectrum;
+    // Transform of the isolated Green's function for unit cell size; it scales as 1 / cell. Built for the grid
+    // size and for whether the kernel is split.
+    std::vector<std::complex<double>> isolatedGreen;
+    int isolatedGreenSize;
+    bool isolatedGreenSplit;
+    std::vector<int> cellStart;
+    std::vector<int> cellBodies;
+
+    void fitGrid();
+    void deposit();
+    void depositRange(std::vector<double>& grid, size_t begin, size_t end);
+    void solve(double gforce);
+    void interpolate();
+    void addShortRange(double gforce, const Softening& softening);
+    void buildIsolatedGreen();
+};
+
+#endif // PM_SOLVER_H
@@ -0,0 +1,170 @@
+#include "profiler.h"
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <fstream>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace {
+
+struct TraceEvent {
+    uint64_t start;
+    uint64_t duration;
+    ProfilePhase phase;
+};
+
+// Written only by its owning thread; readers use relaxed atomics, so recording never takes a lock.
+struct ThreadState {
+    uint32_t threadId;
+    std::array<std::array<std::atomic<uint32_t>, Profiler::samplesPerPhase>, Profiler::phaseCount> samples;
+    std::array<std::atomic<uint64_t>, Profiler::phaseCount> counts;
+    std::vector<TraceEvent> trace;
+    std::atomic<uint64_t> traceCount;
+    std::atomic<bool> writingTrace;
+};
+
+std::mutex registryMutex;
+std::vector<std::unique_ptr<ThreadState>> threads;
+std::atomic<bool> tracing(false);
+const uint64_t epoch = Profiler::now();
+
+ThreadState* registerThread()
+{
+    std::unique_ptr<ThreadState> state(new ThreadState());
+    for (auto& phaseSamples : state->samples)
+        for (std::atomic<uint32_t>& sample : phaseSamples)
+            sample.store(0, std::memory_order_relaxed);
+    for (std::atomic<uint64_t>& count : state->counts)
+        count.store(0, std::memory_order_relaxed);
+    state->traceCount.store(0, std::memory_order_relaxed);
+    state->writingTrace.store(false, std::memory_order_relaxed);
+
+    std::lock_guard<std::mutex> lock(registryMutex);
+    state->threadId = static_cast<uint32_t>(threads.size());
+    threads.push_back(std::move(state));
+    return threads.back().get();
+}
+
+ThreadState& localState()
+{
+    thread_local ThreadState* state = registerThread();
+    return *state;
+}
+
+}
+
+uint64_t Profiler::now()
+{
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+void Profiler::record(ProfilePhase phase, uint64_t start, uint64_t duration)
+{
+    ThreadState& state = localState();
+    int p = static_cast<int>(phase);
+    uint64_t index = state.counts[p].load(std::memory_order_relaxed);
+    state.samples[p][index % samplesPerPhase].store(static_cast<uint32_t>(std::min<uint64_t>(duration, UINT32_MAX)),
+                                                    std::memory_order_relaxed);
+    state.counts[p].store(index + 1, std::memory_order_release);
+
+    // The flag is raised before tracing is checked again, so exportTrace() either sees this thread writing and
+    // waits for it or this thread sees tracing paused and drops the event.
+    if (tracing.load(std::memory_order_relaxed))
+    {
+        state.writingTrace.store(true);
+        if (tracing.load())
+        {
+            if (state.trace.empty())
+                state.trace.resize(traceCapacity);
+            uint64_t event = state.traceCount.load(std::memory_order_relaxed);
+            state.trace[event % traceCapacity] = {start, duration, phase};
+            state.traceCount.store(event + 1, std::memory_order_release);
+        }
+        state.writingTrace.store(false, std::memory_order_release);
+    }
+}
+
+ProfileStats Profiler::getStats(ProfilePhase phase)
+{
+    int p = static_cast<int>(phase);
+    std::vector<uint32_t> values;
+    uint64_t total = 0;
+    {
+        std::lock_guard<std::mutex> lock(registryMutex);
+        for (const std::unique_ptr<ThreadState>& state : threads)
+        {
+            uint64_t count = state->counts[p].load(std::memory_order_acquire);
+            total += count;
+            uint64_t available = std::min<uint64_t>(count, samplesPerPhase);
+            for (uint64_t i = 0; i < available; ++i)
+                values.push_back(state->samples[p][i].load(std::memory_order_relaxed));
+        }
+    }
+
+    if (values.empty())
+        return {0.0, 0.0, 0};
+
+    size_t median = values.size() / 2;
+    size_t tail = std::min(values.size() - 1, values.size() * 99 / 100);
+    std::nth_element(values.begin(), values.begin() + median, values.end());
+    double p50 = values[median] / 1000.0;
+    std::nth_element(values.begin(), values.begin() + tail, values.end());
+    double p99 = values[tail] / 1000.0;
+    return {p50, p99, total};
+}
+
+const char* Profiler::getPhaseName(ProfilePhase phase)
+{
+    static const char* names[phaseCount] = {"klatka", "krok", "grawitacja", "kolizje", "całkowanie",
+                                            "ucieczki", "telemetria", "rysowanie", "kafelki", "sortowanie", "cząstki",
+                                            "drzewo"};
+    return names[static_cast<int>(phase)];
+}
+
+void Profiler::setTracing(bool val)
+{
+    tracing.store(val);
+}
+
+bool Profiler::getTracing()
+{
+    return tracing.load(std::memory_order_relaxed);
+}
+
+bool Profiler::exportTrace(const std::string& path)
+{
+    std::ofstream out(path);
+    if (!out)
+        return false;
+
+    // Tracing is paused while the buffers are read, so no thread overwrites an event being written out; events
+    // recorded meanwhile are dropped.
+    bool wasTracing = tracing.exchange(false);
+    out << "{\"traceEvents\":[";
+    bool first = true;
+    std::unique_lock<std::mutex> lock(registryMutex);
+    for (const std::unique_ptr<ThreadState>& state : threads)
+    {
+        while (state->writingTrace.load())
+            std::this_thread::yield();
+        uint64_t count = state->traceCount.load(std::memory_order_acquire);
+        uint64_t begin = count > static_cast<uint64_t>(traceCapacity) ? count - traceCapacity : 0;
+        for (uint64_t i = begin; i < count; ++i)
+        {
+            const TraceEvent& event = state->trace[i % traceCapacity];
+            out << (first ? "\n" : ",\n") << "{\"name\":\"" << getPhaseName(event.phase)
+                << "\",\"ph\":\"X\",\"pid\":1,\"tid\":" << state->threadId
+                << ",\"ts\":" << (event.start - epoch) / 1000.0 << ",\"dur\":" << event.duration / 1000.0 << "}";
+            first = false;
+        }
+    }
+    lock.unlock();
+    if (wasTracing)
+        tracing.store(true);
+    out << "\n],\"displayTimeUnit\":\"ms\"}\n";
+    return static_cast<bool>(out);
+}
@@ -0,0 +1,52 @@
+#ifndef PROFILER_H
+#define PROFILER_H
+
+#include <cstdint>
+#include <string>
+
+// Per-phase timers. Build with "qmake CONFIG+=profiling" to enable them; otherwise PROFILE_SCOPE expands to nothing.
+
+enum class ProfilePhase { Frame, Step, Gravity, Collisions, Integration, Escape, Telemetry, Paint, Tiles, Reorder, Tracers, Tree, Count };
+
+struct ProfileStats {
+    double p50;
+    double p99;
+    uint64_t count;
+};
+
+class Profiler {
+public:
+    static const int phaseCount = static_cast<int>(ProfilePhase::Count);
+    static const int samplesPerPhase = 1024;
+    static const int traceCapacity = 1 << 16;
+
+    static uint64_t now();
+    static void record(ProfilePhase phase, uint64_t start, uint64_t duration);
+    // Percentiles in microseconds over the last samplesPerPhase samples of every thread.
+    static ProfileStats getStats(ProfilePhase phase);
+    static const char* getPhaseName(ProfilePhase phase);
+    static void setTracing(bool val);
+    static bool getTracing();
+    // Writes the recorded events in Chrome trace-event format (chrome://tracing, Perfetto).
+    static bool exportTrace(const std::string& path);
+};
+
+class ScopedTimer {
+public:
+    explicit ScopedTimer(ProfilePhase phase) : phase(phase), start(Profiler::now()) {}
+    ~ScopedTimer() { Profiler::record(phase, start, Profiler::now() - start); }
+
+private:
+    ProfilePhase phase;
+    uint64_t start;
+};
+
+#ifdef GRAVSIM_PROFILING
+#define PROFILE_CONCAT_(a, b) a##b
+#define PROFILE_CONCAT(a, b) PROFILE_CONCAT_(a, b)
+#define PROFILE_SCOPE(phase) ScopedTimer PROFILE_CONCAT(scopedTimer, __LINE__)(phase)
+#else
+#define PROFILE_SCOPE(phase) ((void)0)
+#endif
+
+#endif // PROFILER_H
@@ -0,0 +1,81 @@
+#ifndef REDUCTION_H
+#define REDUCTION_H
+
+#include <algorithm>
+#include <cstddef>
+#include <vector>
+#include "parallelfor.h"
+
+// Deterministic summation. Terms are added serially in blocks of reductionBlock, and the block sums are combined
+// by a balanced binary tree. The shape depends only on the number of terms, never on how many threads computed
+// the blocks, so a sum is bitwise identical on any machine; the tree also keeps the rounding error at
+// O(log n) instead of O(n). T needs a zero value T{} and operator+.
+static const size_t reductionBlock = 256;
+
+template <typename T>
+T combineTree(const T* partials, size_t count)
+{
+    if (count == 0)
+        return T{};
+    if (count == 1)
+        return partials[0];
+    size_t half = count / 2;
+    return combineTree(partials, half) + combineTree(partials + half, count - half);
+}
+
+// Four interleaved running sums, so consecutive additions do not wait on each other.
+template <typename T, typename Term>
+T blockSum(size_t begin, size_t end, const Term& term)
+{
+    T sum0{}, sum1{}, sum2{}, sum3{};
+    size_t i = begin;
+    for (; i + 4 <= end; i += 4)
+    {
+        sum0 = sum0 + term(i);
+        sum1 = sum1 + term(i + 1);
+        sum2 = sum2 + term(i + 2);
+        sum3 = sum3 + term(i + 3);
+    }
+    for (; i < end; ++i)
+        sum0 = sum0 + term(i);
+    return (sum0 + sum1) + (sum2 + sum3);
+}
+
+// Sum of term(i) for i in [0, count) on the calling thread; scratch holds the block sums between calls.
+template <typename T, typename Term>
+T pairwiseSum(size_t count, const Term& term, std::vector<T>& scratch)
+{
+    if (count <= reductionBlock)
+        return blockSum<T>(0, count, term);
+
+    size_t blocks = (count + reductionBlock - 1) / reductionBlock;
+    scratch.resize(blocks);
+    for (size_t b = 0; b < blocks; ++b)
+        scratch[b] = blockSum<T>(b * reductionBlock, std::min(count, (b + 1) * reductionBlock), term);
+    return combineTree(scratch.data(), blocks);
+}
+
+template <typename T, typename Term>
+T pairwiseSum(size_t count, const Term& term)
+{
+    std::vector<T> scratch;
+    return pairwiseSum<T>(count, term, scratch);
+}
+
+// Same result as pairwiseSum, with the blocks shared out between threads.
+template <typename T, typename Term>
+T parallelPairwiseSum(size_t count, int threadCount, const Term& term)
+{
+    if (count <= reductionBlock)
+        return blockSum<T>(0, count, term);
+
+    size_t blocks = (count + reductionBlock - 1) / reductionBlock;
+    std::vector<T> partials(blocks);
+    parallelFor(blocks, threadCount, 16, [&](size_t, size_t begin, size_t end) {
+        for (size_t b = begin; b < end; ++b)
+            partials[b] = blockSum<T>(b * reductionBlock, std::min(count, (b + 1) * reductionBlock), term);
+    });
+    return combineTree(partials.data(), blocks);
+}
+
+#endif // REDUCTION_H
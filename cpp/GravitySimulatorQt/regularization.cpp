@@ -0,0 +1,285 @@
+#include "regularization.h"
+#include <algorithm>
+#include <cmath>
+#include <limits>
+
+static const double pi = 3.14159265358979323846;
+// Upper bound on grid columns and rows, so a few far-flung bodies cannot blow up the cell array.
+static const int maxCellsPerAxis = 1024;
+
+TwoBodyRegularizer::TwoBodyRegularizer() {}
+
+// Only pairs with an orbit shorter than minStepsPerOrbit steps qualify, and no pair's gravitational parameter
+// exceeds that of the two heaviest bodies, which bounds the semi-major axis of any candidate. A qualifying pair is
+// closer than its apocentre, at most twice that axis, and the isolation test looks isolation apocentres further,
+// so neighbours are only searched within searchRadius, through a grid of cells that wide. Bodies with no other
+// one in reach keep an infinite nearest distance and pair with nobody, as they would in a full search.
+bool TwoBodyRegularizer::findPairs(QList<SimulationObject*>& objects, double gforce, double timeStep,
+                                   const Softening& softening)
+{
+    int n = objects.size();
+    nearest.assign(n, -1);
+    nearestDist2.assign(n, std::numeric_limits<double>::infinity());
+    secondDist2.assign(n, std::numeric_limits<double>::infinity());
+
+    double heaviest = 0.0, second = 0.0;
+    double minX = 0.0, minY = 0.0, maxX = 0.0, maxY = 0.0;
+    positionX.resize(n);
+    positionY.resize(n);
+    for (int i = 0; i < n; ++i)
+    {
+        std::pair<double, double> position = objects[i]->getPosition();
+        positionX[i] = position.first;
+        positionY[i] = position.second;
+        minX = i == 0 ? position.first : std::min(minX, position.first);
+        minY = i == 0 ? position.second : std::min(minY, position.second);
+        maxX = i == 0 ? position.first : std::max(maxX, position.first);
+        maxY = i == 0 ? position.second : std::max(maxY, position.second);
+        double mass = objects[i]->getMass();
+        if (mass > heaviest)
+        {
+            second = heaviest;
+            heaviest = mass;
+        }
+        else if (mass > second)
+        {
+            second = mass;
+        }
+    }
+
+    double muMax = gforce * (heaviest + second);
+    if (n >= 2 && muMax > 0.0)
+    {
+        double orbit = minStepsPerOrbit * timeStep / (2.0 * pi);
+        double searchRadius = 2.0 * isolation * std::cbrt(muMax * orbit * orbit);
+        int columns = std::min(maxCellsPerAxis, std::max(1, static_cast<int>((maxX - minX) / searchRadius) + 1));
+        int rows = std::min(maxCellsPerAxis, std::max(1, static_cast<int>((maxY - minY) / searchRadius) + 1));
+        double cellX = std::max(searchRadius, (maxX - minX) / columns * (1.0 + 1e-9));
+        double cellY = std::max(searchRadius, (maxY - minY) / rows * (1.0 + 1e-9));
+
+        cellOf.resize(n);
+        cellStart.assign(static_cast<size_t>(columns) * rows + 1, 0);
+        cellBodies.resize(n);
+        for (int i = 0; i < n; ++i)
+        {
+            int column = std::min(columns - 1, static_cast<int>((positionX[i] - minX) / cellX));
+            int row = std::min(rows - 1, static_cast<int>((positionY[i] - minY) / cellY));
+            cellOf[i] = row * columns + column;
+            ++cellStart[cellOf[i] + 1];
+        }
+        for (size_t c = 1; c < cellStart.size(); ++c)
+            cellStart[c] += cellStart[c - 1];
+        std::vector<int> fill(cellStart.begin(), cellStart.end() - 1);
+        for (int i = 0; i < n; ++i)
+            cellBodies[fill[cellOf[i]]++] = i;
+
+        double reach2 = searchRadius * searchRadius;
+        for (int i = 0; i < n; ++i)
+        {
+            int column = cellOf[i] % columns;
+            int row = cellOf[i] / columns;
+            for (int r = std::max(0, row - 1); r <= std::min(rows - 1, row + 1); ++r)
+            {
+                for (int c = std::max(0, column - 1); c <= std::min(columns - 1, column + 1); ++c)
+                {
+                    int cellIndex = r * columns + c;
+                    for (int p = cellStart[cellIndex]; p < cellStart[cellIndex + 1]; ++p)
+                    {
+                        int j = cellBodies[p];
+                        if (j == i)
+                            continue;
+                        double distX = positionX[j] - positionX[i];
+                        double distY = positionY[j] - positionY[i];
+                        double dist2 = distX * distX + distY * distY;
+                        if (dist2 >= reach2)
+                            continue;
+                        if (dist2 < nearestDist2[i])
+                        {
+                            secondDist2[i] = nearestDist2[i];
+                            nearestDist2[i] = dist2;
+                            nearest[i] = j;
+                        }
+                        else if (dist2 < secondDist2[i])
+                        {
+                            secondDist2[i] = dist2;
+                        }
+                    }
+                }
+            }
+        }
+    }
+
+    std::vector<BoundPair> found;
+    partners.assign(n, -1);
+    for (int i = 0; i < n; ++i)
+    {
+        int j = nearest[i];
+        if (j <= i || nearest[j] != i)
+            continue;
+
+        SimulationObject* o1 = objects[i];
+        SimulationObject* o2 = objects[j];
+        double mu = gforce * (o1->getMass() + o2->getMass());
+        double x = o2->getPosition().first - o1->getPosition().first;
+        double y = o2->getPosition().second - o1->getPosition().second;
+        double vx = o2->getVelocity().first - o1->getVelocity().first;
+        double vy = o2->getVelocity().second - o1->getVelocity().second;
+        double r = std::sqrt(x * x + y * y);
+        double energy = 0.5 * (vx * vx + vy * vy) - mu / r;
+        if (mu <= 0.0 || energy >= 0.0)
+            continue;
+
+        double a = -mu / (2.0 * energy);
+        double period = 2.0 * pi * std::sqrt(a * a * a / mu);
+        double h = x * vy - y * vx;
+        double e = std::sqrt(std::max(0.0, 1.0 + 2.0 * energy * h * h / (mu * mu)));
+        double pericentre = a * (1.0 - e);
+        double apocentre = a * (1.0 + e);
+        // Pairs that resolve fine, would touch or feel softening, or are perturbed by a third body stay in the
+        // ordinary integration.
+        if (period >= minStepsPerOrbit * timeStep || pericentre <= o1->getRadius() + o2->getRadius() ||
+            (softening.kernel != SofteningKernel::None && pericentre <= softening.length) ||
+            std::min(secondDist2[i], secondDist2[j]) < isolation * isolation * apocentre * apocentre)
+            continue;
+
+        found.push_back({o1, o2});
+        partners[i] = j;
+        partners[j] = i;
+    }
+
+    bool changed = found.size() != pairs.size();
+    for (size_t p = 0; !changed && p < found.size(); ++p)
+        changed = found[p].first != pairs[p].first || found[p].second != pairs[p].second;
+    pairs.swap(found);
+    return changed;
+}
+
+void TwoBodyRegularizer::clear()
+{
+    pairs.clear();
+    partners.clear();
+}
+
+void TwoBodyRegularizer::removeMutualForces(double gforce, const Softening& softening)
+{
+    for (const BoundPair& p : pairs)
+    {
+        if (!p.first->getIsDestroyed() && !p.second->getIsDestroyed())
+            p.first->applyGravity(*p.second, -gforce, softening);
+    }
+}
+
+// The straight-line drift already moved the centre of mass exactly; only the relative motion is redone.
+void TwoBodyRegularizer::drift(double frameTime, double gforce)
+{
+    for (const BoundPair& p : pairs)
+    {
+        SimulationObject* o1 = p.first;
+        SimulationObject* o2 = p.second;
+        if (o1->getIsDestroyed() || o2->getIsDestroyed())
+            continue;
+
+        double m1 = o1->getMass();
+        double m2 = o2->getMass();
+        double total = m1 + m2;
+        std::pair<double, double> p1 = o1->getPosition();
+        std::pair<double, double> p2 = o2->getPosition();
+        std::pair<double, double> v1 = o1->getVelocity();
+        std::pair<double, double> v2 = o2->getVelocity();
+
+        double vx = v2.first - v1.first;
+        double vy = v2.second - v1.second;
+        double x = p2.first - p1.first - vx * frameTime;
+        double y = p2.second - p1.second - vy * frameTime;
+        if (!propagate(gforce * total, x, y, vx, vy, frameTime))
+            continue;
+
+        double cx = (m1 * p1.first + m2 * p2.first) / total;
+        double cy = (m1 * p1.second + m2 * p2.second) / total;
+        double cvx = (m1 * v1.first + m2 * v2.first) / total;
+        double cvy = (m1 * v1.second + m2 * v2.second) / total;
+        o1->setPosition(cx - m2 / total * x, cy - m2 / total * y);
+        o2->setPosition(cx + m1 / total * x, cy + m1 / total * y);
+        o1->setVelocity(cvx - m2 / total * vx, cvy - m2 / total * vy);
+        o2->setVelocity(cvx + m1 / total * vx, cvy + m1 / total * vy);
+    }
+}
+
+int TwoBodyRegularizer::getPartner(int i)
+{
+    return i < static_cast<int>(partners.size()) ? partners[i] : -1;
+}
+
+int TwoBodyRegularizer::getPairCount()
+{
+    return static_cast<int>(pairs.size());
+}
+
+bool TwoBodyRegularizer::propagate(double mu, double& x, double& y, double& vx, double& vy, double dt)
+{
+    double r0 = std::sqrt(x * x + y * y);
+    if (mu <= 0.0 || r0 == 0.0)
+        return false;
+
+    double sqrtMu = std::sqrt(mu);
+    double radialVelocity = (x * vx + y * vy) / r0;
+    double alpha = 2.0 / r0 - (vx * vx + vy * vy) / mu;
+    // Bound orbits repeat, so whole periods can be skipped.
+    if (alpha > 0.0)
+        dt = std::fmod(dt, 2.0 * pi / (sqrtMu * alpha * std::sqrt(alpha)));
+
+    // Stumpff functions C(z) and S(z).
+    auto stumpff = [](double z, double& c, double& s) {
+        if (z > 1e-8)
+        {
+            double q = std::sqrt(z);
+            c = (1.0 - std::cos(q)) / z;
+            s = (q - std::sin(q)) / (z * q);
+        }
+        else if (z < -1e-8)
+        {
+            double q = std::sqrt(-z);
+            c = (std::cosh(q) - 1.0) / -z;
+            s = (std::sinh(q) - q) / (-z * q);
+        }
+        else
+        {
+            c = 0.5 - z / 24.0;
+            s = 1.0 / 6.0 - z / 120.0;
+        }
+    };
+
+    double chi = alpha > 0.0 ? sqrtMu * alpha * dt : sqrtMu * dt / r0;
+    double c = 0.5, s = 1.0 / 6.0;
+    bool converged = false;
+    for (int iteration = 0; iteration < 100 && !converged; ++iteration)
+    {
+        double chi2 = chi * chi;
+        stumpff(alpha * chi2, c, s);
+        double f = r0 * radialVelocity / sqrtMu * chi2 * c + (1.0 - alpha * r0) * chi2 * chi * s + r0 * chi - sqrtMu * dt;
+        double df = r0 * radialVelocity / sqrtMu * chi * (1.0 - alpha * chi2 * s) + (1.0 - alpha * r0) * chi2 * c + r0;
+        double delta = f / df;
+        chi -= delta;
+        converged = std::abs(delta) <= 1e-12 * std::max(1.0, std::abs(chi));
+    }
+    if (!converged || !std::isfinite(chi))
+        return false;
+
+    double chi2 = chi * chi;
+    stumpff(alpha * chi2, c, s);
+    double f = 1.0 - chi2 / r0 * c;
+    double g = dt - chi2 * chi / sqrtMu * s;
+    double newX = f * x + g * vx;
+    double newY = f * y + g * vy;
+    double r = std::sqrt(newX * newX + newY * newY);
+    double df = sqrtMu / (r * r0) * (alpha * chi2 * chi * s - chi);
+    double dg = 1.0 - chi2 / r * c;
+    double newVx = df * x + dg * vx;
+    double newVy = df * y + dg * vy;
+
+    x = newX;
+    y = newY;
+    vx = newVx;
+    vy = newVy;
+    return true;
+}
@@ -0,0 +1,52 @@
+#ifndef REGULARIZATION_H
+#define REGULARIZATION_H
+
+#include <vector>
+#include <QList>
+#include "simulationobject.h"
+#include "softening.h"
+
+// Tightly bound, isolated pairs whose orbit the global step cannot resolve. Their mutual attraction is taken out
+// of the force sums and, after the ordinary straight-line drift, their relative motion is replaced by the exact
+// Kepler orbit over the same time, so the rest of the system keeps the large step.
+class TwoBodyRegularizer {
+public:
+    // Orbits shorter than this many steps are regularized.
+    static const int minStepsPerOrbit = 100;
+    // No other body may come closer to a member than this many apocentre distances.
+    static constexpr double isolation = 3.0;
+
+    TwoBodyRegularizer();
+    // Pairs up mutual nearest neighbours that qualify, searching a grid rather than all pairs; returns whether the
+    // pairing changed.
+    bool findPairs(QList<SimulationObject*>& objects, double gforce, double timeStep, const Softening& softening);
+    void clear();
+    void removeMutualForces(double gforce, const Softening& softening);
+    void drift(double frameTime, double gforce);
+    // List index of the partner of the i-th body as of the last findPairs(), or -1.
+    int getPartner(int i);
+    int getPairCount();
+
+    // Advances separation (x, y) and relative velocity (vx, vy) of a two-body orbit with gravitational parameter mu
+    // by dt (universal variables). Returns false if the solver did not converge; the state is then unchanged.
+    static bool propagate(double mu, double& x, double& y, double& vx, double& vy, double dt);
+
+private:
+    struct BoundPair {
+        SimulationObject* first;
+        SimulationObject* second;
+    };
+
+    std::vector<BoundPair> pairs;
+    std::vector<int> partners;
+    std::vector<int> nearest;
+    std::vector<double> nearestDist2;
+    std::vector<double> secondDist2;
+    std::vector<double> positionX;
+    std::vector<double> positionY;
+    std::vector<int> cellStart;
+    std::vector<int> cellBodies;
+    std::vector<int> cellOf;
+};
+
+#endif // REGULARIZATION_H
@@ -0,0 +1,340 @@
+#include "scenario.h"
+#include "simulationcontroller.h"
+#include <QFile>
+#include <QFileInfo>
+#include <QJsonArray>
+#include <QJsonDocument>
+#include <cmath>
+#include <random>
+
+static const double pi = 3.14159265358979323846;
+
+Scenario::Scenario()
+    : gforce(6.67408), timeStep(0.01), duration(1.0), precision(Precision::Double), restitution(1.0),
+      continuousCollisions(true), collisionMode(CollisionMode::Bounce), mergeDensity(0.0), collisionSkin(2.0),
+      softening{SofteningKernel::None, 0.0}, regularization(false), forceSolver(ForceSolver::Direct), meshSize(256),
+      meshBoundary(MeshBoundary::Isolated), meshShortRange(true), treeOpeningAngle(0.5),
+      boundaryPolicy(BoundaryPolicy::Open), bounds{-100.0, -100.0, 600.0, 600.0} {}
+
+bool Scenario::load(const QString& path, QString* error)
+{
+    QFile file(path);
+    if (!file.open(QIODevice::ReadOnly))
+    {
+        *error = QString("nie można otworzyć %1").arg(path);
+        return false;
+    }
+
+    QJsonParseError parseError;
+    QJsonDocument document = QJsonDocument::fromJson(file.readAll(), &parseError);
+    if (parseError.error != QJsonParseError::NoError)
+    {
+        *error = QString("%1: %2").arg(path).arg(parseError.errorString());
+        return false;
+    }
+
+    if (!fromJson(document.object(), error))
+        return false;
+
+    if (name.isEmpty())
+        name = QFileInfo(path).baseName();
+    return true;
+}
+
+bool Scenario::fromJson(const QJsonObject& object, QString* error)
+{
+    settings = object;
+    name = object["name"].toString();
+    gforce = object["gforce"].toDouble(6.67408);
+    timeStep = object["time_step"].toDouble(0.01);
+    duration = object["duration"].toDouble(1.0);
+    restitution = object["restitution"].toDouble(1.0);
+    continuousCollisions = object["continuous_collisions"].toBool(true);
+    mergeDensity = object["merge_density"].toDouble(0.0);
+    collisionSkin = object["collision_skin"].toDouble(2.0);
+    regularization = object["regularization"].toBool(false);
+
+    QString precisionName = object["precision"].toString("double");
+    if (precisionName == "double")
+        precision = Precision::Double;
+    else if (precisionName == "float")
+        precision = Precision::Float;
+    else if (precisionName == "mixed")
+        precision = Precision::Mixed;
+    else
+    {
+        *error = QString("nieznana precyzja '%1' (double, float, mixed)").arg(precisionName);
+        return false;
+    }
+
+    QString collisionName = object["collisions"].toString("bounce");
+    if (collisionName == "bounce")
+        collisionMode = CollisionMode::Bounce;
+    else if (collisionName == "merge")
+        collisionMode = CollisionMode::Merge;
+    else
+    {
+        *error = QString("nieznany tryb zderzeń '%1' (bounce, merge)").arg(collisionName);
+        return false;
+    }
+
+    QJsonObject softeningSpec = object["softening"].toObject();
+    QString kernelName = softeningSpec["kernel"].toString("none");
+    softening.length = softeningSpec["length"].toDouble(0.0);
+    if (kernelName == "none")
+        softening.kernel = SofteningKernel::None;
+    else if (kernelName == "plummer")
+        softening.kernel = SofteningKernel::Plummer;
+    else if (kernelName == "spline")
+        softening.kernel = SofteningKernel::Spline;
+    else
+    {
+        *error = QString("nieznane wygładzanie '%1' (none, plummer, spline)").arg(kernelName);
+        return false;
+    }
+    if (softening.kernel != SofteningKernel::None && softening.length <= 0.0)
+    {
+        *error = "softening.length musi być dodatnia";
+        return false;
+    }
+
+    QString solverName = object["solver"].toString("direct");
+    if (solverName == "direct")
+        forceSolver = ForceSolver::Direct;
+    else if (solverName == "pm")
+        forceSolver = ForceSolver::ParticleMesh;
+    else if (solverName == "tree")
+        forceSolver = ForceSolver::Tree;
+    else
+    {
+        *error = QString("nieznany solver '%1' (direct, pm, tree)").arg(solverName);
+        return false;
+    }
+
+    QJsonObject meshSpec = object["mesh"].toObject();
+    meshSize = meshSpec["size"].toInt(256);
+    meshShortRange = meshSpec["short_range"].toBool(true);
+    QString boundaryName = meshSpec["boundary"].toString("isolated");
+    if (boundaryName == "isolated")
+        meshBoundary = MeshBoundary::Isolated;
+    else if (boundaryName == "periodic")
+        meshBoundary = MeshBoundary::Periodic;
+    else
+    {
+        *error = QString("nieznany brzeg siatki '%1' (isolated, periodic)").arg(boundaryName);
+        return false;
+    }
+    if (meshSize < 16)
+    {
+        *error = "mesh.size musi wynosić co najmniej 16";
+        return false;
+    }
+
+    treeOpeningAngle = object["tree"].toObject()["opening_angle"].toDouble(0.5);
+    if (treeOpeningAngle <= 0.0)
+    {
+        *error = "tree.opening_angle musi być dodatni";
+        return false;
+    }
+
+    // Default bounds are the application's: the 500 x 500 area plus a 100 wide margin.
+    QJsonObject boundarySpec = object["boundary"].toObject();
+    QString policyName = boundarySpec["policy"].toString("open");
+    if (policyName == "open")
+        boundaryPolicy = BoundaryPolicy::Open;
+    else if (policyName == "reflect")
+        boundaryPolicy = BoundaryPolicy::Reflect;
+    else if (policyName == "periodic")
+        boundaryPolicy = BoundaryPolicy::Periodic;
+    else if (policyName == "absorb")
+        boundaryPolicy = BoundaryPolicy::Absorb;
+    else
+    {
+        *error = QString("nieznany brzeg '%1' (open, reflect, periodic, absorb)").arg(policyName);
+        return false;
+    }
+    bounds = {boundarySpec["left"].toDouble(-100.0), boundarySpec["top"].toDouble(-100.0),
+              boundarySpec["right"].toDouble(600.0), boundarySpec["bottom"].toDouble(600.0)};
+    if (bounds.right <= bounds.left || bounds.bottom <= bounds.top)
+    {
+        *error = "boundary: right i bottom muszą być większe niż left i top";
+        return false;
+    }
+    bodies.clear();
+
+    for (const QJsonValue& value : object["bodies"].toArray())
+    {
+        QJsonObject b = value.toObject();
+        bodies.append({b["name"].toString(QString("b%1").arg(bodies.size())), b["x"].toDouble(), b["y"].toDouble(),
+                       b["vx"].toDouble(), b["vy"].toDouble(), b["radius"].toDouble(1.0), b["mass"].toDouble(10.0)});
+    }
+
+    if (object.contains("generate") && !generate(object["generate"].toObject(), bodies, true, error))
+        return false;
+
+    tracers.clear();
+    if (object.contains("tracers") && !generate(object["tracers"].toObject(), tracers, false, error))
+        return false;
+
+    if (timeStep <= 0.0)
+    {
+        *error = "time_step musi być dodatni";
+        return false;
+    }
+
+    if (collisionSkin < 0.0)
+    {
+        *error = "collision_skin nie może być ujemny";
+        return false;
+    }
+
+    if (restitution < 0.0 || restitution > 1.0)
+    {
+        *error = "restitution musi należeć do przedziału [0, 1]";
+        return false;
+    }
+    return true;
+}
+
+bool Scenario::generate(const QJsonObject& spec, QList<ScenarioBody>& target, bool massive, QString* error)
+{
+    QString type = spec["type"].toString();
+    int count = spec["count"].toInt();
+    std::mt19937_64 rng(static_cast<quint64>(spec["seed"].toDouble(1)));
+    double radius = spec["radius"].toDouble(0.5);
+    std::uniform_real_distribution<double> unit(0.0, 1.0);
+
+    if (type == "uniform")
+    {
+        double size = spec["size"].toDouble(500.0);
+        double speed = spec["speed"].toDouble(0.0);
+        double minMass = spec["min_mass"].toDouble(1.0);
+        double maxMass = spec["max_mass"].toDouble(20.0);
+        for (int i = 0; i < count; ++i)
+        {
+            target.append({QString("u%1").arg(i), size * unit(rng), size * unit(rng), speed * (2.0 * unit(rng) - 1.0),
+                           speed * (2.0 * unit(rng) - 1.0), radius, minMass + (maxMass - minMass) * unit(rng)});
+        }
+        return true;
+    }
+
+    if (type == "disk")
+    {
+        double cx = spec["center_x"].toDouble(250.0);
+        double cy = spec["center_y"].toDouble(250.0);
+        double centralMass = spec["central_mass"].toDouble(10000.0);
+        double inner = spec["inner_radius"].toDouble(40.0);
+        double outer = spec["outer_radius"].toDouble(200.0);
+        double mass = spec["mass"].toDouble(0.1);
+        if (massive)
+            target.append({"centrum", cx, cy, 0.0, 0.0, spec["central_radius"].toDouble(10.0), centralMass});
+        for (int i = 0; i < count; ++i)
+        {
+            double r = inner + (outer - inner) * unit(rng);
+            double angle = 2.0 * pi * unit(rng);
+            double v = std::sqrt(gforce * centralMass / r);
+            target.append({QString("d%1").arg(i), cx + r * std::cos(angle), cy + r * std::sin(angle),
+                           -v * std::sin(angle), v * std::cos(angle), radius, mass});
+        }
+        return true;
+    }
+
+    *error = QString("nieznany typ generatora '%1'").arg(type);
+    return false;
+}
+
+void Scenario::apply(SimulationController* controller)
+{
+    controller->resetSimulation();
+    controller->setGForce(gforce);
+    controller->setTimeStep(timeStep);
+    controller->setPrecision(precision);
+    controller->setRestitution(restitution);
+    controller->setContinuousCollisions(continuousCollisions);
+    controller->setCollisionMode(collisionMode);
+    controller->setMergeDensity(mergeDensity);
+    controller->getNeighbourList().setSkin(collisionSkin);
+    controller->setSoftening(softening);
+    controller->setRegularization(regularization);
+    controller->getParticleMesh().setGridSize(meshSize);
+    controller->getParticleMesh().setBoundary(meshBoundary);
+    controller->getParticleMesh().setShortRange(meshShortRange);
+    controller->getTreeSolver().setOpeningAngle(treeOpeningAngle);
+    controller->setForceSolver(forceSolver);
+    controller->setBoundaryPolicy(boundaryPolicy);
+    controller->setBounds(bounds);
+    for (const ScenarioBody& b : bodies)
+        controller->addSimulationObject(b.name, {b.x, b.y}, {b.vx, b.vy}, b.radius, b.mass);
+    for (const ScenarioBody& t : tracers)
+        controller->addTestParticle({t.x, t.y}, {t.vx, t.vy});
+}
+
+double Scenario::getRestitution()
+{
+    return restitution;
+}
+
+bool Scenario::getContinuousCollisions()
+{
+    return continuousCollisions;
+}
+
+CollisionMode Scenario::getCollisionMode()
+{
+    return collisionMode;
+}
+
+Softening Scenario::getSoftening()
+{
+    return softening;
+}
+
+BoundaryPolicy Scenario::getBoundaryPolicy()
+{
+    return boundaryPolicy;
+}
+
+SimulationBounds Scenario::getBounds()
+{
+    return bounds;
+}
+
+QString Scenario::getName()
+{
+    return name;
+}
+
+double Scenario::getGForce()
+{
+    return gforce;
+}
+
+double Scenario::getTimeStep()
+{
+    return timeStep;
+}
+
+double Scenario::getDuration()
+{
+    return duration;
+}
+
+Precision Scenario::getPrecision()
+{
+    return precision;
+}
+
+QList<ScenarioBody>& Scenario::getBodies()
+{
+    return bodies;
+}
+
+QList<ScenarioBody>& Scenario::getTracers()
+{
+    return tracers;
+}
+
+QJsonObject Scenario::getSettings()
+{
+    return settings;
+}
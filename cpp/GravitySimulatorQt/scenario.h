@@ -0,0 +1,73 @@
+#ifndef SCENARIO_H
+#define SCENARIO_H
+
+#include <QJsonObject>
+#include <QList>
+#include <QString>
+#include "gravitykernel.h"
+#include "simulationcontroller.h"
+
+struct ScenarioBody {
+    QString name;
+    double x;
+    double y;
+    double vx;
+    double vy;
+    double radius;
+    double mass;
+};
+
+// Initial conditions loaded from JSON: an explicit "bodies" list and/or a seeded "generate" block
+// ("uniform" box or "disk" around a central mass), plus massless tracers from a "tracers" block in the same
+// generator format (a disk's central mass only sets the orbital speeds). Sections used only by particular tools (tolerances, sweeps)
+// stay available through getSettings().
+class Scenario {
+public:
+    Scenario();
+    bool load(const QString& path, QString* error);
+    bool fromJson(const QJsonObject& object, QString* error);
+    void apply(SimulationController* controller);
+
+    QString getName();
+    double getGForce();
+    double getTimeStep();
+    double getDuration();
+    Precision getPrecision();
+    double getRestitution();
+    bool getContinuousCollisions();
+    CollisionMode getCollisionMode();
+    Softening getSoftening();
+    BoundaryPolicy getBoundaryPolicy();
+    SimulationBounds getBounds();
+    QList<ScenarioBody>& getBodies();
+    QList<ScenarioBody>& getTracers();
+    QJsonObject getSettings();
+
+private:
+    QString name;
+    double gforce;
+    double timeStep;
+    double duration;
+    Precision precision;
+    double restitution;
+    bool continuousCollisions;
+    CollisionMode collisionMode;
+    double mergeDensity;
+    double collisionSkin;
+    Softening softening;
+    bool regularization;
+    ForceSolver forceSolver;
+    int meshSize;
+    MeshBoundary meshBoundary;
+    bool meshShortRange;
+    double treeOpeningAngle;
+    BoundaryPolicy boundaryPolicy;
+    SimulationBounds bounds;
+    QList<ScenarioBody> bodies;
+    QList<ScenarioBody> tracers;
+    QJsonObject settings;
+
+    bool generate(const QJsonObject& spec, QList<ScenarioBody>& target, bool massive, QString* error);
+};
+
+#endif // SCENARIO_H
@@ -2,13 +2,20 @@
 #include <QPainter>
 #include <QMouseEvent>
 #include <QBrush>
+#include <QPen>
+#include <QPolygonF>
 #include <QColor>
 #include <QFont>
 #include "simulationcontroller.h"
 #include <QtLogging>
 
 SimulationArea::SimulationArea(QWidget *parent, SimulationController *simulationController)
-    : QWidget(parent), simulationController(simulationController) {}
+    : QWidget(parent), simulationController(simulationController), overlayVisible(false), overlayFrames(0), overlaySteps(0),
+      cursorInside(false)
+{
+    // Moves without a pressed button are needed to preview a body before it is placed.
+    setMouseTracking(true);
+}
 
 
 void SimulationArea::updateSimulation()
@@ -17,6 +24,7 @@ void SimulationArea::updateSimulation()
 }
 
 void SimulationArea::paintEvent(QPaintEvent *event) {
+    PROFILE_SCOPE(ProfilePhase::Paint);
     QPainter painter(this);
     painter.setRenderHint(QPainter::Antialiasing);
     painter.setPen(Qt::transparent);
@@ -27,6 +35,9 @@ void SimulationArea::paintEvent(QPaintEvent *event) {
     QFont font("Sans", 13);
     painter.setFont(font);
 
+    paintTestParticles(painter);
+    paintTrajectoryPreview(painter);
+
     for (const auto &o : simulationController->getSimulationObjects()) {
         if (o->getIsHighlighted()) {
             painter.setBrush(QBrush(Qt::white, Qt::SolidPattern));
@@ -39,6 +50,123 @@ void SimulationArea::paintEvent(QPaintEvent *event) {
         painter.drawText(QPointF(o->getPosition().first + 10, o->getPosition().second + 10), o->getName());
         painter.setPen(Qt::transparent);
     }
+
+#ifdef GRAVSIM_PROFILING
+    if (overlayVisible)
+        paintOverlay(painter);
+#endif
+}
+
+// Tracers are plotted as single pixels into an image and blitted in one call; going through QPainter per
+// particle would cost more than simulating them.
+void SimulationArea::paintTestParticles(QPainter &painter)
+{
+    TestParticles &tracers = simulationController->getTestParticles();
+    if (tracers.getCount() == 0)
+        return;
+
+    if (tracerLayer.size() != size())
+        tracerLayer = QImage(size(), QImage::Format_ARGB32_Premultiplied);
+    tracerLayer.fill(Qt::transparent);
+
+    const std::vector<double> &x = tracers.getX();
+    const std::vector<double> &y = tracers.getY();
+    int width = tracerLayer.width();
+    int height = tracerLayer.height();
+    QRgb color = qRgb(70, 84, 94);
+    for (size_t i = 0; i < x.size(); ++i) {
+        int px = static_cast<int>(x[i]);
+        int py = static_cast<int>(y[i]);
+        if (px >= 0 && py >= 0 && px < width && py < height)
+            reinterpret_cast<QRgb *>(tracerLayer.scanLine(py))[px] = color;
+    }
+    painter.drawImage(0, 0, tracerLayer);
+}
+
+// The path is drawn as far as the preview thread has got; every repaint picks up the points added since.
+void SimulationArea::paintTrajectoryPreview(QPainter &painter)
+{
+    if (!simulationController->getTrajectoryPreview().getPath(previewPath) || previewPath.size() < 2)
+        return;
+
+    QPolygonF line;
+    line.reserve(static_cast<int>(previewPath.size()));
+    for (const auto &p : previewPath)
+        line.append(QPointF(p.first, p.second));
+    painter.setPen(QPen(QColor(255, 255, 255, 170), 1.5, Qt::DashLine));
+    painter.setBrush(Qt::NoBrush);
+    painter.drawPolyline(line);
+    painter.setPen(Qt::transparent);
+}
+
+bool SimulationArea::getCursorPosition(QPointF &result)
+{
+    result = cursorPosition;
+    return cursorInside;
+}
+
+void SimulationArea::setOverlayVisible(bool val)
+{
+    overlayVisible = val;
+    overlayTimer.start();
+    overlayFrames = 0;
+    overlaySteps = simulationController->getStepCount();
+    overlayLines.clear();
+    overlayWorkers = JobSystem::instance().getStats();
+}
+
+bool SimulationArea::getOverlayVisible()
+{
+    return overlayVisible;
+}
+
+void SimulationArea::paintOverlay(QPainter &painter)
+{
+    ++overlayFrames;
+    // Percentiles are recomputed a few times per second, not on every repaint.
+    if (overlayLines.isEmpty() || overlayTimer.elapsed() >= 500)
+    {
+        double seconds = qMax<qint64>(overlayTimer.restart(), 1) / 1000.0;
+        quint64 steps = simulationController->getStepCount();
+        overlayLines.clear();
+        overlayLines << QString("FPS: %1   kroki/s: %2").arg(overlayFrames / seconds, 0, 'f', 1)
+                                                           .arg((steps - overlaySteps) / seconds, 0, 'f', 1);
+        overlayLines << QString("%1 %2 %3").arg("faza", -12).arg("p50 [µs]", 10).arg("p99 [µs]", 10);
+        for (int p = 0; p < Profiler::phaseCount; ++p)
+        {
+            ProfileStats stats = Profiler::getStats(static_cast<ProfilePhase>(p));
+            overlayLines << QString("%1 %2 %3").arg(Profiler::getPhaseName(static_cast<ProfilePhase>(p)), -12)
+                                               .arg(stats.p50, 10, 'f', 1).arg(stats.p99, 10, 'f', 1);
+        }
+        // Share of the interval each worker spent in jobs; the last entry covers threads outside the pool. The
+        // counters are shared with other readers, so the overlay keeps its own snapshot instead of resetting them.
+        std::vector<WorkerStats> workers = JobSystem::instance().getStats();
+        if (overlayWorkers.size() != workers.size())
+            overlayWorkers.assign(workers.size(), WorkerStats{0, 0, 0});
+        overlayLines << QString("%1 %2 %3").arg("wątek", -12).arg("zajętość", 10).arg("kradzieże", 10);
+        for (size_t w = 0; w < workers.size(); ++w)
+        {
+            QString name = w + 1 < workers.size() ? QString::number(static_cast<int>(w)) : QString("wywołujący");
+            uint64_t busy = workers[w].busyNanoseconds -
+                            std::min(workers[w].busyNanoseconds, overlayWorkers[w].busyNanoseconds);
+            uint64_t steals = workers[w].steals - std::min(workers[w].steals, overlayWorkers[w].steals);
+            overlayLines << QString("%1 %2 %3").arg(name, -12)
+                                               .arg(QString("%1%").arg(busy / (seconds * 1e7), 0, 'f', 0), 10)
+                                               .arg(static_cast<quint64>(steals), 10);
+        }
+        overlayWorkers = workers;
+        overlayFrames = 0;
+        overlaySteps = steps;
+    }
+
+    painter.setPen(Qt::transparent);
+    painter.setBrush(QColor(0, 0, 0, 150));
+    painter.drawRect(QRectF(5, 5, 250, 16 * overlayLines.size() + 8));
+    painter.setPen(Qt::white);
+    painter.setFont(QFont("Monospace", 9));
+    for (int i = 0; i < overlayLines.size(); ++i)
+        painter.drawText(QPointF(10, 20 + 16 * i), overlayLines[i]);
+    painter.setPen(Qt::transparent);
 }
 
 void SimulationArea::mousePressEvent(QMouseEvent *event) {
@@ -51,27 +179,48 @@ void SimulationArea::mousePressEvent(QMouseEvent *event) {
         {
             simulationController->createSimulationObject(QPointF(x, y));
         }
-        else
+        else if (simulationController->getEditedObject())
         {
-            std::pair<double, double> prevPos = simulationController->getEditedObject()->getPosition();
-            simulationController->getEditedObject()->setPosition(x, y);
+            // The body is only tried at the new place here; editBodies() moves it and patches the field.
+            SimulationObject *edited = simulationController->getEditedObject();
+            std::pair<double, double> prevPos = edited->getPosition();
+            edited->setPosition(x, y);
 
+            bool collides = false;
             QList<SimulationObject *> simulationObjects = simulationController->getSimulationObjects();
             for (int i = 0; i < simulationObjects.length(); i++)
             {
                 SimulationObject* other = simulationObjects.at(i);
-                if (other->getPosition() == simulationController->getEditedObject()->getPosition())
+                if (other->getPosition() == edited->getPosition())
                 {
                     continue;
                 }
 
-                if (simulationController->getEditedObject()->detectCollision(*other))
+                if (edited->detectCollision(*other))
                 {
                     simulationController->getMainAppWindow()->setInfoLabel("akcja spowodowałaby kolizję!");
-                    simulationController->getEditedObject()->setPosition(prevPos.first, prevPos.second);
+                    collides = true;
                     break;
                 }
             }
+
+            edited->setPosition(prevPos.first, prevPos.second);
+            if (!collides)
+                simulationController->editBodies({{edited, {x, y}, edited->getVelocity(), edited->getMass(), edited->getRadius()}});
         }
+        simulationController->getMainAppWindow()->updatePreview();
     }
 }
+
+void SimulationArea::mouseMoveEvent(QMouseEvent *event) {
+    cursorInside = true;
+    cursorPosition = event->position();
+    if (simulationController->getIsAdding())
+        simulationController->getMainAppWindow()->updatePreview();
+}
+
+void SimulationArea::leaveEvent(QEvent *event) {
+    cursorInside = false;
+    if (simulationController->getIsAdding())
+        simulationController->getMainAppWindow()->updatePreview();
+}
@@ -3,15 +3,22 @@
 
 #include <QWidget>
 #include <QPointF>
+#include <QElapsedTimer>
+#include <QImage>
+#include <QStringList>
 #include "simulationcontroller.h"
 
 class SimulationController;
+class QPainter;
 
 class SimulationArea : public QWidget {
     Q_OBJECT
 
 public:
     SimulationArea(QWidget *parent, SimulationController *simulationController);
+    void setOverlayVisible(bool val);
+    bool getOverlayVisible();
+    bool getCursorPosition(QPointF &result);
 
 public slots:
     void updateSimulation();
@@ -19,9 +26,25 @@ public slots:
 protected:
     void paintEvent(QPaintEvent *event) override;
     void mousePressEvent(QMouseEvent *event) override;
+    void mouseMoveEvent(QMouseEvent *event) override;
+    void leaveEvent(QEvent *event) override;
 
 private:
     SimulationController *simulationController;
+    bool overlayVisible;
+    QElapsedTimer overlayTimer;
+    int overlayFrames;
+    quint64 overlaySteps;
+    QStringList overlayLines;
+    std::vector<WorkerStats> overlayWorkers;
+    QImage tracerLayer;
+    bool cursorInside;
+    QPointF cursorPosition;
+    std::vector<std::pair<double, double>> previewPath;
+
+    void paintTestParticles(QPainter &painter);
+    void paintTrajectoryPreview(QPainter &painter);
+    void paintOverlay(QPainter &painter);
 };
 
 #endif // SIMULATIONAREA_H
@@ -1,25 +1,54 @@
 #include "simulationcontroller.h"
 #include "simulationobject.h"
+#include <algorithm>
 #include <cmath>
+#include <thread>
 #include <QVariant>
 
+// Below this the bodies fit in one slab and in cache, so reordering would only cost time.
+static const int reorderMinBodies = SimulationObjectPool::slabSize;
+
 SimulationController::SimulationController(MainAppWindow* mainAppWindow, const QPoint& size, const QPoint& margin, double gforce, bool isPaused, double simulationSpeed, double timeRes, bool isAdding, SimulationObject* editedObject)
-    : mainAppWindow(mainAppWindow), size(size), margin(margin), gforce(gforce), isPaused(isPaused), simulationSpeed(simulationSpeed),
-      timeRes(timeRes), isAdding(isAdding), editedObject(editedObject)
+    : destroyedCount(0), mainAppWindow(mainAppWindow), gforce(gforce), isPaused(isPaused), simulationSpeed(simulationSpeed),
+      timeRes(timeRes), timeStep(0.01), integrator(Integrator::Euler), forcesValid(false), tracerForcesValid(false), potentialsValid(false),
+      precision(Precision::Double), forceSolver(ForceSolver::Direct), restitution(1.0), continuousCollisions(true),
+      collisionMode(CollisionMode::Bounce), mergeDensity(0.0), softening{SofteningKernel::None, 0.0}, regularization(false),
+      threadCount(std::max(1u, std::thread::hardware_concurrency())), boundaryPolicy(BoundaryPolicy::Open), escapeTally{0, 0.0, 0.0, 0.0, 0.0},
+      isAdding(isAdding), editedObject(editedObject), stepCount(0), simulationTime(0.0),
+      diagnosticsInterval(0), reorderInterval(100), reorderThreshold(0.25), reorderCount(0)
 {
+   // By default bodies may drift a margin's width outside the visible area before the boundary acts.
+   setBounds({-static_cast<double>(margin.x()), -static_cast<double>(margin.y()), static_cast<double>(size.x() + margin.x()),
+              static_cast<double>(size.y() + margin.y())});
+   selectForcePass();
    prevTime.start();
 }
 
 void SimulationController::resetSimulation()
 {
-    qDeleteAll(simulationObjects);
+    pool.clear();
     simulationObjects.clear();
+    destroyedCount = 0;
+    editedObject = nullptr;
     gforce = 6.67408;
+    stepCount = 0;
+    simulationTime = 0.0;
+    forcesValid = false;
+    potentialsValid = false;
+    previewSources.reset();
+    regularizer.clear();
+    neighbours.invalidate();
+    treeSolver.invalidate();
+    testParticles.clear();
+    escapeTally = {0, 0.0, 0.0, 0.0, 0.0};
+    diagnostics.clear();
+    trajectoryPreview.cancel();
     prevTime.restart();
 }
 
 void SimulationController::brr()
 {
+    PROFILE_SCOPE(ProfilePhase::Frame);
     double frameTime = prevTime.elapsed() / 1000.0;
     prevTime.restart();
 
@@ -27,66 +56,570 @@ void SimulationController::brr()
         return;
 
     timeRes += frameTime * simulationSpeed;
-    int stepsToGo = static_cast<int>(std::floor(timeRes / 0.01));
-    timeRes -= stepsToGo * 0.01;
+    int stepsToGo = static_cast<int>(std::floor(timeRes / timeStep));
+    timeRes -= stepsToGo * timeStep;
 
     for (int i = 0; i < stepsToGo; ++i)
-        nextFrame(0.01);
+        nextFrame(timeStep);
 }
 
 void SimulationController::nextFrame(double frameTime)
 {
-   simulateGravity(frameTime, gforce);
+   PROFILE_SCOPE(ProfilePhase::Step);
+   potentialsValid = false;
+   previewSources.reset();
+   // The regularizer takes out the exact pair force, which plain PM never put in for bodies sharing a cell, so
+   // pairs are only formed while the force pass resolves them.
+   bool resolvesPairs = forceSolver != ForceSolver::ParticleMesh || particleMesh.getShortRange();
+   if (regularization && resolvesPairs)
+   {
+       if (regularizer.findPairs(simulationObjects, gforce, frameTime, softening))
+           forcesValid = false;
+   }
+   else if (regularizer.getPairCount() > 0)
+   {
+       regularizer.clear();
+       forcesValid = false;
+   }
+
+   bool tracers = testParticles.getCount() > 0;
+   if (tracers)
+       beginTestParticleStep(frameTime);
+
+   if (integrator == Integrator::Leapfrog)
+       simulateLeapfrog(frameTime, gforce);
+   else
+       simulateGravity(frameTime, gforce);
+
+   if (tracers)
+       endTestParticleStep(frameTime);
+   ++stepCount;
+   simulationTime += frameTime;
+
+   if (reorderInterval > 0 && stepCount % reorderInterval == 0 && simulationObjects.size() >= reorderMinBodies &&
+       measureDisorder() > reorderThreshold)
+       applyMortonOrder();
+
+   publishTelemetry();
+
+   if (diagnosticsInterval > 0 && stepCount % diagnosticsInterval == 0)
+       measureDiagnostics();
 }
 
-void SimulationController::checkDestroyObject(SimulationObject* o)
+// Tracers follow the same scheme as the massive bodies: Euler kicks with the forces at the start of the step
+// and drifts, leapfrog kicks half a step on either side of the drift. Leapfrog reuses the forces from the end of
+// the previous step unless the massive bodies were edited since, even where their own forces were patched.
+// The first half runs as jobs alongside the massive bodies' step. Sources are copied before they move, so the
+// jobs touch only tracer data; endTestParticleStep() waits for them. With a single thread it runs inline and
+// the controller never touches the shared pool.
+void SimulationController::beginTestParticleStep(double frameTime)
 {
-    bool destroy = false;
-    if (o->getPosition().first < -margin.x() || o->getPosition().second < -margin.y() ||
-        o->getPosition().first > margin.x() + size.x() || o->getPosition().second > margin.y() + size.y())
+    bool needForces = integrator == Integrator::Euler || !forcesValid || !tracerForcesValid;
+    if (needForces)
     {
-        destroy = true;
+        testParticles.setSources(simulationObjects);
+        tracerForcesValid = true;
+    }
+    double g = gforce;
+    Softening kernel = softening;
+    double kick = integrator == Integrator::Leapfrog ? 0.5 * frameTime : frameTime;
+    auto forces = [this, g, kernel] {
+        PROFILE_SCOPE(ProfilePhase::Tracers);
+        testParticles.computeAccelerations(g, kernel);
+    };
+    auto advance = [this, kick, frameTime] {
+        PROFILE_SCOPE(ProfilePhase::Tracers);
+        testParticles.kick(kick);
+        testParticles.drift(frameTime);
+    };
+    if (threadCount == 1)
+    {
+        if (needForces)
+            forces();
+        advance();
+        return;
     }
 
-    if (destroy)
+    JobSystem& jobs = JobSystem::instance();
+    JobHandle forcesJob;
+    if (needForces)
+        forcesJob = jobs.submit(forces);
+    tracerStep = jobs.submit(advance, {forcesJob});
+}
+
+void SimulationController::endTestParticleStep(double frameTime)
+{
+    if (tracerStep)
     {
-        mainAppWindow->setInfoLabel(QString("Obiekt %1 opuścił obszar symulacji.").arg(o->getName()));
-        simulationObjects.removeOne(o);
-        delete o;
+        JobSystem::instance().wait(tracerStep);
+        tracerStep.reset();
     }
+    PROFILE_SCOPE(ProfilePhase::Tracers);
+    testParticles.setSources(simulationObjects);
+    if (integrator == Integrator::Leapfrog)
+    {
+        testParticles.computeAccelerations(gforce, softening);
+        testParticles.kick(0.5 * frameTime);
+    }
+    testParticles.applyBoundaries(boundaryPolicy, bounds);
 }
 
-void SimulationController::fallAll(double frameTime)
+// One pass over the bodies after integration. A body inside the bounds costs four comparisons; the others are
+// handled by the active policy. Deleted bodies are only marked here and compacted once by removeDestroyedObjects(),
+// and a whole batch of escapes produces a single message.
+void SimulationController::applyBoundaries()
 {
+    PROFILE_SCOPE(ProfilePhase::Escape);
+    int escaped = 0;
+    bool moved = false;
+    SimulationObject* lastEscaped = nullptr;
+    std::vector<SimulationObject*> absorbed;
     for (SimulationObject* o : simulationObjects)
     {
-        o->fall(frameTime);
-        checkDestroyObject(o);
+        std::pair<double, double> position = o->getPosition();
+        if (o->getIsDestroyed() || (position.first >= bounds.left && position.first <= bounds.right &&
+                                    position.second >= bounds.top && position.second <= bounds.bottom))
+            continue;
+
+        std::pair<double, double> velocity = o->getVelocity();
+        switch (boundaryPolicy)
+        {
+        case BoundaryPolicy::Reflect:
+            reflectInto(position.first, velocity.first, bounds.left, bounds.right);
+            reflectInto(position.second, velocity.second, bounds.top, bounds.bottom);
+            o->setPosition(position.first, position.second);
+            o->setVelocity(velocity.first, velocity.second);
+            moved = true;
+            break;
+        case BoundaryPolicy::Periodic:
+            wrapInto(position.first, bounds.left, bounds.right);
+            wrapInto(position.second, bounds.top, bounds.bottom);
+            o->setPosition(position.first, position.second);
+            moved = true;
+            break;
+        case BoundaryPolicy::Absorb:
+            absorbed.push_back(o);
+            [[fallthrough]];
+        case BoundaryPolicy::Open:
+            o->setIsDestroyed(true);
+            ++destroyedCount;
+            ++escaped;
+            lastEscaped = o;
+            break;
+        }
+    }
+
+    if (!absorbed.empty())
+        tallyEscapes(absorbed);
+    if (escaped == 1)
+        setInfoLabel(QString("Obiekt %1 opuścił obszar symulacji.").arg(lastEscaped->getName()));
+    else if (escaped > 1)
+        setInfoLabel(QString("Obiekty, które opuściły obszar symulacji: %1.").arg(escaped));
+    if (moved)
+        forcesValid = false;
+    removeDestroyedObjects();
+}
+
+// Mass, momentum and energy carried out by the bodies the walls absorbed in one boundary pass. Their potential
+// energy is taken with the bodies that stay and, once per pair, among themselves, so a pair leaving together is
+// counted once. The absorbed bodies are already marked destroyed, and one sweep over the survivors covers the
+// whole batch.
+void SimulationController::tallyEscapes(const std::vector<SimulationObject*>& absorbed)
+{
+    size_t k = absorbed.size();
+    std::vector<double> x(k), y(k), m(k);
+    for (size_t a = 0; a < k; ++a)
+    {
+        std::pair<double, double> velocity = absorbed[a]->getVelocity();
+        x[a] = absorbed[a]->getPosition().first;
+        y[a] = absorbed[a]->getPosition().second;
+        m[a] = absorbed[a]->getMass();
+        ++escapeTally.count;
+        escapeTally.mass += m[a];
+        escapeTally.momentumX += m[a] * velocity.first;
+        escapeTally.momentumY += m[a] * velocity.second;
+        escapeTally.energy += 0.5 * m[a] * (velocity.first * velocity.first + velocity.second * velocity.second);
+    }
+
+    double potential = 0.0;
+    for (size_t a = 0; a < k; ++a)
+    {
+        for (size_t b = a + 1; b < k; ++b)
+        {
+            double dist = std::hypot(x[b] - x[a], y[b] - y[a]);
+            potential += m[a] * m[b] * softenedPotential(dist, softening.kernel, softening.length);
+        }
+    }
+    for (SimulationObject* other : simulationObjects)
+    {
+        if (other->getIsDestroyed())
+            continue;
+        std::pair<double, double> position = other->getPosition();
+        double sum = 0.0;
+        for (size_t a = 0; a < k; ++a)
+        {
+            double dist = std::hypot(position.first - x[a], position.second - y[a]);
+            sum += m[a] * softenedPotential(dist, softening.kernel, softening.length);
+        }
+        potential += other->getMass() * sum;
+    }
+    escapeTally.energy += gforce * potential;
+}
+
+void SimulationController::removeDestroyedObjects()
+{
+    if (destroyedCount == 0)
+        return;
+
+    // Single in-place pass that keeps the order of the survivors.
+    int kept = 0;
+    for (int i = 0; i < simulationObjects.size(); ++i)
+    {
+        SimulationObject* o = simulationObjects[i];
+        if (o->getIsDestroyed())
+        {
+            if (o == editedObject)
+                editedObject = nullptr;
+            pool.release(o);
+        }
+        else
+        {
+            simulationObjects[kept++] = o;
+        }
     }
+    simulationObjects.resize(kept);
+    destroyedCount = 0;
+    forcesValid = false;
+    potentialsValid = false;
+    previewSources.reset();
+    neighbours.invalidate();
+    treeSolver.invalidate();
+
+    if (mainAppWindow)
+        mainAppWindow->syncObjectTiles();
+}
+
+void SimulationController::removeSimulationObject(SimulationObject* o)
+{
+    if (o->getIsDestroyed())
+        return;
+
+    o->setIsDestroyed(true);
+    ++destroyedCount;
+    removeDestroyedObjects();
+}
+
+void SimulationController::fallAll(double frameTime)
+{
+    for (SimulationObject* o : simulationObjects)
+        o->fall(frameTime);
+    applyBoundaries();
 }
 
 void SimulationController::simulateGravity(double frameTime, double gforce)
 {
+    computeForces();
+
+    if (continuousCollisions)
+    {
+        // Same update as simulateStepAll(), with contacts swept between the velocity and the position update.
+        {
+            PROFILE_SCOPE(ProfilePhase::Integration);
+            for (SimulationObject* o : simulationObjects)
+                o->kick(frameTime);
+        }
+        if (collisionMode == CollisionMode::Merge)
+            mergeAll(frameTime);
+        else
+            collideSweptAll(frameTime);
+        {
+            PROFILE_SCOPE(ProfilePhase::Integration);
+            for (SimulationObject* o : simulationObjects)
+            {
+                o->drift(frameTime);
+                o->resetAcceleration();
+            }
+            regularizer.drift(frameTime, gforce);
+        }
+    }
+    else
+    {
+        if (collisionMode == CollisionMode::Merge)
+            mergeAll(0.0);
+        else
+            collideAll();
+        simulateStepAll(frameTime);
+        regularizer.drift(frameTime, gforce);
+    }
+    applyBoundaries();
+}
+
+// Kick-drift-kick leapfrog. Accelerations from the end of the previous step are reused for the first kick,
+// so there is still one force evaluation per step unless the bodies were edited in between.
+void SimulationController::simulateLeapfrog(double frameTime, double gforce)
+{
+    if (!forcesValid)
+        computeForces();
+
+    if (continuousCollisions)
+    {
+        {
+            PROFILE_SCOPE(ProfilePhase::Integration);
+            for (SimulationObject* o : simulationObjects)
+                o->kick(0.5 * frameTime);
+        }
+        if (collisionMode == CollisionMode::Merge)
+            mergeAll(frameTime);
+        else
+            collideSweptAll(frameTime);
+        {
+            PROFILE_SCOPE(ProfilePhase::Integration);
+            for (SimulationObject* o : simulationObjects)
+                o->drift(frameTime);
+            regularizer.drift(frameTime, gforce);
+        }
+    }
+    else
+    {
+        {
+            PROFILE_SCOPE(ProfilePhase::Integration);
+            for (SimulationObject* o : simulationObjects)
+            {
+                o->kick(0.5 * frameTime);
+                o->drift(frameTime);
+            }
+            regularizer.drift(frameTime, gforce);
+        }
+        if (collisionMode == CollisionMode::Merge)
+            mergeAll(0.0);
+        else
+            collideAll();
+    }
+
+    computeForces();
+
+    {
+        PROFILE_SCOPE(ProfilePhase::Integration);
+        for (SimulationObject* o : simulationObjects)
+            o->kick(0.5 * frameTime);
+    }
+
+    applyBoundaries();
+}
+
+// Accelerations of all bodies with the active solver and precision. Precision::Double is the pairwise reference path.
+void SimulationController::computeForces()
+{
+    (this->*forcePass)();
+    regularizer.removeMutualForces(gforce, softening);
+    forcesValid = true;
+}
+
+// Solver, precision and softening kernel only change between steps, so the force pass is picked when one of them
+// does and every step runs an instantiation with all three fixed at compile time.
+void SimulationController::selectForcePass()
+{
+    using Pass = void (SimulationController::*)();
+    static const Pass directPasses[3][3] = {
+        {&SimulationController::computeDirectForces<SofteningKernel::None>,
+         &SimulationController::computeDirectForces<SofteningKernel::Plummer>,
+         &SimulationController::computeDirectForces<SofteningKernel::Spline>},
+        {&SimulationController::computeFloatForces<SofteningKernel::None>,
+         &SimulationController::computeFloatForces<SofteningKernel::Plummer>,
+         &SimulationController::computeFloatForces<SofteningKernel::Spline>},
+        {&SimulationController::computeMixedForces<SofteningKernel::None>,
+         &SimulationController::computeMixedForces<SofteningKernel::Plummer>,
+         &SimulationController::computeMixedForces<SofteningKernel::Spline>},
+    };
+
+    static const Pass treePasses[3] = {&SimulationController::computeTreeForces<SofteningKernel::None>,
+                                       &SimulationController::computeTreeForces<SofteningKernel::Plummer>,
+                                       &SimulationController::computeTreeForces<SofteningKernel::Spline>};
+
+    if (forceSolver == ForceSolver::ParticleMesh)
+        forcePass = &SimulationController::computeParticleMeshForces;
+    else if (forceSolver == ForceSolver::Tree)
+        forcePass = treePasses[static_cast<int>(softening.kernel)];
+    else
+        forcePass = directPasses[static_cast<int>(precision)][static_cast<int>(softening.kernel)];
+}
+
+template <SofteningKernel Softened>
+void SimulationController::computeDirectForces()
+{
+    PROFILE_SCOPE(ProfilePhase::Gravity);
+    for (SimulationObject* o : simulationObjects)
+        o->resetAcceleration();
     for (int i = 0; i < simulationObjects.size(); ++i)
     {
         SimulationObject* o1 = simulationObjects[i];
         for (int j = i + 1; j < simulationObjects.size(); ++j)
-        {
-            SimulationObject* o2 = simulationObjects[j];
-            o1->applyGravity(*o2, gforce);
+            o1->applyGravity<Softened>(*simulationObjects[j], gforce, softening.length);
+    }
+}
 
+template <SofteningKernel Softened>
+void SimulationController::computeFloatForces()
+{
+    computeForcesWith(floatKernel, [this] { floatKernel.compute<Softened>(gforce, softening.length); });
+}
+
+template <SofteningKernel Softened>
+void SimulationController::computeMixedForces()
+{
+    computeForcesWith(mixedKernel, [this] { mixedKernel.compute<Softened>(gforce, softening.length); });
+}
+
+void SimulationController::computeParticleMeshForces()
+{
+    computeForcesWith(particleMesh, [this] { particleMesh.compute(gforce, softening); });
+}
+
+template <SofteningKernel Softened>
+void SimulationController::computeTreeForces()
+{
+    computeForcesWith(treeSolver, [this] { treeSolver.compute<Softened>(gforce, softening.length); });
+}
+
+void SimulationController::collideAll()
+{
+    PROFILE_SCOPE(ProfilePhase::Collisions);
+    neighbours.update(simulationObjects, 0.0);
+    for (int i = 0; i < simulationObjects.size(); ++i)
+    {
+        SimulationObject* o1 = simulationObjects[i];
+        for (const int* j = neighbours.begin(i); j != neighbours.end(i); ++j)
+        {
+            SimulationObject* o2 = simulationObjects[*j];
             if (o1->detectCollision(*o2))
             {
-                mainAppWindow->setInfoLabel(QString("Kolizja obiektów %1 i %2.")
+                setInfoLabel(QString("Kolizja obiektów %1 i %2.")
                                               .arg(o1->getName())
                                                    .arg(o2->getName()));
-               o1->collide(*o2);
+               o1->collide(*o2, restitution);
             }
         }
+    }
+}
+
+// Continuous detection for the drift of length frameTime that follows. A pair that touches at fraction t of the
+// step is moved to the contact, resolved there and moved back along its new velocities, so the drift ends where
+// the bounce would have taken it. Pairs are resolved once per step in list order.
+void SimulationController::collideSweptAll(double frameTime)
+{
+    PROFILE_SCOPE(ProfilePhase::Collisions);
+    neighbours.update(simulationObjects, frameTime);
+    for (int i = 0; i < simulationObjects.size(); ++i)
+    {
+        SimulationObject* o1 = simulationObjects[i];
+        for (const int* j = neighbours.begin(i); j != neighbours.end(i); ++j)
+        {
+            SimulationObject* o2 = simulationObjects[*j];
+            if (regularizer.getPartner(i) == *j)
+                continue;
+
+            double t = o1->timeOfImpact(*o2, frameTime);
+            if (t < 0.0)
+                continue;
+
+            setInfoLabel(QString("Kolizja obiektów %1 i %2.").arg(o1->getName()).arg(o2->getName()));
+            double contactTime = t * frameTime;
+            o1->drift(contactTime);
+            o2->drift(contactTime);
+            o1->collide(*o2, restitution);
+            o1->drift(-contactTime);
+            o2->drift(-contactTime);
+        }
+    }
+}
 
-        simulationObjects[i]->simulateStep(frameTime);
-        checkDestroyObject(simulationObjects[i]);
+int SimulationController::findMergeGroup(int i)
+{
+    while (mergeGroups[i] != i)
+    {
+        mergeGroups[i] = mergeGroups[mergeGroups[i]];
+        i = mergeGroups[i];
     }
+    return i;
+}
+
+// Merges every set of bodies connected by contacts (overlapping now or touching within frameTime) into its
+// heaviest member, ties going to the older body. Groups are found first and absorbed in list order, so a chain
+// A+B+C gives the same body whatever order the contacts were found in. Absorbed bodies are marked and the list
+// is compacted once at the end, before the next force evaluation could still see them.
+void SimulationController::mergeAll(double frameTime)
+{
+    PROFILE_SCOPE(ProfilePhase::Collisions);
+    int n = simulationObjects.size();
+    mergeGroups.resize(n);
+    for (int i = 0; i < n; ++i)
+        mergeGroups[i] = i;
+
+    bool merging = false;
+    neighbours.update(simulationObjects, frameTime);
+    for (int i = 0; i < n; ++i)
+    {
+        SimulationObject* o1 = simulationObjects[i];
+        for (const int* candidate = neighbours.begin(i); candidate != neighbours.end(i); ++candidate)
+        {
+            int j = *candidate;
+            if (regularizer.getPartner(i) == j || o1->timeOfImpact(*simulationObjects[j], frameTime) < 0.0)
+                continue;
+
+            int a = findMergeGroup(i);
+            int b = findMergeGroup(j);
+            if (a != b)
+                mergeGroups[std::max(a, b)] = std::min(a, b);
+            merging = true;
+        }
+    }
+    if (!merging)
+        return;
+
+    mergeSurvivors.assign(n, -1);
+    for (int i = 0; i < n; ++i)
+    {
+        int group = findMergeGroup(i);
+        int survivor = mergeSurvivors[group];
+        SimulationObject* o = simulationObjects[i];
+        if (survivor < 0 || o->getMass() > simulationObjects[survivor]->getMass() ||
+            (o->getMass() == simulationObjects[survivor]->getMass() && o->getId() < simulationObjects[survivor]->getId()))
+            mergeSurvivors[group] = i;
+    }
+
+    int merged = 0;
+    SimulationObject* lastAbsorbed = nullptr;
+    SimulationObject* lastSurvivor = nullptr;
+    for (int i = 0; i < n; ++i)
+    {
+        SimulationObject* survivor = simulationObjects[mergeSurvivors[findMergeGroup(i)]];
+        SimulationObject* o = simulationObjects[i];
+        if (o == survivor)
+            continue;
+
+        if (o == editedObject)
+            editedObject = survivor;
+        survivor->absorb(*o, mergeDensity);
+        o->setIsDestroyed(true);
+        ++destroyedCount;
+        ++merged;
+        lastAbsorbed = o;
+        lastSurvivor = survivor;
+    }
+
+    // The absorbed body goes back to the pool below, so its name is read first.
+    QString message = merged == 1
+        ? QString("Obiekt %1 połączył się z %2.").arg(lastAbsorbed->getName()).arg(lastSurvivor->getName())
+        : QString("Połączono %1 obiektów.").arg(merged);
+    removeDestroyedObjects();
+    setInfoLabel(message);
+}
+
+void SimulationController::simulateStepAll(double frameTime)
+{
+    PROFILE_SCOPE(ProfilePhase::Integration);
+    for (SimulationObject* o : simulationObjects)
+        o->simulateStep(frameTime);
 }
 
 void SimulationController::highlightObject(SimulationObject* o)
@@ -102,25 +635,104 @@ void SimulationController::adjustObject(SimulationObject* o)
     QString name = mainAppWindow->getNameEditValue(o->getName());
     o->setName(name);
 
-    double mass = mainAppWindow->getMassEditValue(o->getMass());
-    o->setMass(mass);
-
-    double radius = mainAppWindow->getRadiusEditValue(o->getRadius());
-    o->setRadius(radius);
-
     std::pair<double, double> currentPosition = o->getPosition();
-    std::pair<double, double> position = mainAppWindow->getPositionEditValue(currentPosition.first, currentPosition.second);
+    std::pair<double, double> currentVelocity = o->getVelocity();
+    editBodies({{o, mainAppWindow->getPositionEditValue(currentPosition.first, currentPosition.second),
+                 mainAppWindow->getVelocityEditValue(currentVelocity.first, currentVelocity.second),
+                 mainAppWindow->getMassEditValue(o->getMass()), mainAppWindow->getRadiusEditValue(o->getRadius())}});
 
-    o->setPosition(position.first, position.second);
+    mainAppWindow->clearEditFields();
+    mainAppWindow->setInfoLabel(QString("edytowano obiekt %1").arg(o->getName()));
+}
 
-    std::pair<double, double> currentVelocity = o->getVelocity();
-    std::pair<double, double> velocity = mainAppWindow->getVelocityEditValue(currentVelocity.first, currentVelocity.second);
+// Edits bodies without recomputing the field from scratch where the caches allow it: each edited body's old
+// contribution is taken out of every other body's acceleration and potential and its new one added, O(N) per
+// body, and its own are summed anew. Edits are applied in order, so each sees the ones before it. The cached
+// accelerations are patched only when they are the exact pairwise sums leapfrog keeps between steps; for
+// other solvers they are invalidated as before. Batches touching more than a quarter of the bodies are cheaper
+// to recompute in one pass. While paused the diagnostics are sampled again, from the patched potentials.
+void SimulationController::editBodies(const std::vector<BodyEdit>& edits)
+{
+    size_t n = static_cast<size_t>(simulationObjects.size());
+    bool exactForces = forcesValid && integrator == Integrator::Leapfrog && forceSolver == ForceSolver::Direct &&
+                       precision == Precision::Double && regularizer.getPairCount() == 0;
+    bool incremental = 4 * edits.size() <= n;
+    bool fieldChanged = false;
+    for (const BodyEdit& edit : edits)
+    {
+        SimulationObject* o = edit.object;
+        if (edit.position != o->getPosition() || edit.mass != o->getMass())
+        {
+            fieldChanged = true;
+            if (incremental && (exactForces || potentialsValid))
+                patchField(o, edit.position, edit.mass, exactForces);
+        }
+        o->setPosition(edit.position.first, edit.position.second);
+        o->setVelocity(edit.velocity.first, edit.velocity.second);
+        o->setMass(edit.mass);
+        o->setRadius(edit.radius);
+    }
+    neighbours.invalidate();
+    previewSources.reset();
 
-    o->setVelocity(velocity.first, velocity.second);
+    if (fieldChanged && !incremental)
+    {
+        potentialsValid = false;
+        if (exactForces)
+            computeForces();
+    }
+    if (fieldChanged && !exactForces)
+        forcesValid = false;
+    if (fieldChanged)
+        tracerForcesValid = false;
+    if (isPaused && diagnosticsInterval > 0)
+        measureDiagnostics();
+}
 
-    mainAppWindow->clearEditFields();
+// Moves o's share of the field from its current position and mass to the given ones. Terms are the ones
+// computeDirectForces() and the diagnostics sum, so a patched field matches a recomputed one to rounding.
+void SimulationController::patchField(SimulationObject* o, std::pair<double, double> position, double mass, bool patchForces)
+{
+    std::pair<double, double> oldPosition = o->getPosition();
+    double oldMass = o->getMass();
+    double ax = 0.0, ay = 0.0, potential = 0.0;
+    int self = -1;
+    for (int j = 0; j < simulationObjects.size(); ++j)
+    {
+        SimulationObject* other = simulationObjects[j];
+        if (other == o)
+        {
+            self = j;
+            continue;
+        }
 
-    mainAppWindow->setInfoLabel(QString("edytowano obiekt %1").arg(o->getName()));
+        std::pair<double, double> p = other->getPosition();
+        double oldX = oldPosition.first - p.first, oldY = oldPosition.second - p.second;
+        double newX = position.first - p.first, newY = position.second - p.second;
+        double oldDist2 = oldX * oldX + oldY * oldY;
+        double newDist2 = newX * newX + newY * newY;
+        if (patchForces)
+        {
+            double oldFactor = softenedInverseCube(oldDist2, softening.kernel, softening.length);
+            double newFactor = softenedInverseCube(newDist2, softening.kernel, softening.length);
+            std::pair<double, double> a = other->getAcceleration();
+            other->setAcceleration(a.first + gforce * (newX * newFactor * mass - oldX * oldFactor * oldMass),
+                                   a.second + gforce * (newY * newFactor * mass - oldY * oldFactor * oldMass));
+            ax -= gforce * newX * newFactor * other->getMass();
+            ay -= gforce * newY * newFactor * other->getMass();
+        }
+        if (potentialsValid)
+        {
+            double newPotential = softenedPotential(std::sqrt(newDist2), softening.kernel, softening.length);
+            double oldPotential = softenedPotential(std::sqrt(oldDist2), softening.kernel, softening.length);
+            potentials[j] += gforce * (mass * newPotential - oldMass * oldPotential);
+            potential += gforce * other->getMass() * newPotential;
+        }
+    }
+    if (patchForces)
+        o->setAcceleration(ax, ay);
+    if (potentialsValid && self >= 0)
+        potentials[self] = potential;
 }
 
 void SimulationController::createSimulationObject(const QPointF& clickPosition)
@@ -137,13 +749,13 @@ void SimulationController::createSimulationObject(const QPointF& clickPosition)
     double radius = mainAppWindow->getRadiusEditValue(10.0);
     std::pair<double, double> velocity =  mainAppWindow->getVelocityEditValue(0.0, 0.0);
     std::pair<double, double> acceleration(0, 0);
-    SimulationObject* o = new SimulationObject(name, position, velocity, acceleration, radius, mass);
+    SimulationObject candidate(name, position, velocity, acceleration, radius, mass);
 
     bool canPlace = true;
     for (int i = 0; i < simulationObjects.size(); i++)
     {
         SimulationObject* other = simulationObjects.at(i);
-        if (o->detectCollision(*other))
+        if (candidate.detectCollision(*other))
         {
             mainAppWindow->setInfoLabel("akcja spowodowałaby kolizję!");
             canPlace = false;
@@ -153,13 +765,79 @@ void SimulationController::createSimulationObject(const QPointF& clickPosition)
 
     if (canPlace)
     {
-        simulationObjects.push_back(o);
+        SimulationObject* o = addSimulationObject(name, position, velocity, radius, mass);
         mainAppWindow->addObjectTile(o);
         mainAppWindow->setInfoLabel(QString("dodano obiekt %1").arg(o->getName()));
         mainAppWindow->clearEditFields();
     }
 }
 
+SimulationObject* SimulationController::addSimulationObject(const QString& name, std::pair<double, double> position,
+                                                            std::pair<double, double> velocity, double radius, double mass)
+{
+    SimulationObject* o = pool.acquire(name, position, velocity, radius, mass);
+    simulationObjects.push_back(o);
+    forcesValid = false;
+    potentialsValid = false;
+    previewSources.reset();
+    neighbours.invalidate();
+    treeSolver.invalidate();
+    return o;
+}
+
+void SimulationController::addTestParticle(std::pair<double, double> position, std::pair<double, double> velocity)
+{
+    testParticles.add(position.first, position.second, velocity.first, velocity.second);
+    // Tracers pull nothing, so the bodies' forces stand. While they are valid the next leapfrog step reuses the
+    // tracers' accelerations too, so the new tracer gets its own, from sources refreshed at O(M) like its sum;
+    // otherwise the step recomputes them all.
+    if (forcesValid && tracerForcesValid)
+    {
+        testParticles.setSources(simulationObjects);
+        testParticles.computeAcceleration(testParticles.getCount() - 1, gforce, softening);
+    }
+}
+
+TestParticles& SimulationController::getTestParticles()
+{
+    return testParticles;
+}
+
+// Hands the preview the candidate and a snapshot of the bodies, and returns at once. The snapshot is taken on
+// the first request after the bodies changed and shared by the requests until the next change, so mouse moves
+// between steps cost no copy whatever the number of bodies.
+void SimulationController::previewTrajectory(std::pair<double, double> position, std::pair<double, double> velocity,
+                                             double mass, double radius, SimulationObject* exclude)
+{
+    if (!previewSources)
+    {
+        auto snapshot = std::make_shared<std::vector<PreviewBody>>();
+        snapshot->reserve(simulationObjects.size());
+        for (SimulationObject* o : simulationObjects)
+        {
+            if (o->getIsDestroyed())
+                continue;
+            std::pair<double, double> p = o->getPosition();
+            std::pair<double, double> v = o->getVelocity();
+            snapshot->push_back({p.first, p.second, v.first, v.second, o->getMass(), o->getRadius(), o->getId()});
+        }
+        previewSources = snapshot;
+    }
+    PreviewRequest request{{position.first, position.second, velocity.first, velocity.second, mass, radius, 0},
+                           previewSources, exclude ? exclude->getId() : 0, gforce, softening, timeStep};
+    trajectoryPreview.request(std::move(request));
+}
+
+void SimulationController::clearPreview()
+{
+    trajectoryPreview.cancel();
+}
+
+TrajectoryPreview& SimulationController::getTrajectoryPreview()
+{
+    return trajectoryPreview;
+}
+
 void SimulationController::chooseObjectToEdit(SimulationObject* o)
 {
     if (o)
@@ -167,6 +845,7 @@ void SimulationController::chooseObjectToEdit(SimulationObject* o)
         mainAppWindow->setInfoLabel(QString("wybrano obiekt %1").arg(o->getName()));
         highlightObject(o);
         editedObject = o;
+        mainAppWindow->updatePreview();
     }
 }
 
@@ -221,3 +900,356 @@ void SimulationController::setSimulationSpeed(double val)
 {
     simulationSpeed = val;
 }
+
+
+bool SimulationController::enableTelemetry(const QString& name, int slotCount, int maxBodies)
+{
+    return telemetry.open(name.toStdString(), slotCount, maxBodies);
+}
+
+void SimulationController::publishTelemetry()
+{
+    if (!telemetry.isOpen())
+        return;
+
+    PROFILE_SCOPE(ProfilePhase::Telemetry);
+    std::vector<TelemetryBody>& staging = telemetry.getStaging();
+    staging.clear();
+    for (SimulationObject* o : simulationObjects)
+    {
+        if (staging.size() == telemetry.getMaxBodies())
+            break;
+
+        std::pair<double, double> position = o->getPosition();
+        std::pair<double, double> velocity = o->getVelocity();
+        staging.push_back({position.first, position.second, velocity.first, velocity.second});
+    }
+    telemetry.publish(stepCount, simulationTime);
+}
+
+quint64 SimulationController::getStepCount()
+{
+    return stepCount;
+}
+
+double SimulationController::getSimulationTime()
+{
+    return simulationTime;
+}
+
+void SimulationController::setDiagnosticsInterval(int val)
+{
+    diagnosticsInterval = val;
+}
+
+int SimulationController::getDiagnosticsInterval()
+{
+    return diagnosticsInterval;
+}
+
+DiagnosticsSample SimulationController::measureDiagnostics()
+{
+    std::vector<DiagnosticBody>& bodies = diagnostics.getBodies();
+    bodies.clear();
+    for (SimulationObject* o : simulationObjects)
+    {
+        std::pair<double, double> position = o->getPosition();
+        std::pair<double, double> velocity = o->getVelocity();
+        bodies.push_back({position.first, position.second, velocity.first, velocity.second, o->getMass()});
+    }
+    // The potentials of a full measurement are kept for editBodies() until the bodies move.
+    if (potentialsValid)
+    {
+        diagnostics.getPotentials() = potentials;
+        return diagnostics.computeFromPotentials(stepCount, simulationTime);
+    }
+    DiagnosticsSample sample = diagnostics.compute(gforce, stepCount, simulationTime);
+    potentials = diagnostics.getPotentials();
+    potentialsValid = true;
+    return sample;
+}
+
+SimulationDiagnostics& SimulationController::getDiagnostics()
+{
+    return diagnostics;
+}
+
+double SimulationController::getGForce()
+{
+    return gforce;
+}
+
+void SimulationController::setGForce(double val)
+{
+    gforce = val;
+    forcesValid = false;
+    potentialsValid = false;
+}
+
+double SimulationController::getTimeStep()
+{
+    return timeStep;
+}
+
+void SimulationController::setTimeStep(double val)
+{
+    timeStep = val;
+}
+
+Integrator SimulationController::getIntegrator()
+{
+    return integrator;
+}
+
+void SimulationController::setIntegrator(Integrator val)
+{
+    integrator = val;
+    forcesValid = false;
+}
+
+void SimulationController::invalidateForces()
+{
+    forcesValid = false;
+    potentialsValid = false;
+    neighbours.invalidate();
+}
+
+// How many ways every parallel part of the engine splits its work; the pieces run on the shared JobSystem.
+// Their reductions have a fixed shape, so this changes speed only, never results.
+void SimulationController::setThreadCount(int val)
+{
+    threadCount = std::max(1, val);
+    floatKernel.setThreadCount(threadCount);
+    mixedKernel.setThreadCount(threadCount);
+    particleMesh.setThreadCount(threadCount);
+    treeSolver.setThreadCount(threadCount);
+    testParticles.setThreadCount(threadCount);
+    diagnostics.setThreadCount(threadCount);
+    mortonOrder.setThreadCount(threadCount);
+    neighbours.setThreadCount(threadCount);
+}
+
+void SimulationController::setInfoLabel(const QString& text)
+{
+    if (mainAppWindow)
+        mainAppWindow->setInfoLabel(text);
+}
+
+Precision SimulationController::getPrecision()
+{
+    return precision;
+}
+
+void SimulationController::setPrecision(Precision val)
+{
+    precision = val;
+    forcesValid = false;
+    selectForcePass();
+}
+
+// Stages the Morton keys of the current bodies and returns the fraction of neighbours in storage order
+// that are out of Morton order.
+double SimulationController::measureDisorder()
+{
+    std::vector<double>& x = mortonOrder.getX();
+    std::vector<double>& y = mortonOrder.getY();
+    x.resize(simulationObjects.size());
+    y.resize(simulationObjects.size());
+    for (int i = 0; i < simulationObjects.size(); ++i)
+    {
+        std::pair<double, double> position = simulationObjects[i]->getPosition();
+        x[i] = position.first;
+        y[i] = position.second;
+    }
+    return mortonOrder.computeKeys();
+}
+
+void SimulationController::reorderBodies()
+{
+    removeDestroyedObjects();
+    measureDisorder();
+    applyMortonOrder();
+}
+
+// Sorts the staged keys and moves the bodies into pool slots in that order, so neighbours in space are
+// neighbours in memory. Ids travel with the bodies; the edited object and the tiles are found again by id.
+void SimulationController::applyMortonOrder()
+{
+    PROFILE_SCOPE(ProfilePhase::Reorder);
+    mortonOrder.sort();
+
+    quint64 editedId = editedObject ? editedObject->getId() : 0;
+    reorderScratch.resize(simulationObjects.size());
+    for (int i = 0; i < simulationObjects.size(); ++i)
+        reorderScratch[i] = simulationObjects[mortonOrder.getIndex(i)];
+    simulationObjects.swap(reorderScratch);
+    pool.rearrange(simulationObjects);
+    neighbours.invalidate();
+    treeSolver.invalidate();
+    potentialsValid = false;
+    ++reorderCount;
+
+    editedObject = nullptr;
+    for (SimulationObject* o : simulationObjects)
+    {
+        if (editedId != 0 && o->getId() == editedId)
+        {
+            editedObject = o;
+            break;
+        }
+    }
+
+    if (mainAppWindow)
+        mainAppWindow->syncObjectTiles();
+}
+
+void SimulationController::setReorderInterval(int val)
+{
+    reorderInterval = val;
+}
+
+int SimulationController::getReorderInterval()
+{
+    return reorderInterval;
+}
+
+void SimulationController::setReorderThreshold(double val)
+{
+    reorderThreshold = val;
+}
+
+double SimulationController::getReorderThreshold()
+{
+    return reorderThreshold;
+}
+
+quint64 SimulationController::getReorderCount()
+{
+    return reorderCount;
+}
+
+double SimulationController::getRestitution()
+{
+    return restitution;
+}
+
+void SimulationController::setRestitution(double val)
+{
+    restitution = val;
+}
+
+bool SimulationController::getContinuousCollisions()
+{
+    return continuousCollisions;
+}
+
+void SimulationController::setContinuousCollisions(bool val)
+{
+    continuousCollisions = val;
+}
+
+CollisionMode SimulationController::getCollisionMode()
+{
+    return collisionMode;
+}
+
+void SimulationController::setCollisionMode(CollisionMode val)
+{
+    collisionMode = val;
+}
+
+double SimulationController::getMergeDensity()
+{
+    return mergeDensity;
+}
+
+void SimulationController::setMergeDensity(double val)
+{
+    mergeDensity = val;
+}
+
+Softening SimulationController::getSoftening()
+{
+    return softening;
+}
+
+void SimulationController::setSoftening(const Softening& val)
+{
+    softening = val;
+    if (softening.length <= 0.0)
+        softening.kernel = SofteningKernel::None;
+    diagnostics.setSoftening(softening);
+    forcesValid = false;
+    potentialsValid = false;
+    selectForcePass();
+}
+
+ForceSolver SimulationController::getForceSolver()
+{
+    return forceSolver;
+}
+
+void SimulationController::setForceSolver(ForceSolver val)
+{
+    forceSolver = val;
+    forcesValid = false;
+    selectForcePass();
+}
+
+ParticleMeshSolver& SimulationController::getParticleMesh()
+{
+    return particleMesh;
+}
+
+TreeSolver& SimulationController::getTreeSolver()
+{
+    return treeSolver;
+}
+
+BoundaryPolicy SimulationController::getBoundaryPolicy()
+{
+    return boundaryPolicy;
+}
+
+void SimulationController::setBoundaryPolicy(BoundaryPolicy val)
+{
+    boundaryPolicy = val;
+}
+
+SimulationBounds SimulationController::getBounds()
+{
+    return bounds;
+}
+
+void SimulationController::setBounds(const SimulationBounds& val)
+{
+    bounds = val;
+    particleMesh.setPeriodicBox(bounds.left, bounds.top, bounds.right - bounds.left, bounds.bottom - bounds.top);
+}
+
+EscapeTally SimulationController::getEscapeTally()
+{
+    return escapeTally;
+}
+
+NeighbourList& SimulationController::getNeighbourList()
+{
+    return neighbours;
+}
+
+bool SimulationController::getRegularization()
+{
+    return regularization;
+}
+
+void SimulationController::setRegularization(bool val)
+{
+    regularization = val;
+    regularizer.clear();
+    forcesValid = false;
+}
+
+int SimulationController::getRegularizedPairCount()
+{
+    return regularizer.getPairCount();
+}
@@ -6,10 +6,37 @@
 #include <QPointF>
 #include <QElapsedTimer>
 #include "simulationobject.h"
+#include "simulationobjectpool.h"
+#include "telemetrypublisher.h"
+#include "profiler.h"
+#include "diagnostics.h"
+#include "boundary.h"
+#include "gravitykernel.h"
+#include "jobsystem.h"
+#include "mortonorder.h"
+#include "neighbourlist.h"
+#include "pmsolver.h"
+#include "regularization.h"
+#include "softening.h"
+#include "testparticles.h"
+#include "treesolver.h"
+#include "trajectorypreview.h"
 #include "mainwindow.h"
 
 class MainAppWindow;
 
+enum class Integrator { Euler, Leapfrog };
+enum class CollisionMode { Bounce, Merge };
+
+// The new state of one body for editBodies().
+struct BodyEdit {
+    SimulationObject* object;
+    std::pair<double, double> position;
+    std::pair<double, double> velocity;
+    double mass;
+    double radius;
+};
+
 class SimulationController : public QObject {
     Q_OBJECT
 
@@ -20,12 +47,29 @@ public:
     SimulationController(MainAppWindow* mainAppWindow, const QPoint& size, const QPoint& margin, double gforce, bool isPaused, double simulationSpeed, double timeRes, bool isAdding, SimulationObject* editedObject);
     void resetSimulation();
     void nextFrame(double frameTime);
-    void checkDestroyObject(SimulationObject* o);
     void fallAll(double frameTime);
     void simulateGravity(double frameTime, double gforce);
+    void simulateLeapfrog(double frameTime, double gforce);
+    void computeForces();
+    void collideAll();
+    void collideSweptAll(double frameTime);
+    void mergeAll(double frameTime);
+    void simulateStepAll(double frameTime);
+    void applyBoundaries();
+    void removeDestroyedObjects();
+    void removeSimulationObject(SimulationObject* o);
     void highlightObject(SimulationObject* o);
     void adjustObject(SimulationObject* o);
+    void editBodies(const std::vector<BodyEdit>& edits);
     void createSimulationObject(const QPointF& clickPosition);
+    SimulationObject* addSimulationObject(const QString& name, std::pair<double, double> position,
+                                          std::pair<double, double> velocity, double radius, double mass);
+    void addTestParticle(std::pair<double, double> position, std::pair<double, double> velocity);
+    TestParticles& getTestParticles();
+    void previewTrajectory(std::pair<double, double> position, std::pair<double, double> velocity, double mass,
+                           double radius, SimulationObject* exclude);
+    void clearPreview();
+    TrajectoryPreview& getTrajectoryPreview();
     void chooseObjectToEdit(SimulationObject* o);
     void unhighlight();
     SimulationObject* getSimulationObject(int i);
@@ -37,19 +81,151 @@ public:
     void setIsAdding(bool val);
     MainAppWindow* getMainAppWindow();
     void setSimulationSpeed(double val);
+    double getGForce();
+    void setGForce(double val);
+    double getTimeStep();
+    void setTimeStep(double val);
+    Integrator getIntegrator();
+    void setIntegrator(Integrator val);
+    void invalidateForces();
+    void setThreadCount(int val);
+    Precision getPrecision();
+    void setPrecision(Precision val);
+    double getRestitution();
+    void setRestitution(double val);
+    bool getContinuousCollisions();
+    void setContinuousCollisions(bool val);
+    CollisionMode getCollisionMode();
+    void setCollisionMode(CollisionMode val);
+    double getMergeDensity();
+    void setMergeDensity(double val);
+    Softening getSoftening();
+    void setSoftening(const Softening& val);
+    ForceSolver getForceSolver();
+    void setForceSolver(ForceSolver val);
+    ParticleMeshSolver& getParticleMesh();
+    TreeSolver& getTreeSolver();
+    BoundaryPolicy getBoundaryPolicy();
+    void setBoundaryPolicy(BoundaryPolicy val);
+    SimulationBounds getBounds();
+    void setBounds(const SimulationBounds& val);
+    EscapeTally getEscapeTally();
+    NeighbourList& getNeighbourList();
+    bool getRegularization();
+    // Has no effect while the mesh solver runs without its short-range pass, which does not resolve tight pairs.
+    void setRegularization(bool val);
+    int getRegularizedPairCount();
+    bool enableTelemetry(const QString& name, int slotCount, int maxBodies);
+    void publishTelemetry();
+    quint64 getStepCount();
+    double getSimulationTime();
+    void setDiagnosticsInterval(int val);
+    int getDiagnosticsInterval();
+    DiagnosticsSample measureDiagnostics();
+    SimulationDiagnostics& getDiagnostics();
+    double measureDisorder();
+    void reorderBodies();
+    void setReorderInterval(int val);
+    int getReorderInterval();
+    void setReorderThreshold(double val);
+    double getReorderThreshold();
+    quint64 getReorderCount();
 
 private:
+    SimulationObjectPool pool;
     QList<SimulationObject*> simulationObjects;
+    int destroyedCount;
     MainAppWindow* mainAppWindow;
-    QPoint size;
-    QPoint margin;
     QElapsedTimer prevTime;
     double gforce;
     bool isPaused;
     double simulationSpeed;
     double timeRes;
+    double timeStep;
+    Integrator integrator;
+    bool forcesValid;
+    // The tracers' accelerations match the sources; cleared by edits that keep the bodies' forces valid.
+    bool tracerForcesValid;
+    // The instantiation of the force pass for the current solver, precision and softening kernel.
+    void (SimulationController::*forcePass)();
+    // Specific potential of every body, in the order of simulationObjects; kept between steps only.
+    std::vector<double> potentials;
+    bool potentialsValid;
+    Precision precision;
+    GravityKernel<float, float, float> floatKernel;
+    GravityKernel<double, float, double> mixedKernel;
+    ForceSolver forceSolver;
+    ParticleMeshSolver particleMesh;
+    TreeSolver treeSolver;
+    double restitution;
+    bool continuousCollisions;
+    CollisionMode collisionMode;
+    double mergeDensity;
+    std::vector<int> mergeGroups;
+    std::vector<int> mergeSurvivors;
+    NeighbourList neighbours;
+    Softening softening;
+    bool regularization;
+    TwoBodyRegularizer regularizer;
+    TestParticles testParticles;
+    JobHandle tracerStep;
+    TrajectoryPreview trajectoryPreview;
+    // The bodies as previews see them; dropped whenever a step, edit, addition or removal changes them.
+    std::shared_ptr<const std::vector<PreviewBody>> previewSources;
+    int threadCount;
+    BoundaryPolicy boundaryPolicy;
+    SimulationBounds bounds;
+    EscapeTally escapeTally;
     bool isAdding;
     SimulationObject* editedObject;
+    quint64 stepCount;
+    double simulationTime;
+    TelemetryPublisher telemetry;
+    SimulationDiagnostics diagnostics;
+    int diagnosticsInterval;
+    MortonOrder mortonOrder;
+    QList<SimulationObject*> reorderScratch;
+    int reorderInterval;
+    double reorderThreshold;
+    quint64 reorderCount;
+
+    void setInfoLabel(const QString& text);
+    void tallyEscapes(const std::vector<SimulationObject*>& absorbed);
+    void beginTestParticleStep(double frameTime);
+    void endTestParticleStep(double frameTime);
+    void applyMortonOrder();
+    int findMergeGroup(int i);
+    void patchField(SimulationObject* o, std::pair<double, double> position, double mass, bool patchForces);
+    void selectForcePass();
+    template <SofteningKernel Softened>
+    void computeDirectForces();
+    template <SofteningKernel Softened>
+    void computeFloatForces();
+    template <SofteningKernel Softened>
+    void computeMixedForces();
+    void computeParticleMeshForces();
+    template <SofteningKernel Softened>
+    void computeTreeForces();
+
+    // Copies the bodies into a solver's arrays, runs compute and copies the accelerations back.
+    template <typename Kernel, typename Compute>
+    void computeForcesWith(Kernel& kernel, Compute compute)
+    {
+        PROFILE_SCOPE(ProfilePhase::Gravity);
+        kernel.resize(simulationObjects.size());
+        for (int i = 0; i < simulationObjects.size(); ++i)
+        {
+            std::pair<double, double> position = simulationObjects[i]->getPosition();
+            kernel.x[i] = position.first;
+            kernel.y[i] = position.second;
+            kernel.mass[i] = simulationObjects[i]->getMass();
+        }
+
+        compute();
+
+        for (int i = 0; i < simulationObjects.size(); ++i)
+            simulationObjects[i]->setAcceleration(kernel.ax[i], kernel.ay[i]);
+    }
 };
 
 #endif // SIMULATION_CONTROLLER_H
@@ -2,11 +2,15 @@
 #include <cmath>
 #include <QDebug>
 
+SimulationObject::SimulationObject()
+    : name("?"), position(-1.0, -1.0), velocity(0.0, 0.0), acceleration(0.0, 0.0), radius(0.0), mass(0.0),
+    isHighlighted(false), id(0), isDestroyed(true) {}
+
 SimulationObject::SimulationObject(const QString name, std::pair<double, double> position,
                                    std::pair<double, double> velocity, std::pair<double, double> acceleration,
                                    double radius, double mass)
     : name(name), position(position), velocity(velocity), acceleration(acceleration), radius(radius), mass(mass),
-    isHighlighted(false) {}
+    isHighlighted(false), id(0), isDestroyed(false) {}
 
 void SimulationObject::fall(double frame_time) {
     acceleration = {0, 10};
@@ -18,37 +22,122 @@ void SimulationObject::resetAcceleration() {
     acceleration = {0, 0};
 }
 
-void SimulationObject::collide(SimulationObject& other) {
+// Impulse along the line of centres, weighted by the masses; restitution 1 is perfectly elastic, 0 perfectly
+// plastic. Overlapping bodies are then pushed apart along the same normal, the lighter one further.
+void SimulationObject::collide(SimulationObject& other, double restitution) {
     qInfo() << "Collision between " << name << " and " << other.name << "\n";
-    std::pair<double, double> temp = velocity;
-    velocity = other.velocity;
-    other.velocity = temp;
-}
+    double distX = other.position.first - position.first;
+    double distY = other.position.second - position.second;
+    double dist = std::sqrt(distX * distX + distY * distY);
+    double normalX = dist > 0.0 ? distX / dist : 1.0;
+    double normalY = dist > 0.0 ? distY / dist : 0.0;
 
-void SimulationObject::simulateStep(double frame_time) {
-    velocity = {velocity.first + acceleration.first * frame_time, velocity.second + acceleration.second * frame_time};
-    position = {velocity.first * frame_time + position.first, velocity.second * frame_time + position.second};
-    resetAcceleration();
+    double inverseMass = mass > 0.0 ? 1.0 / mass : 0.0;
+    double otherInverseMass = other.mass > 0.0 ? 1.0 / other.mass : 0.0;
+    double inverseMassSum = inverseMass + otherInverseMass;
+    if (inverseMassSum == 0.0) {
+        return;
+    }
+
+    double approachSpeed = (velocity.first - other.velocity.first) * normalX +
+                           (velocity.second - other.velocity.second) * normalY;
+    if (approachSpeed > 0.0) {
+        double impulse = (1.0 + restitution) * approachSpeed / inverseMassSum;
+        velocity.first -= impulse * inverseMass * normalX;
+        velocity.second -= impulse * inverseMass * normalY;
+        other.velocity.first += impulse * otherInverseMass * normalX;
+        other.velocity.second += impulse * otherInverseMass * normalY;
+    }
+
+    double penetration = radius + other.radius - dist;
+    if (penetration > 0.0) {
+        double shift = penetration / inverseMassSum;
+        position.first -= shift * inverseMass * normalX;
+        position.second -= shift * inverseMass * normalY;
+        other.position.first += shift * otherInverseMass * normalX;
+        other.position.second += shift * otherInverseMass * normalY;
+    }
 }
 
-void SimulationObject::applyGravity(SimulationObject& other, double gforce) {
+// Fraction of a step of length frame_time at which the two circles, moving with their current velocities,
+// first touch: 0 if they already overlap, -1 if they do not meet during the step.
+double SimulationObject::timeOfImpact(SimulationObject& other, double frame_time) {
     double distX = other.position.first - position.first;
     double distY = other.position.second - position.second;
-    double dist = std::sqrt(distX * distX + distY * distY);
+    double sweepX = (other.velocity.first - velocity.first) * frame_time;
+    double sweepY = (other.velocity.second - velocity.second) * frame_time;
+    double reach = radius + other.radius;
 
-    if (dist == 0.0) {
-        return;
+    double gap = distX * distX + distY * distY - reach * reach;
+    if (gap < 0.0) {
+        return 0.0;
     }
 
-    double force = (gforce * mass * other.mass) / (dist * dist);
-    double dirX = distX / dist;
-    double dirY = distY / dist;
+    double closing = distX * sweepX + distY * sweepY;
+    if (closing >= 0.0) {
+        return -1.0;
+    }
+
+    double sweep = sweepX * sweepX + sweepY * sweepY;
+    double discriminant = closing * closing - sweep * gap;
+    if (discriminant < 0.0) {
+        return -1.0;
+    }
+
+    double t = (-closing - std::sqrt(discriminant)) / sweep;
+    return t <= 1.0 ? t : -1.0;
+}
+
+// Takes over the mass of other at the common centre of mass, keeping momentum. The radius follows from density,
+// or, when density is not positive, from the summed volumes of the two bodies.
+void SimulationObject::absorb(SimulationObject& other, double density) {
+    double total = mass + other.mass;
+    if (total > 0.0) {
+        double share = other.mass / total;
+        position.first += (other.position.first - position.first) * share;
+        position.second += (other.position.second - position.second) * share;
+        velocity.first += (other.velocity.first - velocity.first) * share;
+        velocity.second += (other.velocity.second - velocity.second) * share;
+        acceleration.first += (other.acceleration.first - acceleration.first) * share;
+        acceleration.second += (other.acceleration.second - acceleration.second) * share;
+    }
+
+    const double pi = 3.14159265358979323846;
+    if (density > 0.0) {
+        radius = std::cbrt(3.0 * total / (4.0 * pi * density));
+    } else {
+        radius = std::cbrt(radius * radius * radius + other.radius * other.radius * other.radius);
+    }
+    mass = total;
+    isHighlighted = isHighlighted || other.isHighlighted;
+}
+
+void SimulationObject::simulateStep(double frame_time) {
+    velocity = {velocity.first + acceleration.first * frame_time, velocity.second + acceleration.second * frame_time};
+    position = {velocity.first * frame_time + position.first, velocity.second * frame_time + position.second};
+    resetAcceleration();
+}
 
-    acceleration.first += dirX * force / mass;
-    acceleration.second += dirY * force / mass;
+void SimulationObject::kick(double frame_time) {
+    velocity = {velocity.first + acceleration.first * frame_time, velocity.second + acceleration.second * frame_time};
+}
 
-    other.acceleration.first -= dirX * force / other.mass;
-    other.acceleration.second -= dirY * force / other.mass;
+void SimulationObject::drift(double frame_time) {
+    position = {velocity.first * frame_time + position.first, velocity.second * frame_time + position.second};
+}
+
+void SimulationObject::applyGravity(SimulationObject& other, double gforce, const Softening& softening) {
+    switch (softening.kernel) {
+    case SofteningKernel::Plummer:
+        applyGravity<SofteningKernel::Plummer>(other, gforce, softening.length);
+        break;
+    case SofteningKernel::Spline:
+        applyGravity<SofteningKernel::Spline>(other, gforce, softening.length);
+        break;
+    default:
+        applyGravity<SofteningKernel::None>(other, gforce, softening.length);
+        break;
+    }
 }
 
 bool SimulationObject::detectCollision(SimulationObject& other) {
@@ -91,6 +180,12 @@ std::pair<double, double> SimulationObject::getAcceleration(){
     return acceleration;
 }
 
+void SimulationObject::setAcceleration(double x, double y)
+{
+    acceleration.first = x;
+    acceleration.second = y;
+}
+
 std::pair<double, double> SimulationObject::getVelocity(){
     return velocity;
 }
@@ -125,3 +220,23 @@ void SimulationObject::setVelocity(double x, double y)
     velocity.first = x;
     velocity.second = y;
 }
+
+quint64 SimulationObject::getId()
+{
+    return id;
+}
+
+void SimulationObject::setId(quint64 id)
+{
+    this->id = id;
+}
+
+bool SimulationObject::getIsDestroyed()
+{
+    return isDestroyed;
+}
+
+void SimulationObject::setIsDestroyed(bool val)
+{
+    isDestroyed = val;
+}
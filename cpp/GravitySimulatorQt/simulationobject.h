@@ -4,9 +4,11 @@
 #include <cmath>
 #include <string>
 #include <QString>
+#include "softening.h"
 
 class SimulationObject {
 public:
+    SimulationObject();
     SimulationObject(const QString name, std::pair<double, double> position,
                      std::pair<double, double> velocity, std::pair<double, double> acceleration,
                      double radius, double mass);
@@ -14,9 +16,15 @@ public:
 
     void fall(double frame_time);
     void resetAcceleration();
-    void collide(SimulationObject& other);
+    void collide(SimulationObject& other, double restitution);
+    double timeOfImpact(SimulationObject& other, double frame_time);
+    void absorb(SimulationObject& other, double density);
     void simulateStep(double frame_time);
-    void applyGravity(SimulationObject& other, double gforce);
+    void kick(double frame_time);
+    void drift(double frame_time);
+    void applyGravity(SimulationObject& other, double gforce, const Softening& softening);
+    template <SofteningKernel Softened>
+    void applyGravity(SimulationObject& other, double gforce, double softeningLength);
     bool detectCollision(SimulationObject& other);
 
     std::pair<double, double> getPosition();
@@ -27,11 +35,16 @@ public:
     std::pair<double, double> getVelocity();
     void setVelocity(double x, double y);
     std::pair<double, double> getAcceleration();
+    void setAcceleration(double x, double y);
     void setRadius(double r);
     bool getIsHighlighted();
     void setIsHighlighted(bool val);
     void setName(QString name);
     void setMass(double mass);
+    quint64 getId();
+    void setId(quint64 id);
+    bool getIsDestroyed();
+    void setIsDestroyed(bool val);
 
 private:
     QString name;
@@ -41,6 +54,23 @@ private:
     double radius;
     double mass;
     bool isHighlighted;
+    quint64 id;
+    bool isDestroyed;
 };
 
+// Pair update of the direct force pass, inline and with the kernel fixed so the O(N^2) loop has no calls or
+// branches in it.
+template <SofteningKernel Softened>
+inline void SimulationObject::applyGravity(SimulationObject& other, double gforce, double softeningLength)
+{
+    double distX = other.position.first - position.first;
+    double distY = other.position.second - position.second;
+    double scale = gforce * softenedInverseCube<Softened>(distX * distX + distY * distY, softeningLength);
+    acceleration.first += distX * scale * other.mass;
+    acceleration.second += distY * scale * other.mass;
+
+    other.acceleration.first -= distX * scale * mass;
+    other.acceleration.second -= distY * scale * mass;
+}
+
 #endif // SIMULATIONOBJECT_H
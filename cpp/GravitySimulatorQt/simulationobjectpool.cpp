@@ -0,0 +1,90 @@
+#include "simulationobjectpool.h"
+
+SimulationObjectPool::SimulationObjectPool()
+    : nextId(1), liveCount(0) {}
+
+void SimulationObjectPool::addSlab()
+{
+    slabs.emplace_back(new SimulationObject[slabSize]);
+    freeSlots.reserve(slabs.size() * slabSize);
+    SimulationObject* slab = slabs.back().get();
+    // Hand out low addresses first so that bodies created together stay adjacent.
+    for (int i = slabSize - 1; i >= 0; --i)
+        freeSlots.push_back(&slab[i]);
+}
+
+SimulationObject* SimulationObjectPool::acquire(const QString& name, std::pair<double, double> position,
+                                                std::pair<double, double> velocity, double radius, double mass)
+{
+    if (freeSlots.empty())
+        addSlab();
+
+    SimulationObject* o = freeSlots.back();
+    freeSlots.pop_back();
+    *o = SimulationObject(name, position, velocity, std::pair<double, double>(0, 0), radius, mass);
+    o->setId(nextId++);
+    ++liveCount;
+    return o;
+}
+
+void SimulationObjectPool::release(SimulationObject* o)
+{
+    o->setIsDestroyed(true);
+    o->setIsHighlighted(false);
+    freeSlots.push_back(o);
+    --liveCount;
+}
+
+void SimulationObjectPool::clear()
+{
+    freeSlots.clear();
+    for (int s = static_cast<int>(slabs.size()) - 1; s >= 0; --s)
+    {
+        for (int i = slabSize - 1; i >= 0; --i)
+        {
+            slabs[s][i].setIsDestroyed(true);
+            slabs[s][i].setIsHighlighted(false);
+            freeSlots.push_back(&slabs[s][i]);
+        }
+    }
+    liveCount = 0;
+}
+
+SimulationObject* SimulationObjectPool::getSlot(int i)
+{
+    return &slabs[i / slabSize][i % slabSize];
+}
+
+void SimulationObjectPool::rearrange(QList<SimulationObject*>& objects)
+{
+    int n = static_cast<int>(objects.size());
+    staging.resize(n);
+    for (int i = 0; i < n; ++i)
+        staging[i] = *objects[i];
+
+    freeSlots.clear();
+    for (int i = getCapacity() - 1; i >= n; --i)
+    {
+        SimulationObject* slot = getSlot(i);
+        slot->setIsDestroyed(true);
+        slot->setIsHighlighted(false);
+        freeSlots.push_back(slot);
+    }
+
+    for (int i = 0; i < n; ++i)
+    {
+        objects[i] = getSlot(i);
+        *objects[i] = staging[i];
+    }
+    liveCount = n;
+}
+
+int SimulationObjectPool::getCapacity()
+{
+    return static_cast<int>(slabs.size()) * slabSize;
+}
+
+int SimulationObjectPool::getLiveCount()
+{
+    return liveCount;
+}
@@ -0,0 +1,38 @@
+#ifndef SIMULATION_OBJECT_POOL_H
+#define SIMULATION_OBJECT_POOL_H
+
+#include <memory>
+#include <vector>
+#include <QList>
+#include "simulationobject.h"
+
+// Owns every SimulationObject in fixed-size slabs. Released slots stay valid (marked destroyed) and are reused
+// by later acquisitions, so addresses are stable and the stepping loop never touches the heap.
+// Every acquisition gets a new id, which tells a reused slot apart from the object that lived there before.
+class SimulationObjectPool {
+public:
+    static const int slabSize = 1024;
+
+    SimulationObjectPool();
+    SimulationObject* acquire(const QString& name, std::pair<double, double> position,
+                              std::pair<double, double> velocity, double radius, double mass);
+    void release(SimulationObject* o);
+    void clear();
+    // Moves every live object, in list order, into the lowest slots and points the list at the new slots.
+    // Ids travel with the objects; pointers held elsewhere have to be looked up again by id.
+    void rearrange(QList<SimulationObject*>& objects);
+    int getCapacity();
+    int getLiveCount();
+
+private:
+    std::vector<std::unique_ptr<SimulationObject[]>> slabs;
+    std::vector<SimulationObject*> freeSlots;
+    quint64 nextId;
+    int liveCount;
+    std::vector<SimulationObject> staging;
+
+    void addSlab();
+    SimulationObject* getSlot(int i);
+};
+
+#endif // SIMULATION_OBJECT_POOL_H
@@ -6,7 +6,7 @@
 #include "simulationobjecttile.h"
 
 SimulationObjectTile::SimulationObjectTile(SimulationObject* simulation_object, SimulationController* simulation_controller, QWidget* wrapper)
-    : o(simulation_object), controller(simulation_controller), wrapper(wrapper) {
+    : o(simulation_object), id(simulation_object->getId()), controller(simulation_controller), wrapper(wrapper) {
     setFixedWidth(380);
     setFixedHeight(50);
 
@@ -57,16 +57,18 @@ SimulationObjectTile::SimulationObjectTile(SimulationObject* simulation_object,
 }
 
 void SimulationObjectTile::update() {
+    // The pool may already have handed this slot to another object.
+    if (o->getIsDestroyed() || o->getId() != id) {
+        remove();
+        return;
+    }
+
     button_name->setText(o->getName());
     mass_val->setText(QString::number(o->getMass()));
     position_val->setText(QString("%1; %2").arg(o->getPosition().first).arg(o->getPosition().second));
     speed_val->setText(QString("%1; %2").arg(o->getVelocity().first).arg(o->getVelocity().second));
     radius_val->setText(QString::number(o->getRadius()));
     acc_val->setText(QString("%1; %2").arg(o->getAcceleration().first).arg(o->getAcceleration().second));
-
-    if (!controller->getSimulationObjects().contains(o)) {
-        remove();
-    }
 }
 
 void SimulationObjectTile::mousePressEvent(QMouseEvent* event) {
@@ -78,10 +80,23 @@ void SimulationObjectTile::mousePressEvent(QMouseEvent* event) {
 
 void SimulationObjectTile::remove() {
     controller->getMainAppWindow()->getObjectTiles().removeOne(this);
-    if (controller->getSimulationObjects().contains(o)) {
-        controller->getSimulationObjects().removeOne(o);
+    if (o->getId() == id) {
+        controller->removeSimulationObject(o);
     }
-    deleteLater();
+    detach();
+}
+
+// Takes the tile off the object panel without touching the simulation.
+void SimulationObjectTile::detach() {
     controller->getMainAppWindow()->getSimulationObjectLayout()->removeWidget(wrapper);
+    wrapper->deleteLater();
+}
+
+
+quint64 SimulationObjectTile::getId() {
+    return id;
 }
 
+void SimulationObjectTile::setSimulationObject(SimulationObject* simulation_object) {
+    o = simulation_object;
+}
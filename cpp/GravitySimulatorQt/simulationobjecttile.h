@@ -21,9 +21,13 @@ public:
     void update();
     void mousePressEvent(QMouseEvent* event) override;
     void remove();
+    void detach();
+    quint64 getId();
+    void setSimulationObject(SimulationObject* simulation_object);
 
 private:
     SimulationObject* o;
+    quint64 id;
     SimulationController* controller;
     QWidget* wrapper;
     QVBoxLayout* tile_layout;
@@ -0,0 +1,84 @@
+#ifndef SOFTENING_H
+#define SOFTENING_H
+
+#include <cmath>
+
+enum class SofteningKernel { None, Plummer, Spline };
+
+// Shape of the pairwise force at short range. For Plummer, length is the scale epsilon; for the cubic spline it is
+// the radius beyond which the force is exactly Newtonian (h = 2.8 epsilon in Gadget's convention).
+struct Softening {
+    SofteningKernel kernel;
+    double length;
+};
+
+// Factor such that the acceleration towards a mass m at separation d is G * m * d * factor, i.e. 1 / r^3 for the
+// unsoftened force, for a kernel fixed at compile time: loops over pairs instantiate this and carry no branch on
+// the kernel. Coincident bodies get 0 without softening, like the old dist == 0 guard, as a select rather than
+// a jump; Plummer needs no guard.
+template <SofteningKernel Kernel, typename T>
+inline T softenedInverseCube(T dist2, T length)
+{
+    if constexpr (Kernel == SofteningKernel::Plummer)
+    {
+        const T invDist = T(1) / std::sqrt(dist2 + length * length);
+        return invDist * invDist * invDist;
+    }
+    else if constexpr (Kernel == SofteningKernel::Spline)
+    {
+        if (dist2 == T(0))
+            return T(0);
+
+        const T invDist = T(1) / std::sqrt(dist2);
+        if (dist2 < length * length)
+        {
+            const T invLength = T(1) / length;
+            const T u = T(1) / (invDist * length);
+            const T invLength3 = invLength * invLength * invLength;
+            if (u < T(0.5))
+                return invLength3 * (T(10.666666666667) + u * u * (T(32) * u - T(38.4)));
+            return invLength3 * (T(21.333333333333) - T(48) * u + T(38.4) * u * u - T(10.666666666667) * u * u * u -
+                                 T(0.066666666667) / (u * u * u));
+        }
+        return invDist * invDist * invDist;
+    }
+    else
+    {
+        const T invDist = dist2 > T(0) ? T(1) / std::sqrt(dist2) : T(0);
+        return invDist * invDist * invDist;
+    }
+}
+
+// The same with the kernel chosen at run time, for code outside the per-pair loops.
+template <typename T>
+inline T softenedInverseCube(T dist2, SofteningKernel kernel, T length)
+{
+    switch (kernel)
+    {
+    case SofteningKernel::Plummer:
+        return softenedInverseCube<SofteningKernel::Plummer>(dist2, length);
+    case SofteningKernel::Spline:
+        return softenedInverseCube<SofteningKernel::Spline>(dist2, length);
+    default:
+        return softenedInverseCube<SofteningKernel::None>(dist2, length);
+    }
+}
+
+// Potential of a unit mass at distance dist with G = 1, the counterpart of softenedInverseCube: -1 / r unsoftened.
+inline double softenedPotential(double dist, SofteningKernel kernel, double length)
+{
+    if (kernel == SofteningKernel::Plummer)
+        return -1.0 / std::sqrt(dist * dist + length * length);
+
+    if (kernel == SofteningKernel::Spline && dist < length)
+    {
+        const double u = dist / length;
+        if (u < 0.5)
+            return (-2.8 + u * u * (5.333333333333 + u * u * (6.4 * u - 9.6))) / length;
+        return (-3.2 + 0.066666666667 / u + u * u * (10.666666666667 + u * (-16.0 + u * (9.6 - 2.133333333333 * u)))) /
+               length;
+    }
+    return dist > 0.0 ? -1.0 / dist : 0.0;
+}
+
+#endif // SOFTENING_H
@@ -0,0 +1,72 @@
+#ifndef TELEMETRY_H
+#define TELEMETRY_H
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+
+// Layout of the shared-memory telemetry region. Shared between the simulator and external readers,
+// so it must stay plain data with fixed-size fields.
+//
+// [TelemetryHeader][slot 0][slot 1]...[slot slotCount - 1]
+// slot = [TelemetrySlot][TelemetryBody x maxBodies], padded to slotStride bytes.
+
+const uint32_t TELEMETRY_MAGIC = 0x47534d54; // "GSMT"
+const uint32_t TELEMETRY_VERSION = 1;
+
+struct TelemetryHeader {
+    uint32_t magic;
+    uint32_t version;
+    uint32_t slotCount;
+    uint32_t maxBodies;
+    uint64_t headerSize;
+    uint64_t slotStride;
+    std::atomic<uint64_t> framesPublished;
+};
+
+struct TelemetrySlot {
+    // Seqlock: odd while the simulator is writing the slot, even when the slot is consistent.
+    std::atomic<uint64_t> sequence;
+    uint64_t frame;
+    uint64_t step;
+    double simulationTime;
+    uint32_t bodyCount;
+    uint32_t reserved;
+};
+
+struct TelemetryBody {
+    double x;
+    double y;
+    double vx;
+    double vy;
+};
+
+static_assert(std::atomic<uint64_t>::is_always_lock_free, "telemetry needs lock-free 64-bit atomics");
+
+inline size_t telemetryAlign(size_t size)
+{
+    return (size + 63) & ~static_cast<size_t>(63);
+}
+
+inline size_t telemetrySlotStride(uint32_t maxBodies)
+{
+    return telemetryAlign(sizeof(TelemetrySlot) + sizeof(TelemetryBody) * maxBodies);
+}
+
+inline size_t telemetryRegionSize(uint32_t slotCount, uint32_t maxBodies)
+{
+    return telemetryAlign(sizeof(TelemetryHeader)) + telemetrySlotStride(maxBodies) * slotCount;
+}
+
+inline TelemetrySlot* telemetrySlot(TelemetryHeader* header, uint64_t frame)
+{
+    char* base = reinterpret_cast<char*>(header) + header->headerSize;
+    return reinterpret_cast<TelemetrySlot*>(base + (frame % header->slotCount) * header->slotStride);
+}
+
+inline TelemetryBody* telemetryBodies(TelemetrySlot* slot)
+{
+    return reinterpret_cast<TelemetryBody*>(slot + 1);
+}
+
+#endif // TELEMETRY_H
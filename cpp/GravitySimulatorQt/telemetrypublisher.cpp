@@ -0,0 +1,121 @@
+#include "telemetrypublisher.h"
+#include <algorithm>
+#include <cstring>
+
+#ifdef __unix__
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <unistd.h>
+#endif
+
+TelemetryPublisher::TelemetryPublisher()
+    : header(nullptr), regionSize(0) {}
+
+TelemetryPublisher::~TelemetryPublisher()
+{
+    close();
+}
+
+bool TelemetryPublisher::open(const std::string& name, uint32_t slotCount, uint32_t maxBodies)
+{
+    close();
+
+#ifdef __unix__
+    if (slotCount == 0 || maxBodies == 0)
+        return false;
+
+    size_t size = telemetryRegionSize(slotCount, maxBodies);
+    int fd = shm_open(name.c_str(), O_CREAT | O_RDWR, 0644);
+    if (fd < 0)
+        return false;
+
+    if (ftruncate(fd, static_cast<off_t>(size)) != 0)
+    {
+        ::close(fd);
+        shm_unlink(name.c_str());
+        return false;
+    }
+
+    void* region = mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    ::close(fd);
+    if (region == MAP_FAILED)
+    {
+        shm_unlink(name.c_str());
+        return false;
+    }
+
+    std::memset(region, 0, size);
+    header = static_cast<TelemetryHeader*>(region);
+    header->version = TELEMETRY_VERSION;
+    header->slotCount = slotCount;
+    header->maxBodies = maxBodies;
+    header->headerSize = telemetryAlign(sizeof(TelemetryHeader));
+    header->slotStride = telemetrySlotStride(maxBodies);
+    header->framesPublished.store(0, std::memory_order_relaxed);
+    // Readers check the magic last, so a half-initialised header is never accepted.
+    std::atomic_thread_fence(std::memory_order_release);
+    header->magic = TELEMETRY_MAGIC;
+
+    this->name = name;
+    regionSize = size;
+    staging.reserve(maxBodies);
+    return true;
+#else
+    (void)name;
+    (void)slotCount;
+    (void)maxBodies;
+    return false;
+#endif
+}
+
+void TelemetryPublisher::close()
+{
+#ifdef __unix__
+    if (header)
+    {
+        munmap(header, regionSize);
+        shm_unlink(name.c_str());
+    }
+#endif
+    header = nullptr;
+    regionSize = 0;
+    name.clear();
+}
+
+bool TelemetryPublisher::isOpen()
+{
+    return header != nullptr;
+}
+
+uint32_t TelemetryPublisher::getMaxBodies()
+{
+    return header ? header->maxBodies : 0;
+}
+
+std::vector<TelemetryBody>& TelemetryPublisher::getStaging()
+{
+    return staging;
+}
+
+void TelemetryPublisher::publish(uint64_t step, double simulationTime)
+{
+    if (!header)
+        return;
+
+    uint64_t frame = header->framesPublished.load(std::memory_order_relaxed);
+    TelemetrySlot* slot = telemetrySlot(header, frame);
+    uint32_t bodyCount = static_cast<uint32_t>(std::min<size_t>(staging.size(), header->maxBodies));
+
+    uint64_t sequence = slot->sequence.load(std::memory_order_relaxed);
+    slot->sequence.store(sequence + 1, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+
+    slot->frame = frame;
+    slot->step = step;
+    slot->simulationTime = simulationTime;
+    slot->bodyCount = bodyCount;
+    std::memcpy(telemetryBodies(slot), staging.data(), sizeof(TelemetryBody) * bodyCount);
+
+    slot->sequence.store(sequence + 2, std::memory_order_release);
+    header->framesPublished.store(frame + 1, std::memory_order_release);
+}
@@ -0,0 +1,29 @@
+#ifndef TELEMETRY_PUBLISHER_H
+#define TELEMETRY_PUBLISHER_H
+
+#include <string>
+#include <vector>
+#include "telemetry.h"
+
+class TelemetryPublisher {
+public:
+    TelemetryPublisher();
+    ~TelemetryPublisher();
+
+    bool open(const std::string& name, uint32_t slotCount, uint32_t maxBodies);
+    void close();
+    bool isOpen();
+    uint32_t getMaxBodies();
+
+    // Bodies are staged here by the caller, then copied into the ring with a single memcpy.
+    std::vector<TelemetryBody>& getStaging();
+    void publish(uint64_t step, double simulationTime);
+
+private:
+    std::string name;
+    TelemetryHeader* header;
+    size_t regionSize;
+    std::vector<TelemetryBody> staging;
+};
+
+#endif // TELEMETRY_PUBLISHER_H
@@ -0,0 +1,216 @@
+#include "testparticles.h"
+#include <algorithm>
+#include <cmath>
+#include <thread>
+#include "parallelfor.h"
+
+// Tracers per inner loop: small enough that the block's arrays stay in L1 while every source is applied.
+static const size_t blockSize = 512;
+static const size_t minPerWorker = 16384;
+
+TestParticles::TestParticles()
+    : threadCount(std::max(1u, std::thread::hardware_concurrency())) {}
+
+void TestParticles::add(double x, double y, double vx, double vy)
+{
+    this->x.push_back(x);
+    this->y.push_back(y);
+    this->vx.push_back(vx);
+    this->vy.push_back(vy);
+    ax.push_back(0.0);
+    ay.push_back(0.0);
+}
+
+void TestParticles::clear()
+{
+    x.clear();
+    y.clear();
+    vx.clear();
+    vy.clear();
+    ax.clear();
+    ay.clear();
+}
+
+int TestParticles::getCount()
+{
+    return static_cast<int>(x.size());
+}
+
+const std::vector<double>& TestParticles::getX()
+{
+    return x;
+}
+
+const std::vector<double>& TestParticles::getY()
+{
+    return y;
+}
+
+const std::vector<double>& TestParticles::getVelocityX()
+{
+    return vx;
+}
+
+const std::vector<double>& TestParticles::getVelocityY()
+{
+    return vy;
+}
+
+void TestParticles::setSources(const QList<SimulationObject*>& objects)
+{
+    sourceX.clear();
+    sourceY.clear();
+    sourceMass.clear();
+    sourceRadius.clear();
+    for (SimulationObject* o : objects)
+    {
+        if (o->getIsDestroyed())
+            continue;
+        sourceX.push_back(o->getPosition().first);
+        sourceY.push_back(o->getPosition().second);
+        sourceMass.push_back(o->getMass());
+        sourceRadius.push_back(o->getRadius());
+    }
+}
+
+void TestParticles::computeAccelerations(double gforce, const Softening& softening)
+{
+    parallelFor(x.size(), threadCount, minPerWorker, [&](size_t, size_t begin, size_t end) {
+        accelerateRange(begin, end, gforce, softening);
+    });
+}
+
+void TestParticles::computeAcceleration(size_t index, double gforce, const Softening& softening)
+{
+    accelerateRange(index, index + 1, gforce, softening);
+}
+
+// Plummer and unsoftened forces share one branch-free loop (epsilon = 0 without softening) that the compiler can
+// vectorise; the piecewise spline goes through softenedInverseCube.
+void TestParticles::accelerateRange(size_t begin, size_t end, double gforce, const Softening& softening)
+{
+    size_t sources = sourceX.size();
+    bool spline = softening.kernel == SofteningKernel::Spline;
+    double epsilon2 = softening.kernel == SofteningKernel::Plummer ? softening.length * softening.length : 0.0;
+    double* px = x.data();
+    double* py = y.data();
+    double* pax = ax.data();
+    double* pay = ay.data();
+    for (size_t block = begin; block < end; block += blockSize)
+    {
+        size_t blockEnd = std::min(end, block + blockSize);
+        std::fill(pax + block, pax + blockEnd, 0.0);
+        std::fill(pay + block, pay + blockEnd, 0.0);
+        for (size_t s = 0; s < sources; ++s)
+        {
+            double sx = sourceX[s];
+            double sy = sourceY[s];
+            double gm = gforce * sourceMass[s];
+            if (spline)
+            {
+                for (size_t i = block; i < blockEnd; ++i)
+                {
+                    double dx = sx - px[i];
+                    double dy = sy - py[i];
+                    double factor = gm * softenedInverseCube<SofteningKernel::Spline>(dx * dx + dy * dy, softening.length);
+                    pax[i] += dx * factor;
+                    pay[i] += dy * factor;
+                }
+                continue;
+            }
+
+            for (size_t i = block; i < blockEnd; ++i)
+            {
+                double dx = sx - px[i];
+                double dy = sy - py[i];
+                double dist2 = dx * dx + dy * dy + epsilon2;
+                double invDist = dist2 > 0.0 ? 1.0 / std::sqrt(dist2) : 0.0;
+                double factor = gm * invDist * invDist * invDist;
+                pax[i] += dx * factor;
+                pay[i] += dy * factor;
+            }
+        }
+    }
+}
+
+void TestParticles::kick(double frameTime)
+{
+    parallelFor(x.size(), threadCount, minPerWorker, [&](size_t, size_t begin, size_t end) {
+        for (size_t i = begin; i < end; ++i)
+        {
+            vx[i] += ax[i] * frameTime;
+            vy[i] += ay[i] * frameTime;
+        }
+    });
+}
+
+void TestParticles::drift(double frameTime)
+{
+    parallelFor(x.size(), threadCount, minPerWorker, [&](size_t, size_t begin, size_t end) {
+        for (size_t i = begin; i < end; ++i)
+        {
+            x[i] += vx[i] * frameTime;
+            y[i] += vy[i] * frameTime;
+        }
+    });
+}
+
+// Tracers are tested in parallel, then compacted in a single in-place pass that keeps the order of the survivors.
+int TestParticles::applyBoundaries(BoundaryPolicy policy, const SimulationBounds& bounds)
+{
+    lost.resize(x.size());
+    parallelFor(x.size(), threadCount, minPerWorker, [&](size_t, size_t begin, size_t end) {
+        for (size_t i = begin; i < end; ++i)
+        {
+            bool outside = x[i] < bounds.left || x[i] > bounds.right || y[i] < bounds.top || y[i] > bounds.bottom;
+            if (outside && policy == BoundaryPolicy::Reflect)
+            {
+                reflectInto(x[i], vx[i], bounds.left, bounds.right);
+                reflectInto(y[i], vy[i], bounds.top, bounds.bottom);
+                outside = false;
+            }
+            else if (outside && policy == BoundaryPolicy::Periodic)
+            {
+                wrapInto(x[i], bounds.left, bounds.right);
+                wrapInto(y[i], bounds.top, bounds.bottom);
+                outside = false;
+            }
+            for (size_t s = 0; s < sourceX.size() && !outside; ++s)
+            {
+                double dx = sourceX[s] - x[i];
+                double dy = sourceY[s] - y[i];
+                outside = dx * dx + dy * dy < sourceRadius[s] * sourceRadius[s];
+            }
+            lost[i] = outside;
+        }
+    });
+
+    size_t kept = 0;
+    for (size_t i = 0; i < x.size(); ++i)
+    {
+        if (lost[i])
+            continue;
+
+        x[kept] = x[i];
+        y[kept] = y[i];
+        vx[kept] = vx[i];
+        vy[kept] = vy[i];
+        ax[kept] = ax[i];
+        ay[kept] = ay[i];
+        ++kept;
+    }
+
+    int removed = static_cast<int>(x.size() - kept);
+    x.resize(kept);
+    y.resize(kept);
+    vx.resize(kept);
+    vy.resize(kept);
+    ax.resize(kept);
+    ay.resize(kept);
+    return removed;
+}
+
+void TestParticles::setThreadCount(int val)
+{
+    threadCount = std::max(1, val);
+}
@@ -0,0 +1,53 @@
+#ifndef TEST_PARTICLES_H
+#define TEST_PARTICLES_H
+
+#include <vector>
+#include <QList>
+#include "boundary.h"
+#include "simulationobject.h"
+#include "softening.h"
+
+// Massless tracers (debris, dust, ring particles). They are pulled by the massive bodies but pull nothing, so
+// a step costs O(N M) for N tracers and M sources instead of O((N + M)^2). State is kept in flat arrays and the
+// force loop runs over a block of tracers per source, which vectorises; blocks are shared out between threads,
+// each writing only its own range.
+class TestParticles {
+public:
+    TestParticles();
+    void add(double x, double y, double vx, double vy);
+    void clear();
+    int getCount();
+    const std::vector<double>& getX();
+    const std::vector<double>& getY();
+    const std::vector<double>& getVelocityX();
+    const std::vector<double>& getVelocityY();
+
+    // Positions, masses and radii of the massive bodies the next computeAccelerations() and applyBoundaries() use.
+    void setSources(const QList<SimulationObject*>& objects);
+    void computeAccelerations(double gforce, const Softening& softening);
+    void computeAcceleration(size_t index, double gforce, const Softening& softening);
+    void kick(double frameTime);
+    void drift(double frameTime);
+    // Applies the boundary policy (absorbing walls only count massless tracers) and drops tracers that fell into
+    // a source; returns how many were dropped.
+    int applyBoundaries(BoundaryPolicy policy, const SimulationBounds& bounds);
+    void setThreadCount(int val);
+
+private:
+    std::vector<double> x;
+    std::vector<double> y;
+    std::vector<double> vx;
+    std::vector<double> vy;
+    std::vector<double> ax;
+    std::vector<double> ay;
+    std::vector<double> sourceX;
+    std::vector<double> sourceY;
+    std::vector<double> sourceMass;
+    std::vector<double> sourceRadius;
+    std::vector<unsigned char> lost;
+    int threadCount;
+
+    void accelerateRange(size_t begin, size_t end, double gforce, const Softening& softening);
+};
+
+#endif // TEST_PARTICLES_H
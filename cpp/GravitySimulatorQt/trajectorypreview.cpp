@@ -0,0 +1,233 @@
+#include "trajectorypreview.h"
+#include <algorithm>
+#include <cmath>
+
+// Whole-system predictions step this many times coarser than the simulation.
+static const int coarseFactor = 4;
+static const int maxSteps = 20000;
+// Enough points for a smooth curve; longer predictions keep every n-th step.
+static const int maxPoints = 2000;
+static const int publishInterval = 64;
+
+TrajectoryPreview::TrajectoryPreview()
+    : generation(0), pending(), hasPending(false), quit(false), active(false), complete(false), replacing(false),
+      horizon(20.0), moveSources(false), maxSources(128) {}
+
+TrajectoryPreview::~TrajectoryPreview()
+{
+    {
+        std::lock_guard<std::mutex> guard(lock);
+        quit = true;
+        ++generation;
+    }
+    wake.notify_one();
+    if (worker.joinable())
+        worker.join();
+}
+
+// The thread starts with the first request, so tools that never preview never get one. The old path stays
+// until the new one's first points arrive, which keeps periodic refreshes from flickering.
+void TrajectoryPreview::request(PreviewRequest&& val)
+{
+    {
+        std::lock_guard<std::mutex> guard(lock);
+        pending = std::move(val);
+        hasPending = true;
+        active = true;
+        complete = false;
+        replacing = true;
+        ++generation;
+        if (!worker.joinable())
+            worker = std::thread(&TrajectoryPreview::run, this);
+    }
+    wake.notify_one();
+}
+
+void TrajectoryPreview::cancel()
+{
+    std::lock_guard<std::mutex> guard(lock);
+    hasPending = false;
+    active = false;
+    complete = false;
+    replacing = false;
+    path.clear();
+    ++generation;
+}
+
+bool TrajectoryPreview::getPath(std::vector<std::pair<double, double>>& result)
+{
+    std::lock_guard<std::mutex> guard(lock);
+    result = path;
+    return active;
+}
+
+bool TrajectoryPreview::getIsComplete()
+{
+    std::lock_guard<std::mutex> guard(lock);
+    return complete;
+}
+
+void TrajectoryPreview::run()
+{
+    for (;;)
+    {
+        PreviewRequest job;
+        uint64_t jobGeneration;
+        {
+            std::unique_lock<std::mutex> guard(lock);
+            wake.wait(guard, [this] { return quit || hasPending; });
+            if (quit)
+                return;
+            job = std::move(pending);
+            hasPending = false;
+            jobGeneration = generation;
+        }
+        predict(job, jobGeneration);
+    }
+}
+
+// Appends the points to the shared path unless a newer request replaced this one meanwhile.
+bool TrajectoryPreview::publish(std::vector<std::pair<double, double>>& points, uint64_t jobGeneration, bool last)
+{
+    std::lock_guard<std::mutex> guard(lock);
+    if (generation != jobGeneration)
+        return false;
+    if (replacing)
+    {
+        path.clear();
+        replacing = false;
+    }
+    path.insert(path.end(), points.begin(), points.end());
+    points.clear();
+    complete = last;
+    return true;
+}
+
+// Kick-drift-kick leapfrog like the simulation's, with the predicted body first in the arrays. Without moving
+// sources only its acceleration is computed, at O(M) a step; with them all bodies pull each other, O(M^2).
+void TrajectoryPreview::predict(PreviewRequest& job, uint64_t jobGeneration)
+{
+    bool moving = moveSources;
+    std::vector<PreviewBody> sources;
+    sources.reserve(job.sources->size());
+    for (const PreviewBody& b : *job.sources)
+    {
+        if (b.id != job.exclude)
+            sources.push_back(b);
+    }
+    size_t limit = static_cast<size_t>(std::max(1, maxSources.load()));
+    if (sources.size() > limit)
+    {
+        std::nth_element(sources.begin(), sources.begin() + limit, sources.end(),
+                         [](const PreviewBody& a, const PreviewBody& b) { return a.mass > b.mass; });
+        sources.resize(limit);
+    }
+
+    std::vector<PreviewBody> bodies;
+    bodies.reserve(sources.size() + 1);
+    bodies.push_back(job.body);
+    bodies.insert(bodies.end(), sources.begin(), sources.end());
+    size_t n = bodies.size();
+    size_t integrated = moving ? n : 1;
+    std::vector<double> ax(n, 0.0), ay(n, 0.0);
+
+    auto accelerate = [&] {
+        for (size_t i = 0; i < integrated; ++i)
+        {
+            double sumX = 0.0, sumY = 0.0;
+            for (size_t j = 0; j < n; ++j)
+            {
+                if (j == i)
+                    continue;
+                double dx = bodies[j].x - bodies[i].x;
+                double dy = bodies[j].y - bodies[i].y;
+                double factor = job.gforce * bodies[j].mass *
+                                softenedInverseCube(dx * dx + dy * dy, job.softening.kernel, job.softening.length);
+                sumX += dx * factor;
+                sumY += dy * factor;
+            }
+            ax[i] = sumX;
+            ay[i] = sumY;
+        }
+    };
+    auto kick = [&](double dt) {
+        for (size_t i = 0; i < integrated; ++i)
+        {
+            bodies[i].vx += ax[i] * dt;
+            bodies[i].vy += ay[i] * dt;
+        }
+    };
+    auto hit = [&] {
+        for (size_t j = 1; j < n; ++j)
+        {
+            double dx = bodies[j].x - bodies[0].x;
+            double dy = bodies[j].y - bodies[0].y;
+            double reach = bodies[0].radius + bodies[j].radius;
+            if (dx * dx + dy * dy < reach * reach)
+                return true;
+        }
+        return false;
+    };
+
+    double dt = job.timeStep * (moving ? coarseFactor : 1);
+    int steps = static_cast<int>(std::min<double>(maxSteps, std::ceil(horizon / dt)));
+    int stride = std::max(1, steps / maxPoints);
+    std::vector<std::pair<double, double>> points{{bodies[0].x, bodies[0].y}};
+    accelerate();
+    for (int step = 1; step <= steps; ++step)
+    {
+        if (generation != jobGeneration)
+            return;
+
+        kick(0.5 * dt);
+        for (size_t i = 0; i < integrated; ++i)
+        {
+            bodies[i].x += bodies[i].vx * dt;
+            bodies[i].y += bodies[i].vy * dt;
+        }
+        bool collided = hit();
+        if (!collided)
+        {
+            accelerate();
+            kick(0.5 * dt);
+        }
+
+        if (step % stride == 0 || collided || step == steps)
+            points.emplace_back(bodies[0].x, bodies[0].y);
+        if (collided)
+            break;
+        if (step % publishInterval == 0 && !publish(points, jobGeneration, false))
+            return;
+    }
+    publish(points, jobGeneration, true);
+}
+
+void TrajectoryPreview::setHorizon(double val)
+{
+    horizon = val;
+}
+
+double TrajectoryPreview::getHorizon()
+{
+    return horizon;
+}
+
+void TrajectoryPreview::setMoveSources(bool val)
+{
+    moveSources = val;
+}
+
+bool TrajectoryPreview::getMoveSources()
+{
+    return moveSources;
+}
+
+void TrajectoryPreview::setMaxSources(int val)
+{
+    maxSources = val;
+}
+
+int TrajectoryPreview::getMaxSources()
+{
+    return maxSources;
+}
@@ -0,0 +1,80 @@
+#ifndef TRAJECTORY_PREVIEW_H
+#define TRAJECTORY_PREVIEW_H
+
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <utility>
+#include <vector>
+#include "softening.h"
+
+struct PreviewBody {
+    double x;
+    double y;
+    double vx;
+    double vy;
+    double mass;
+    double radius;
+    // The simulation body's id; 0 for the body being predicted.
+    uint64_t id;
+};
+
+// The state a prediction starts from: the body being placed or edited and a snapshot of all bodies, shared
+// between requests, from which the one with id exclude (the body being edited, or 0 for none) is left out.
+struct PreviewRequest {
+    PreviewBody body;
+    std::shared_ptr<const std::vector<PreviewBody>> sources;
+    uint64_t exclude;
+    double gforce;
+    Softening softening;
+    double timeStep;
+};
+
+// Predicts the path of a body being placed or edited on a thread of its own; the caller only hands over a shared
+// snapshot of the bodies, and the copying and filtering happen on that thread. By default the other bodies stay where
+// they are; with moveSources they move too, at a coarser step and with only the heaviest maxSources of them, which
+// keeps a prediction's cost independent of how many bodies the simulation has. A new request or cancel() stops the
+// running prediction at its next step. Points are published in chunks as they are computed, so the path grows on screen
+// while it is predicted; it ends early where the body would hit another one.
+class TrajectoryPreview {
+public:
+    TrajectoryPreview();
+    ~TrajectoryPreview();
+
+    void request(PreviewRequest&& val);
+    void cancel();
+    // The points so far; false when there is no prediction to show.
+    bool getPath(std::vector<std::pair<double, double>>& result);
+    bool getIsComplete();
+    void setHorizon(double val);
+    double getHorizon();
+    void setMoveSources(bool val);
+    bool getMoveSources();
+    void setMaxSources(int val);
+    int getMaxSources();
+
+private:
+    std::thread worker;
+    std::mutex lock;
+    std::condition_variable wake;
+    std::atomic<uint64_t> generation;
+    PreviewRequest pending;
+    bool hasPending;
+    bool quit;
+    bool active;
+    bool complete;
+    bool replacing;
+    std::vector<std::pair<double, double>> path;
+    std::atomic<double> horizon;
+    std::atomic<bool> moveSources;
+    std::atomic<int> maxSources;
+
+    void run();
+    void predict(PreviewRequest& job, uint64_t jobGeneration);
+    bool publish(std::vector<std::pair<double, double>>& points, uint64_t jobGeneration, bool last);
+};
+
+#endif // TRAJECTORY_PREVIEW_H
@@ -0,0 +1,257 @@
+#include "transport.h"
+#include <chrono>
+#include <thread>
+
+#ifdef __unix__
+#include <cerrno>
+#include <fcntl.h>
+#include <poll.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+#endif
+
+#ifdef __unix__
+static bool socketAddress(const std::string& directory, int rank, sockaddr_un& address, std::string& path)
+{
+    path = directory + "/rank-" + std::to_string(rank) + ".sock";
+    if (path.size() >= sizeof(address.sun_path))
+        return false;
+    std::memset(&address, 0, sizeof(address));
+    address.sun_family = AF_UNIX;
+    std::memcpy(address.sun_path, path.c_str(), path.size() + 1);
+    return true;
+}
+
+// Handshakes are four bytes, so a blocking loop is enough for them.
+static bool transferAll(int fd, char* data, size_t size, bool sending)
+{
+    while (size > 0)
+    {
+        ssize_t count = sending ? ::send(fd, data, size, MSG_NOSIGNAL) : ::recv(fd, data, size, 0);
+        if (count < 0 && errno == EINTR)
+            continue;
+        if (count <= 0)
+            return false;
+        data += count;
+        size -= static_cast<size_t>(count);
+    }
+    return true;
+}
+#endif
+
+bool allGather(Transport& transport, const std::vector<char>& message, std::vector<std::vector<char>>& messages)
+{
+    std::vector<std::vector<char>> outgoing(transport.getSize(), message);
+    if (!transport.exchange(outgoing, messages))
+        return false;
+    messages[transport.getRank()] = message;
+    return true;
+}
+
+UnixSocketTransport::UnixSocketTransport()
+    : rank(0), size(1), listener(-1) {}
+
+UnixSocketTransport::~UnixSocketTransport()
+{
+    close();
+}
+
+bool UnixSocketTransport::connect(const std::string& directory, int rank, int size, int timeoutMs)
+{
+    close();
+
+#ifdef __unix__
+    if (size < 1 || rank < 0 || rank >= size)
+        return false;
+
+    this->rank = rank;
+    this->size = size;
+    peers.assign(size, -1);
+
+    sockaddr_un address;
+    if (!socketAddress(directory, rank, address, listenerPath))
+        return false;
+    listener = ::socket(AF_UNIX, SOCK_STREAM, 0);
+    ::unlink(listenerPath.c_str());
+    if (listener < 0 || ::bind(listener, reinterpret_cast<sockaddr*>(&address), sizeof(address)) != 0 ||
+        ::listen(listener, size) != 0)
+    {
+        close();
+        return false;
+    }
+
+    // Lower ranks may not be listening yet, so connecting is retried until the deadline.
+    auto deadline = std::chrono::steady_clock::now() + std::chrono::milliseconds(timeoutMs);
+    for (int r = 0; r < rank; ++r)
+    {
+        std::string path;
+        if (!socketAddress(directory, r, address, path))
+        {
+            close();
+            return false;
+        }
+        for (;;)
+        {
+            int fd = ::socket(AF_UNIX, SOCK_STREAM, 0);
+            if (fd >= 0 && ::connect(fd, reinterpret_cast<sockaddr*>(&address), sizeof(address)) == 0)
+            {
+                peers[r] = fd;
+                break;
+            }
+            if (fd >= 0)
+                ::close(fd);
+            if (std::chrono::steady_clock::now() > deadline)
+            {
+                close();
+                return false;
+            }
+            std::this_thread::sleep_for(std::chrono::milliseconds(10));
+        }
+        int32_t id = rank;
+        if (!transferAll(peers[r], reinterpret_cast<char*>(&id), sizeof(id), true))
+        {
+            close();
+            return false;
+        }
+    }
+
+    for (int accepted = rank + 1; accepted < size; ++accepted)
+    {
+        int remaining = static_cast<int>(std::chrono::duration_cast<std::chrono::milliseconds>(
+                                             deadline - std::chrono::steady_clock::now()).count());
+        pollfd waiting = {listener, POLLIN, 0};
+        int fd = remaining > 0 && ::poll(&waiting, 1, remaining) == 1 ? ::accept(listener, nullptr, nullptr) : -1;
+        int32_t id = -1;
+        if (fd < 0 || !transferAll(fd, reinterpret_cast<char*>(&id), sizeof(id), false) || id <= rank || id >= size ||
+            peers[id] >= 0)
+        {
+            if (fd >= 0)
+                ::close(fd);
+            close();
+            return false;
+        }
+        peers[id] = fd;
+    }
+
+    for (int fd : peers)
+        if (fd >= 0)
+            ::fcntl(fd, F_SETFL, ::fcntl(fd, F_GETFL) | O_NONBLOCK);
+    return true;
+#else
+    (void)directory;
+    (void)rank;
+    (void)size;
+    (void)timeoutMs;
+    return false;
+#endif
+}
+
+void UnixSocketTransport::close()
+{
+#ifdef __unix__
+    for (int fd : peers)
+        if (fd >= 0)
+            ::close(fd);
+    if (listener >= 0)
+    {
+        ::close(listener);
+        ::unlink(listenerPath.c_str());
+    }
+#endif
+    peers.clear();
+    listener = -1;
+}
+
+int UnixSocketTransport::getRank()
+{
+    return rank;
+}
+
+int UnixSocketTransport::getSize()
+{
+    return size;
+}
+
+// Every message is framed by its 64-bit length. All peers are written and read at once through poll(), so two
+// ranks sending each other more than the socket buffers hold cannot block each other. Reads stop at the end of
+// the frame; whatever a faster peer already sent for the next exchange stays in the socket.
+bool UnixSocketTransport::exchange(const std::vector<std::vector<char>>& outgoing, std::vector<std::vector<char>>& incoming)
+{
+    incoming.assign(size, std::vector<char>());
+#ifdef __unix__
+    struct Progress {
+        uint64_t sendHeader;
+        size_t sent;
+        uint64_t receiveHeader;
+        size_t received;
+    };
+    std::vector<Progress> progress(size);
+    for (int r = 0; r < size; ++r)
+        progress[r] = {r < static_cast<int>(outgoing.size()) ? outgoing[r].size() : 0, 0, 0, 0};
+
+    static const std::vector<char> empty;
+    std::vector<pollfd> waiting;
+    std::vector<int> ranks;
+    for (;;)
+    {
+        waiting.clear();
+        ranks.clear();
+        for (int r = 0; r < size; ++r)
+        {
+            if (r == rank)
+                continue;
+            const Progress& p = progress[r];
+            bool sending = p.sent < sizeof(uint64_t) + p.sendHeader;
+            bool receiving = p.received < sizeof(uint64_t) || p.received < sizeof(uint64_t) + p.receiveHeader;
+            if (sending || receiving)
+            {
+                waiting.push_back({peers[r], static_cast<short>((sending ? POLLOUT : 0) | (receiving ? POLLIN : 0)), 0});
+                ranks.push_back(r);
+            }
+        }
+        if (waiting.empty())
+            return true;
+        if (::poll(waiting.data(), waiting.size(), -1) < 0)
+        {
+            if (errno == EINTR)
+                continue;
+            return false;
+        }
+
+        for (size_t k = 0; k < waiting.size(); ++k)
+        {
+            int r = ranks[k];
+            Progress& p = progress[r];
+            const std::vector<char>& message = r < static_cast<int>(outgoing.size()) ? outgoing[r] : empty;
+            if (waiting[k].revents & POLLOUT)
+            {
+                const char* data = p.sent < sizeof(uint64_t) ? reinterpret_cast<const char*>(&p.sendHeader) + p.sent
+                                                             : message.data() + (p.sent - sizeof(uint64_t));
+                size_t count = p.sent < sizeof(uint64_t) ? sizeof(uint64_t) - p.sent : message.size() - (p.sent - sizeof(uint64_t));
+                ssize_t written = ::send(peers[r], data, count, MSG_NOSIGNAL);
+                if (written < 0 && errno != EAGAIN && errno != EWOULDBLOCK && errno != EINTR)
+                    return false;
+                p.sent += written > 0 ? static_cast<size_t>(written) : 0;
+            }
+            if ((waiting[k].events & POLLIN) && (waiting[k].revents & (POLLIN | POLLHUP | POLLERR)))
+            {
+                std::vector<char>& message = incoming[r];
+                char* data = p.received < sizeof(uint64_t) ? reinterpret_cast<char*>(&p.receiveHeader) + p.received
+                                                           : message.data() + (p.received - sizeof(uint64_t));
+                size_t count = p.received < sizeof(uint64_t) ? sizeof(uint64_t) - p.received
+                                                             : message.size() - (p.received - sizeof(uint64_t));
+                ssize_t read = ::recv(peers[r], data, count, 0);
+                if (read == 0 || (read < 0 && errno != EAGAIN && errno != EWOULDBLOCK && errno != EINTR))
+                    return false;
+                p.received += read > 0 ? static_cast<size_t>(read) : 0;
+                if (read > 0 && p.received == sizeof(uint64_t))
+                    message.resize(p.receiveHeader);
+            }
+        }
+    }
+#else
+    (void)outgoing;
+    return size == 1;
+#endif
+}
@@ -0,0 +1,111 @@
+#ifndef TRANSPORT_H
+#define TRANSPORT_H
+
+#include <cstdint>
+#include <cstring>
+#include <string>
+#include <vector>
+
+// Message passing between the ranks of one simulation split over several processes. The only primitive is a
+// collective all-to-all exchange, which every rank enters together; gathers, reductions and barriers are built
+// on it. Implementations must not deadlock on messages larger than their buffers.
+class Transport {
+public:
+    virtual ~Transport() {}
+    virtual int getRank() = 0;
+    virtual int getSize() = 0;
+    // Delivers outgoing[r] to every other rank r and fills incoming[r] with what r sent here; the own rank's
+    // entries are ignored and left empty. Returns false when a peer went away.
+    virtual bool exchange(const std::vector<std::vector<char>>& outgoing, std::vector<std::vector<char>>& incoming) = 0;
+};
+
+// Every rank's message on every rank: messages[r] is what rank r passed.
+bool allGather(Transport& transport, const std::vector<char>& message, std::vector<std::vector<char>>& messages);
+
+// Ranks on one Linux machine connected pairwise by Unix-domain stream sockets. Rank r listens on
+// <directory>/rank-r.sock, connects to every lower rank and accepts every higher one.
+class UnixSocketTransport : public Transport {
+public:
+    UnixSocketTransport();
+    ~UnixSocketTransport() override;
+
+    bool connect(const std::string& directory, int rank, int size, int timeoutMs);
+    void close();
+
+    int getRank() override;
+    int getSize() override;
+    bool exchange(const std::vector<std::vector<char>>& outgoing, std::vector<std::vector<char>>& incoming) override;
+
+private:
+    int rank;
+    int size;
+    int listener;
+    std::string listenerPath;
+    std::vector<int> peers;
+};
+
+// Plain-data serialisation for messages; both ends run the same build, so values are copied byte for byte.
+class MessageWriter {
+public:
+    template <typename T>
+    void put(const T& value)
+    {
+        size_t offset = data.size();
+        data.resize(offset + sizeof(T));
+        std::memcpy(data.data() + offset, &value, sizeof(T));
+    }
+
+    template <typename T>
+    void putVector(const std::vector<T>& values)
+    {
+        put<uint64_t>(values.size());
+        size_t offset = data.size();
+        data.resize(offset + values.size() * sizeof(T));
+        if (!values.empty())
+            std::memcpy(data.data() + offset, values.data(), values.size() * sizeof(T));
+    }
+
+    std::vector<char>& getData()
+    {
+        return data;
+    }
+
+private:
+    std::vector<char> data;
+};
+
+class MessageReader {
+public:
+    explicit MessageReader(const std::vector<char>& data) : data(data), offset(0) {}
+
+    template <typename T>
+    T get()
+    {
+        T value = T();
+        if (offset + sizeof(T) <= data.size())
+            std::memcpy(&value, data.data() + offset, sizeof(T));
+        offset += sizeof(T);
+        return value;
+    }
+
+    template <typename T>
+    void getVector(std::vector<T>& values)
+    {
+        uint64_t count = get<uint64_t>();
+        values.resize(offset + count * sizeof(T) <= data.size() ? count : 0);
+        if (!values.empty())
+            std::memcpy(values.data(), data.data() + offset, values.size() * sizeof(T));
+        offset += count * sizeof(T);
+    }
+
+    bool atEnd()
+    {
+        return offset >= data.size();
+    }
+
+private:
+    const std::vector<char>& data;
+    size_t offset;
+};
+
+#endif // TRANSPORT_H
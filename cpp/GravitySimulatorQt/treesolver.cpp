@@ -0,0 +1,345 @@
+#include "treesolver.h"
+#include <algorithm>
+#include <cmath>
+#include <limits>
+#include <thread>
+#include "parallelfor.h"
+#include "profiler.h"
+
+// The root square is this much larger than the bodies' bounds, so a few steps of drift do not force a rebuild.
+static const double rootMargin = 1.25;
+
+TreeSolver::TreeSolver()
+    : openingAngle(0.5), rebuildFraction(0.25), threadCount(std::max(1u, std::thread::hardware_concurrency())),
+      valid(false), buildCount(0), reinsertCount(0), builtNodes(0), reinsertedSinceBuild(0) {}
+
+void TreeSolver::resize(size_t n)
+{
+    x.resize(n);
+    y.resize(n);
+    mass.resize(n);
+    ax.resize(n);
+    ay.resize(n);
+}
+
+void TreeSolver::compute(double gforce, const Softening& softening)
+{
+    switch (softening.kernel)
+    {
+    case SofteningKernel::Plummer:
+        compute<SofteningKernel::Plummer>(gforce, softening.length);
+        break;
+    case SofteningKernel::Spline:
+        compute<SofteningKernel::Spline>(gforce, softening.length);
+        break;
+    default:
+        compute<SofteningKernel::None>(gforce, softening.length);
+        break;
+    }
+}
+
+// Every body walks the tree on its own, so rows can go to any thread and the sums do not depend on the split.
+template <SofteningKernel Softened>
+void TreeSolver::compute(double gforce, double softeningLength)
+{
+    std::fill(ax.begin(), ax.end(), 0.0);
+    std::fill(ay.begin(), ay.end(), 0.0);
+    if (x.empty())
+        return;
+
+    maintain();
+
+    const double theta2 = openingAngle * openingAngle;
+    parallelForDynamic(x.size(), threadCount, 64, [&](size_t begin, size_t end) {
+        std::vector<int> stack;
+        stack.reserve(4 * maxDepth);
+        for (size_t i = begin; i < end; ++i)
+        {
+            const double xi = x[i];
+            const double yi = y[i];
+            double sumX = 0.0, sumY = 0.0;
+            stack.assign(1, 0);
+            while (!stack.empty())
+            {
+                const Node& node = nodes[stack.back()];
+                stack.pop_back();
+                if (node.count == 0)
+                    continue;
+
+                if (node.child < 0)
+                {
+                    for (int b = node.first; b >= 0; b = next[b])
+                    {
+                        if (b == static_cast<int>(i))
+                            continue;
+                        double dx = x[b] - xi;
+                        double dy = y[b] - yi;
+                        double scale = mass[b] * softenedInverseCube<Softened>(dx * dx + dy * dy, softeningLength);
+                        sumX += dx * scale;
+                        sumY += dy * scale;
+                    }
+                    continue;
+                }
+
+                double dx = node.comX - xi;
+                double dy = node.comY - yi;
+                double dist2 = dx * dx + dy * dy;
+                double extent = std::max(node.maxX - node.minX, node.maxY - node.minY);
+                bool inside = xi >= node.minX && xi <= node.maxX && yi >= node.minY && yi <= node.maxY;
+                if (!inside && extent * extent < theta2 * dist2)
+                {
+                    double scale = node.mass * softenedInverseCube<Softened>(dist2, softeningLength);
+                    sumX += dx * scale;
+                    sumY += dy * scale;
+                    continue;
+                }
+                for (int q = 0; q < 4; ++q)
+                    stack.push_back(node.child + q);
+            }
+            ax[i] = gforce * sumX;
+            ay[i] = gforce * sumY;
+        }
+    });
+}
+
+template void TreeSolver::compute<SofteningKernel::None>(double gforce, double softeningLength);
+template void TreeSolver::compute<SofteningKernel::Plummer>(double gforce, double softeningLength);
+template void TreeSolver::compute<SofteningKernel::Spline>(double gforce, double softeningLength);
+
+void TreeSolver::invalidate()
+{
+    valid = false;
+}
+
+void TreeSolver::maintain()
+{
+    PROFILE_SCOPE(ProfilePhase::Tree);
+    if (!valid || leafOf.size() != x.size() || !reinsertMoved() ||
+        static_cast<double>(reinsertedSinceBuild) > rebuildFraction * x.size() || nodes.size() > 2 * builtNodes + 64)
+        build();
+    refit();
+}
+
+void TreeSolver::build()
+{
+    size_t n = x.size();
+    double minX = x[0], maxX = x[0], minY = y[0], maxY = y[0];
+    for (size_t i = 1; i < n; ++i)
+    {
+        minX = std::min(minX, x[i]);
+        maxX = std::max(maxX, x[i]);
+        minY = std::min(minY, y[i]);
+        maxY = std::max(maxY, y[i]);
+    }
+    double halfSize = std::max(0.5 * rootMargin * std::max(maxX - minX, maxY - minY), 1.0);
+
+    nodes.clear();
+    nodes.push_back({0.5 * (minX + maxX), 0.5 * (minY + maxY), halfSize, -1, -1, 0, -1, 0, 0.0, 0.0, 0.0, 0.0, 0.0,
+                     0.0, 0.0});
+    leafOf.assign(n, -1);
+    next.assign(n, -1);
+    previous.assign(n, -1);
+    for (size_t i = 0; i < n; ++i)
+        insert(static_cast<int>(i), 0);
+
+    valid = true;
+    builtNodes = nodes.size();
+    reinsertedSinceBuild = 0;
+    ++buildCount;
+}
+
+// Bodies still inside their leaf's square cost one test. The others climb from their old leaf to the first
+// cell containing them and descend from there; false if one has left the root.
+bool TreeSolver::reinsertMoved()
+{
+    moved.clear();
+    for (size_t i = 0; i < x.size(); ++i)
+    {
+        if (!contains(nodes[leafOf[i]], x[i], y[i]))
+            moved.push_back(static_cast<int>(i));
+    }
+
+    for (int body : moved)
+    {
+        int cell = leafOf[body];
+        remove(body);
+        while (cell >= 0 && !contains(nodes[cell], x[body], y[body]))
+            cell = nodes[cell].parent;
+        if (cell < 0)
+            return false;
+        insert(body, cell);
+    }
+    reinsertedSinceBuild += moved.size();
+    reinsertCount += moved.size();
+    return true;
+}
+
+// Descends from start, whose ancestors are counted on the way in as well.
+void TreeSolver::insert(int body, int start)
+{
+    for (int cell = nodes[start].parent; cell >= 0; cell = nodes[cell].parent)
+        ++nodes[cell].count;
+
+    int cell = start;
+    while (nodes[cell].child >= 0)
+    {
+        ++nodes[cell].count;
+        cell = nodes[cell].child + quadrant(nodes[cell], x[body], y[body]);
+    }
+    link(body, cell);
+    if (nodes[cell].count > leafCapacity && nodes[cell].depth < maxDepth)
+        split(cell);
+}
+
+void TreeSolver::remove(int body)
+{
+    int leaf = leafOf[body];
+    if (previous[body] >= 0)
+        next[previous[body]] = next[body];
+    else
+        nodes[leaf].first = next[body];
+    if (next[body] >= 0)
+        previous[next[body]] = previous[body];
+    leafOf[body] = -1;
+    for (int cell = leaf; cell >= 0; cell = nodes[cell].parent)
+        --nodes[cell].count;
+}
+
+void TreeSolver::link(int body, int leaf)
+{
+    Node& node = nodes[leaf];
+    previous[body] = -1;
+    next[body] = node.first;
+    if (node.first >= 0)
+        previous[node.first] = body;
+    node.first = body;
+    ++node.count;
+    leafOf[body] = leaf;
+}
+
+// Children are appended after their parent, so walking the nodes backwards visits every child before its parent.
+void TreeSolver::split(int node)
+{
+    int firstChild = static_cast<int>(nodes.size());
+    Node cell = nodes[node];
+    double quarter = 0.5 * cell.halfSize;
+    for (int q = 0; q < 4; ++q)
+    {
+        nodes.push_back({cell.centreX + (q & 1 ? quarter : -quarter), cell.centreY + (q & 2 ? quarter : -quarter),
+                         quarter, node, -1, cell.depth + 1, -1, 0, 0.0, 0.0, 0.0, 0.0, 0.0, 0.0, 0.0});
+    }
+    nodes[node].child = firstChild;
+    nodes[node].first = -1;
+
+    for (int body = cell.first; body >= 0;)
+    {
+        int following = next[body];
+        link(body, firstChild + quadrant(cell, x[body], y[body]));
+        body = following;
+    }
+    for (int q = 0; q < 4; ++q)
+    {
+        if (nodes[firstChild + q].count > leafCapacity && cell.depth + 1 < maxDepth)
+            split(firstChild + q);
+    }
+}
+
+// Mass, centre of mass and tight bounds of every cell from the bodies' current positions and masses.
+void TreeSolver::refit()
+{
+    const double inf = std::numeric_limits<double>::infinity();
+    for (size_t k = nodes.size(); k-- > 0;)
+    {
+        Node& node = nodes[k];
+        double m = 0.0, mx = 0.0, my = 0.0;
+        double minX = inf, minY = inf, maxX = -inf, maxY = -inf;
+        if (node.count > 0 && node.child < 0)
+        {
+            for (int b = node.first; b >= 0; b = next[b])
+            {
+                m += mass[b];
+                mx += mass[b] * x[b];
+                my += mass[b] * y[b];
+                minX = std::min(minX, x[b]);
+                minY = std::min(minY, y[b]);
+                maxX = std::max(maxX, x[b]);
+                maxY = std::max(maxY, y[b]);
+            }
+        }
+        else if (node.count > 0)
+        {
+            for (int q = 0; q < 4; ++q)
+            {
+                const Node& c = nodes[node.child + q];
+                if (c.count == 0)
+                    continue;
+                m += c.mass;
+                mx += c.mass * c.comX;
+                my += c.mass * c.comY;
+                minX = std::min(minX, c.minX);
+                minY = std::min(minY, c.minY);
+                maxX = std::max(maxX, c.maxX);
+                maxY = std::max(maxY, c.maxY);
+            }
+        }
+        node.mass = m;
+        node.comX = m != 0.0 ? mx / m : 0.5 * (minX + maxX);
+        node.comY = m != 0.0 ? my / m : 0.5 * (minY + maxY);
+        node.minX = minX;
+        node.minY = minY;
+        node.maxX = maxX;
+        node.maxY = maxY;
+    }
+}
+
+// Half-open like quadrant(), so a body on a dividing line belongs to exactly one cell.
+bool TreeSolver::contains(const Node& node, double px, double py) const
+{
+    return px >= node.centreX - node.halfSize && px < node.centreX + node.halfSize &&
+           py >= node.centreY - node.halfSize && py < node.centreY + node.halfSize;
+}
+
+int TreeSolver::quadrant(const Node& node, double px, double py) const
+{
+    return (px >= node.centreX ? 1 : 0) + (py >= node.centreY ? 2 : 0);
+}
+
+void TreeSolver::setOpeningAngle(double val)
+{
+    openingAngle = val;
+}
+
+double TreeSolver::getOpeningAngle()
+{
+    return openingAngle;
+}
+
+void TreeSolver::setRebuildFraction(double val)
+{
+    rebuildFraction = val;
+}
+
+double TreeSolver::getRebuildFraction()
+{
+    return rebuildFraction;
+}
+
+void TreeSolver::setThreadCount(int val)
+{
+    threadCount = std::max(1, val);
+}
+
+uint64_t TreeSolver::getBuildCount()
+{
+    return buildCount;
+}
+
+uint64_t TreeSolver::getReinsertCount()
+{
+    return reinsertCount;
+}
+
+int TreeSolver::getNodeCount()
+{
+    return static_cast<int>(nodes.size());
+}
@@ -0,0 +1,96 @@
+#ifndef TREE_SOLVER_H
+#define TREE_SOLVER_H
+
+#include <cstdint>
+#include <vector>
+#include "softening.h"
+
+// Barnes-Hut gravity over a quadtree that persists between steps. Cells are fixed squares; every compute() only
+// takes out the bodies that left their leaf's square and reinserts them from the nearest ancestor that still
+// contains them, then refits every node's mass, centre of mass and tight bounds bottom-up in one pass. A cell is
+// replaced by a monopole when its tight bounds are smaller than openingAngle times the distance to its centre of
+// mass. The tree is rebuilt from scratch when the bodies reinserted since the last build exceed rebuildFraction
+// of all of them or splits have doubled the node count - both mean the cells no longer fit the distribution -
+// and when a body leaves the root square or invalidate() was called because the body indices changed.
+class TreeSolver {
+public:
+    static const int leafCapacity = 8;
+    // Deeper cells would only separate bodies closer than the root size / 2^maxDepth; they share a leaf instead.
+    static const int maxDepth = 40;
+
+    TreeSolver();
+
+    // Bodies are staged here by the caller before compute(); accelerations come back in ax, ay.
+    std::vector<double> x;
+    std::vector<double> y;
+    std::vector<double> mass;
+    std::vector<double> ax;
+    std::vector<double> ay;
+
+    void resize(size_t n);
+    void compute(double gforce, const Softening& softening);
+    // One instantiation per softening kernel, so the traversal has no branch on it.
+    template <SofteningKernel Softened>
+    void compute(double gforce, double softeningLength);
+    void invalidate();
+
+    void setOpeningAngle(double val);
+    double getOpeningAngle();
+    void setRebuildFraction(double val);
+    double getRebuildFraction();
+    void setThreadCount(int val);
+    uint64_t getBuildCount();
+    uint64_t getReinsertCount();
+    int getNodeCount();
+
+private:
+    struct Node {
+        // The cell: a fixed square that decides which bodies belong here.
+        double centreX;
+        double centreY;
+        double halfSize;
+        int parent;
+        // First of four consecutive children, or -1 for a leaf.
+        int child;
+        int depth;
+        // Head of a leaf's list of bodies.
+        int first;
+        int count;
+        // Refitted every compute().
+        double mass;
+        double comX;
+        double comY;
+        double minX;
+        double minY;
+        double maxX;
+        double maxY;
+    };
+
+    double openingAngle;
+    double rebuildFraction;
+    int threadCount;
+    bool valid;
+    uint64_t buildCount;
+    uint64_t reinsertCount;
+    size_t builtNodes;
+    size_t reinsertedSinceBuild;
+    std::vector<Node> nodes;
+    // Per body: its leaf and its neighbours in the leaf's doubly linked list.
+    std::vector<int> leafOf;
+    std::vector<int> next;
+    std::vector<int> previous;
+    std::vector<int> moved;
+
+    void maintain();
+    void build();
+    bool reinsertMoved();
+    void insert(int body, int start);
+    void remove(int body);
+    void link(int body, int leaf);
+    void split(int node);
+    void refit();
+    bool contains(const Node& node, double px, double py) const;
+    int quadrant(const Node& node, double px, double py) const;
+};
+
+#endif // TREE_SOLVER_H
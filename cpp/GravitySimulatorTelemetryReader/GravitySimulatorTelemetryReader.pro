@@ -0,0 +1,14 @@
+CONFIG += console c++17
+CONFIG -= app_bundle qt
+
+# Reference reader for the simulator's shared-memory telemetry channel (Linux only).
+
+INCLUDEPATH += ../GravitySimulatorQt
+
+SOURCES += \
+    main.cpp
+
+HEADERS += \
+    ../GravitySimulatorQt/telemetry.h
+
+LIBS += -lrt
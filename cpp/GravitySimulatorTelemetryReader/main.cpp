@@ -0,0 +1,113 @@
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <vector>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include "telemetry.h"
+
+// Reads the most recent consistent frame from the slot. Returns false if the frame was overwritten while copying.
+static bool readFrame(TelemetryHeader* header, uint64_t frame, TelemetrySlot& out, std::vector<TelemetryBody>& bodies)
+{
+    TelemetrySlot* slot = telemetrySlot(header, frame);
+    for (int attempt = 0; attempt < 16; ++attempt)
+    {
+        uint64_t before = slot->sequence.load(std::memory_order_acquire);
+        if (before & 1)
+            continue;
+
+        out.frame = slot->frame;
+        out.step = slot->step;
+        out.simulationTime = slot->simulationTime;
+        out.bodyCount = std::min(slot->bodyCount, header->maxBodies);
+        bodies.resize(out.bodyCount);
+        std::memcpy(bodies.data(), telemetryBodies(slot), sizeof(TelemetryBody) * out.bodyCount);
+
+        std::atomic_thread_fence(std::memory_order_acquire);
+        if (slot->sequence.load(std::memory_order_relaxed) == before)
+            return out.frame == frame;
+    }
+    return false;
+}
+
+int main(int argc, char *argv[])
+{
+    const char* name = argc > 1 ? argv[1] : "/gravsim";
+    int frames = argc > 2 ? std::atoi(argv[2]) : 0;
+
+    int fd = shm_open(name, O_RDONLY, 0);
+    if (fd < 0)
+    {
+        std::perror("shm_open");
+        return 1;
+    }
+
+    struct stat info;
+    if (fstat(fd, &info) != 0 || static_cast<size_t>(info.st_size) < sizeof(TelemetryHeader))
+    {
+        std::fprintf(stderr, "%s: region too small\n", name);
+        ::close(fd);
+        return 1;
+    }
+
+    void* region = mmap(nullptr, info.st_size, PROT_READ, MAP_SHARED, fd, 0);
+    ::close(fd);
+    if (region == MAP_FAILED)
+    {
+        std::perror("mmap");
+        return 1;
+    }
+
+    TelemetryHeader* header = static_cast<TelemetryHeader*>(region);
+    if (header->magic != TELEMETRY_MAGIC || header->version != TELEMETRY_VERSION ||
+        static_cast<size_t>(info.st_size) < telemetryRegionSize(header->slotCount, header->maxBodies))
+    {
+        std::fprintf(stderr, "%s: not a telemetry region (or incompatible version)\n", name);
+        munmap(region, info.st_size);
+        return 1;
+    }
+    std::atomic_thread_fence(std::memory_order_acquire);
+
+    std::printf("%s: %u slots, up to %u bodies\n", name, header->slotCount, header->maxBodies);
+
+    TelemetrySlot frame;
+    std::vector<TelemetryBody> bodies;
+    uint64_t lastFrame = 0;
+    int printed = 0;
+    while (frames == 0 || printed < frames)
+    {
+        uint64_t published = header->framesPublished.load(std::memory_order_acquire);
+        if (published == lastFrame || !readFrame(header, published - 1, frame, bodies))
+        {
+            usleep(1000);
+            continue;
+        }
+
+        uint64_t dropped = published - lastFrame - 1;
+        lastFrame = published;
+
+        double cx = 0.0, cy = 0.0, kinetic = 0.0;
+        for (const TelemetryBody& b : bodies)
+        {
+            cx += b.x;
+            cy += b.y;
+            kinetic += 0.5 * (b.vx * b.vx + b.vy * b.vy);
+        }
+        if (!bodies.empty())
+        {
+            cx /= bodies.size();
+            cy /= bodies.size();
+        }
+
+        std::printf("frame %llu step %llu t=%.3f n=%u centroid=(%.2f, %.2f) v2/2=%.3f skipped=%llu\n",
+                    static_cast<unsigned long long>(frame.frame), static_cast<unsigned long long>(frame.step),
+                    frame.simulationTime, frame.bodyCount, cx, cy, kinetic, static_cast<unsigned long long>(dropped));
+        ++printed;
+    }
+
+    munmap(region, info.st_size);
+    return 0;
+}